@@ -0,0 +1,15 @@
+// texture sampler
+#ifdef MATERIAL_ARRAY
+// one layer per material, see TextureArrayBuilder
+uniform sampler2DArray albedoMap;
+uniform sampler2DArray normalMap;
+uniform sampler2DArray packedMap;
+flat in float materialLayer;
+#define SAMPLE_MATERIAL(map) texture(map, vec3(uv, materialLayer))
+#else
+uniform sampler2D albedoMap;
+uniform sampler2D normalMap;
+// ambient occlusion, roughness and displacement packed in one texture
+uniform sampler2D packedMap;
+#define SAMPLE_MATERIAL(map) texture2D(map, uv)
+#endif
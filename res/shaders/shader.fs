@@ -5,28 +5,35 @@ out vec4 outColor;
 in vec3 color;
 in vec2 uv;
 in vec3 fragmentWorldPosition;
+#ifdef NORMAL_MAP
 in mat3 TBN;
+#else
+in vec3 worldNormal;
+#endif
 
-// texture sampler
-uniform sampler2D albedoMap;
-uniform sampler2D normalMap;
-
-uniform vec3 lightWorldPosition;
-uniform vec3 lightColor;
-
-uniform vec3 baseColor;
-
-uniform vec3 cameraWorldPosition;
+#include "uniform_blocks.glsl"
+#include "material.glsl"
 
 void main()
 {
-	vec3 samplerColor 			= texture2D(albedoMap, uv).rgb;
+	vec3 samplerColor 			= SAMPLE_MATERIAL(albedoMap).rgb;
 	
-	vec3 samplerNormal 			= texture2D(normalMap, uv).rgb;
-	vec3 normalTangentSpace 	= normalize(samplerNormal * 2.0 - 1.0);  		// Normal in Tangentspace
+#ifdef NORMAL_MAP
+	// z is rebuilt from x and y, BC5 compressed normal maps only store those two
+	vec2 samplerNormal 			= SAMPLE_MATERIAL(normalMap).rg * 2.0 - 1.0;
+	vec3 normalTangentSpace 	= normalize(vec3(samplerNormal, sqrt(max(1.0 - dot(samplerNormal, samplerNormal), 0.0))));  		// Normal in Tangentspace
 	vec3 normalWorldSpace 		= normalize(TBN * normalTangentSpace); 			// Normal in Worldspace
+#else
+	vec3 normalWorldSpace 		= normalize(worldNormal);
+#endif
+	
+	vec4 samplerPacked			= SAMPLE_MATERIAL(packedMap);
+	float occlusion				= material.occlusionChannel >= 0 ? samplerPacked[material.occlusionChannel] : 1.0;
+#ifdef SPECULAR
+	float roughness				= material.roughnessChannel >= 0 ? samplerPacked[material.roughnessChannel] : 0.6;	// 0.6 gives the former exponent of 32
+#endif
 	
-	vec3 ambient = vec3(0.1, 0.1, 0.1);
+	vec3 ambient = vec3(0.1, 0.1, 0.1) * occlusion;
 	
 	vec3 lightDir = normalize(lightWorldPosition - fragmentWorldPosition);
 	float diff = max(dot(normalWorldSpace, lightDir), 0.0);
@@ -34,13 +41,18 @@ void main()
 	vec3 diffuse = (diff * lightColor); 
 	
 	// Specular
+#ifdef SPECULAR
 	float specularStrength = 0.5;
 	vec3 viewDir = normalize(cameraWorldPosition - fragmentWorldPosition);
 	vec3 reflectDir = reflect(-lightDir, normalWorldSpace);
 	
 	// Blinn
-	float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
+	float specularPower = exp2(10.0 * (1.0 - roughness) + 1.0);
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), specularPower);
 	vec3 specular = specularStrength * spec * lightColor;  
+#else
+	vec3 specular = vec3(0.0);
+#endif
 
 	vec3 result = (ambient + diffuse + specular) * (baseColor * samplerColor);
 	
@@ -1,34 +1,82 @@
 #version 330 core
 
+#ifdef PACKED_VERTEX
+// See PackedVertexData
+layout (location = 0) in vec4 aPackedPosition;	// xyz in mesh bounds, w = bitangent sign (0 or 1)
+layout (location = 2) in vec2 aUV;
+layout (location = 3) in vec2 aPackedNormal;	// octahedral
+layout (location = 4) in vec2 aPackedTangent;	// octahedral
+
+uniform vec3 positionBoundsMin;
+uniform vec3 positionBoundsExtent;
+
+#include "vertex_packing.glsl"
+#else
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aColor;
 layout (location = 2) in vec2 aUV;
 layout (location = 3) in vec3 aNormal;
 layout (location = 4) in vec3 aTangent;
 layout (location = 5) in vec3 aBitangent;
+#endif
+
+#ifdef MATERIAL_ARRAY
+// per instance, or the same for the whole draw when the array is disabled: xyz offset in model space, w texture array layer
+layout (location = 6) in vec4 aInstance;
+flat out float materialLayer;
+#endif
 
 out vec3 color;
 out vec2 uv;
 out vec3 fragmentWorldPosition;
+#ifdef NORMAL_MAP
 out mat3 TBN;
+#else
+out vec3 worldNormal;
+#endif
 
-uniform mat4 transform;
-uniform mat4 view;
-uniform mat4 projection;
+#include "uniform_blocks.glsl"
 
 void main()
 {
-	gl_Position = projection * view * transform * vec4(aPos, 1.0);
+#ifdef PACKED_VERTEX
+	vec3 position = positionBoundsMin + aPackedPosition.xyz * positionBoundsExtent;
+	vec3 normal = OctahedralDecode(aPackedNormal);
+#ifdef NORMAL_MAP
+	vec3 tangent = OctahedralDecode(aPackedTangent);
+	vec3 bitangent = cross(normal, tangent) * (aPackedPosition.w * 2.0 - 1.0);
+#endif
+	color = vec3(0.0);
+#else
+	vec3 position = aPos;
+	vec3 normal = aNormal;
+#ifdef NORMAL_MAP
+	vec3 tangent = aTangent;
+	vec3 bitangent = aBitangent;
+#endif
 	color = aColor;
+#endif
+
+#ifdef MATERIAL_ARRAY
+	position += aInstance.xyz;
+	materialLayer = aInstance.w;
+#endif
+
+	vec4 worldPosition = transform * vec4(position, 1.0);
+	gl_Position = viewProjection * worldPosition;
 	uv = aUV;
-	
-	fragmentWorldPosition = vec3(transform * vec4(aPos, 1.0));
-	
+
+	fragmentWorldPosition = worldPosition.xyz;
+
+#ifdef NORMAL_MAP
 	// TBN
-	vec3 T = normalize(mat3(transform) * aTangent);
-    vec3 B = normalize(mat3(transform) * aBitangent);
-	vec3 N = normalize(mat3(transform) * aNormal);
+	vec3 T = normalize(mat3(transform) * tangent);
+    vec3 B = normalize(mat3(transform) * bitangent);
+	vec3 N = normalize(mat3(transform) * normal);
 	mat3 _TBN = mat3(T, B, N);
-	
+
 	TBN = _TBN;
+#else
+	worldNormal = normalize(mat3(transform) * normal);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,28 @@
+// std140 uniform blocks, must match UniformBlocks.h. Their binding points are set by ShaderUniformTable::SetBlockBinding.
+
+// Written once per frame
+layout (std140) uniform FrameBlock
+{
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	vec3 cameraWorldPosition;
+	vec3 lightWorldPosition;
+	vec3 lightColor;
+};
+
+// Material descriptor: channel of packedMap holding each map, -1 when the material has none
+struct Material
+{
+	int occlusionChannel;
+	int roughnessChannel;
+	int displacementChannel;
+};
+
+// Written once per draw
+layout (std140) uniform ObjectBlock
+{
+	mat4 transform;
+	vec3 baseColor;
+	Material material;
+};
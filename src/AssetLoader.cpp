@@ -0,0 +1,116 @@
+#include "AssetLoader.h"
+
+#include <chrono>
+#include <memory>
+
+AssetLoader::AssetLoader(ThreadPool& threadPool)
+	: threadPool(threadPool)
+{
+}
+
+AssetLoader::~AssetLoader()
+{
+	Cancel();
+}
+
+void AssetLoader::Load(LoadJob job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		runningJobs++;
+	}
+
+	threadPool.Submit([this, job]()
+	{
+		UploadStep upload = job();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (upload)
+		{
+			uploads.push_back(std::move(upload));
+		}
+		runningJobs--;
+		jobsDoneCondition.notify_all();
+	});
+}
+
+void AssetLoader::Cancel()
+{
+	std::deque<UploadStep> dropped;
+	{
+		// the jobs push their uploads into this loader
+		std::unique_lock<std::mutex> lock(mutex);
+		jobsDoneCondition.wait(lock, [this]() { return runningJobs == 0; });
+		dropped.swap(uploads);
+	}
+}
+
+size_t AssetLoader::ProcessUploads(double budgetSeconds)
+{
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	size_t stepCount = 0;
+	while (true)
+	{
+		UploadStep upload;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (uploads.empty())
+			{
+				break;
+			}
+			upload = std::move(uploads.front());
+			uploads.pop_front();
+			hasUnfinishedUpload = true;
+		}
+
+		const bool isDone = upload();
+		stepCount++;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			hasUnfinishedUpload = false;
+			if (!isDone)
+			{
+				// keeps its place in front of the uploads queued after it
+				uploads.push_front(std::move(upload));
+			}
+		}
+
+		if (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= budgetSeconds)
+		{
+			break;
+		}
+	}
+	return stepCount;
+}
+
+size_t AssetLoader::GetPendingCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return runningJobs + uploads.size() + (hasUnfinishedUpload ? 1 : 0);
+}
+
+AssetLoader::UploadStep AssetLoader::Sequence(std::vector<UploadStep> steps)
+{
+	std::shared_ptr<size_t> currentStep = std::make_shared<size_t>(0);
+	return [steps, currentStep]()
+	{
+		while (*currentStep < steps.size())
+		{
+			const UploadStep& step = steps[*currentStep];
+			if (step && !step())
+			{
+				return false;
+			}
+			(*currentStep)++;
+
+			// give ProcessUploads a chance to check its budget between the steps
+			if (step)
+			{
+				return *currentStep == steps.size();
+			}
+		}
+		return true;
+	};
+}
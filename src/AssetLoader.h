@@ -0,0 +1,54 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "ThreadPool.h"
+
+// Loads assets on a ThreadPool while the render loop keeps running.
+// Reading, importing and decoding happen on the workers. What has to touch GL comes back as upload steps,
+// which the GL thread drains with ProcessUploads under a per-frame time budget.
+class AssetLoader
+{
+public:
+	// GL thread work, returns false while it has more to do and wants to be called again (next frame if the budget is spent)
+	using UploadStep = std::function<bool()>;
+	// Worker thread work, returns the upload step for what it loaded (an empty function when there is nothing to upload)
+	using LoadJob = std::function<UploadStep()>;
+
+	explicit AssetLoader(ThreadPool& threadPool = ThreadPool::GetShared());
+	// Waits for the jobs still running on the workers, uploads still queued are dropped
+	~AssetLoader();
+
+	AssetLoader(const AssetLoader&) = delete;
+	AssetLoader& operator=(const AssetLoader&) = delete;
+
+	void Load(LoadJob job);
+
+	// Waits for the jobs still running on the workers and drops the uploads still queued, along with what they hold
+	void Cancel();
+
+	// Runs the queued upload steps, in order, on the calling thread until budgetSeconds is spent.
+	// The first step always runs so that every call makes progress. Returns the number of steps run.
+	size_t ProcessUploads(double budgetSeconds);
+
+	// Loads still running on the workers or waiting for their upload to finish
+	size_t GetPendingCount() const;
+
+	// Step running each of steps to completion, one after the other
+	static UploadStep Sequence(std::vector<UploadStep> steps);
+
+private:
+	ThreadPool& threadPool;
+
+	mutable std::mutex mutex;
+	std::condition_variable jobsDoneCondition;
+	std::deque<UploadStep> uploads;
+	size_t runningJobs = 0;
+	// a step taken out of uploads is running on the GL thread
+	bool hasUnfinishedUpload = false;
+};
@@ -1,139 +1,588 @@
 #include "AssimpHelper.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "MeshCache.h"
+#include "ThreadPool.h"
+
 // Assimp
 // http://assimp.sourceforge.net/lib_html/usage.html
 #include <Assimp/Importer.hpp>      // C++ importer interface
 #include <Assimp/scene.h>           // Output data structure
 #include <Assimp/postprocess.h>     // Post processing flags
+#include <Assimp/ProgressHandler.hpp>
 
 ///////////////////// GENERAL ASSIMP HELPERS FUNCTIONS //////////////////////////////////////////////////////////////////////////////
 
-void MeshProcessing(
+// Copies one attribute into the vertex, attributes with a negative offset are not part of the layout
+inline void WriteVertexAttribute(unsigned char* vertex, int32_t offset, const void* value, size_t size)
+{
+	if (offset >= 0)
+	{
+		memcpy(vertex + offset, value, size);
+	}
+}
+
+// True when the attribute is not part of the layout or fits in the stride
+inline bool IsVertexAttributeInStride(const VertexLayout& layout, int32_t offset, size_t size)
+{
+	return offset < 0 || size_t(offset) + size <= layout.stride;
+}
+
+// Layouts the importers can fill: a non zero stride holding every attribute, which the vertex count divides by
+bool IsVertexLayoutValid(const VertexLayout& layout)
+{
+	return layout.stride > 0 &&
+		IsVertexAttributeInStride(layout, layout.positionOffset, sizeof(glm::vec3)) &&
+		IsVertexAttributeInStride(layout, layout.colorOffset, sizeof(glm::vec3)) &&
+		IsVertexAttributeInStride(layout, layout.uvOffset, sizeof(glm::vec2)) &&
+		IsVertexAttributeInStride(layout, layout.normalOffset, sizeof(glm::vec3)) &&
+		IsVertexAttributeInStride(layout, layout.tangentOffset, sizeof(glm::vec3)) &&
+		IsVertexAttributeInStride(layout, layout.bitangentOffset, sizeof(glm::vec3));
+}
+
+// Number of indices the mesh faces will produce
+size_t CountMeshIndices(const aiMesh* mesh)
+{
+	// after aiProcess_Triangulate + aiProcess_SortByPType most meshes contain only triangles
+	if (mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
+	{
+		return size_t(mesh->mNumFaces) * 3;
+	}
+
+	size_t count = 0;
+	for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+	{
+		count += mesh->mFaces[i].mNumIndices;
+	}
+	return count;
+}
+
+// Vertices / faces converted by one job, big meshes are split so that no single job dominates the import
+const unsigned int MESH_CONVERSION_SLICE = 16384;
+
+// A mesh referenced by a node, with where its data starts in the output buffers
+struct MeshInstance
+{
+	const aiMesh* mesh;
+	size_t firstVertex;
+	size_t firstIndex;
+};
+
+// A slice of the vertices or of the faces of one mesh instance
+struct MeshConversionJob
+{
+	size_t instance;
+	bool isFaces;
+	unsigned int begin;
+	unsigned int end;
+};
+
+void VertexProcessing(
 	const aiMesh* mesh,
-	const aiScene* scene,
-	std::vector<glm::vec3>& positions,
-	std::vector<glm::vec2>& uvs,
-	std::vector<glm::vec3>& normals,
-	std::vector<glm::vec3>& tangents,
-	std::vector<glm::vec3>& bitangents,
-	std::vector<unsigned int>& indices)
+	const VertexLayout& layout,
+	unsigned char* vertexData,
+	unsigned int begin,
+	unsigned int end)
 {
+	const aiVector3D zero(0.0f, 0.0f, 0.0f);
+
 	// Walk through each of the mesh's vertices
-	for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+	for (unsigned int i = begin; i < end; i++)
 	{
-		glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
-		// positions
-		vector.x = mesh->mVertices[i].x;
-		vector.y = mesh->mVertices[i].y;
-		vector.z = mesh->mVertices[i].z;
+		unsigned char* vertex = vertexData + size_t(i) * layout.stride;
 
-		positions.push_back(vector);
+		// aiVector3D is 3 packed floats, same as glm::vec3, so attributes are copied as they are
+		WriteVertexAttribute(vertex, layout.positionOffset, &mesh->mVertices[i], sizeof(glm::vec3));
 
-		// normals
-		vector.x = mesh->mNormals[i].x;
-		vector.y = mesh->mNormals[i].y;
-		vector.z = mesh->mNormals[i].z;
-
-		normals.push_back(vector);
+		// the vertex colors of the file are not imported, the color attribute is zero
+		WriteVertexAttribute(vertex, layout.colorOffset, &zero, sizeof(glm::vec3));
 
 		// texture coordinates
-		if (mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
+		// a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't 
+		// use models where a vertex can have multiple texture coordinates so we always take the first set (0).
+		WriteVertexAttribute(vertex, layout.uvOffset, mesh->mTextureCoords[0] ? &mesh->mTextureCoords[0][i] : &zero, sizeof(glm::vec2));
+
+		WriteVertexAttribute(vertex, layout.normalOffset, mesh->mNormals ? &mesh->mNormals[i] : &zero, sizeof(glm::vec3));
+		WriteVertexAttribute(vertex, layout.tangentOffset, mesh->mTangents ? &mesh->mTangents[i] : &zero, sizeof(glm::vec3));
+		WriteVertexAttribute(vertex, layout.bitangentOffset, mesh->mBitangents ? &mesh->mBitangents[i] : &zero, sizeof(glm::vec3));
+	}
+}
+
+void FaceProcessing(
+	const aiMesh* mesh,
+	unsigned int* indices,
+	unsigned int baseVertex,
+	unsigned int begin,
+	unsigned int end)
+{
+	// triangle only meshes can be split at any face, otherwise the job covers all the faces and starts at the first index
+	if (mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
+	{
+		indices += size_t(begin) * 3;
+	}
+
+	// now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
+	for (unsigned int i = begin; i < end; i++)
+	{
+		const aiFace& face = mesh->mFaces[i];
+		// face indices are relative to the mesh, rebase them to where the mesh vertices start in the shared buffer
+		for (unsigned int j = 0; j < face.mNumIndices; j++)
 		{
-			glm::vec2 vec;
-			// a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't 
-			// use models where a vertex can have multiple texture coordinates so we always take the first set (0).
-			vec.x = mesh->mTextureCoords[0][i].x;
-			vec.y = mesh->mTextureCoords[0][i].y;
+			*indices++ = baseVertex + face.mIndices[j];
+		}
+	}
+}
+
+// Collects the meshes of every node, in the same order a recursive walk would visit them
+std::vector<MeshInstance> GatherMeshInstances(const aiScene* scene)
+{
+	std::vector<MeshInstance> instances;
+	std::vector<const aiNode*> pendingNodes = { scene->mRootNode };
+	while (!pendingNodes.empty())
+	{
+		const aiNode* node = pendingNodes.back();
+		pendingNodes.pop_back();
 
-			uvs.push_back(vec);
+		// the node object only contains indices to index the actual objects in the scene. 
+		// the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
+		for (unsigned int i = 0; i < node->mNumMeshes; i++)
+		{
+			instances.push_back({ scene->mMeshes[node->mMeshes[i]], 0, 0 });
 		}
-		else
+		// pushed in reverse so the first child is visited next
+		for (unsigned int i = node->mNumChildren; i > 0; i--)
 		{
-			uvs.push_back(glm::vec2(0.0f, 0.0f));
+			pendingNodes.push_back(node->mChildren[i - 1]);
 		}
+	}
+	return instances;
+}
+
+// Lays the instances out one after the other in the output buffers (exclusive prefix sum of the vertex and index counts)
+// and converts them
+void ConvertMeshInstances(
+	std::vector<MeshInstance>& instances,
+	const VertexLayout& layout,
+	std::vector<unsigned char>& vertexData,
+	std::vector<unsigned int>& indices)
+{
+	// Phase 1: find where the data of every mesh goes
+	std::vector<MeshConversionJob> jobs;
+
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	for (size_t n = 0; n < instances.size(); ++n)
+	{
+		const aiMesh* mesh = instances[n].mesh;
+		instances[n].firstVertex = vertexCount;
+		instances[n].firstIndex = indexCount;
+		vertexCount += mesh->mNumVertices;
+		indexCount += CountMeshIndices(mesh);
 
-		// tangents
-		vector.x = mesh->mTangents[i].x;
-		vector.y = mesh->mTangents[i].y;
-		vector.z = mesh->mTangents[i].z;
-		tangents.push_back(vector);
+		for (unsigned int begin = 0; begin < mesh->mNumVertices; begin += MESH_CONVERSION_SLICE)
+		{
+			jobs.push_back({ n, false, begin, std::min(begin + MESH_CONVERSION_SLICE, mesh->mNumVertices) });
+		}
 
-		// bitangents
-		vector.x = mesh->mBitangents[i].x;
-		vector.y = mesh->mBitangents[i].y;
-		vector.z = mesh->mBitangents[i].z;
-		bitangents.push_back(vector);
+		if (mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
+		{
+			for (unsigned int begin = 0; begin < mesh->mNumFaces; begin += MESH_CONVERSION_SLICE)
+			{
+				jobs.push_back({ n, true, begin, std::min(begin + MESH_CONVERSION_SLICE, mesh->mNumFaces) });
+			}
+		}
+		else if (mesh->mNumFaces > 0)
+		{
+			jobs.push_back({ n, true, 0, mesh->mNumFaces });
+		}
 	}
 
-	// now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
-	for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+	// size the buffers up front so that every vertex and index is written exactly once
+	vertexData.resize(vertexCount * layout.stride);
+	indices.resize(indexCount);
+
+	// Phase 2: convert every slice in parallel, slices never overlap in the output buffers
+	unsigned char* vertexOutput = vertexData.data();
+	unsigned int* indexOutput = indices.data();
+	ThreadPool::GetShared().ParallelFor(jobs.size(), [&](size_t n)
 	{
-		aiFace face = mesh->mFaces[i];
-		// retrieve all indices of the face and store them in the indices vector
-		for (unsigned int j = 0; j < face.mNumIndices; j++)
+		const MeshConversionJob& job = jobs[n];
+		const MeshInstance& instance = instances[job.instance];
+		if (job.isFaces)
 		{
-			indices.push_back(face.mIndices[j]);
+			FaceProcessing(instance.mesh, indexOutput + instance.firstIndex, static_cast<unsigned int>(instance.firstVertex), job.begin, job.end);
 		}
-	}
+		else
+		{
+			VertexProcessing(instance.mesh, layout, vertexOutput + instance.firstVertex * layout.stride, job.begin, job.end);
+		}
+	});
 }
 
-void NodeProcessing(
+// Converts the meshes of every node into one vertex / index soup, returns the number of mesh instances converted
+size_t SceneProcessing(
 	const aiScene* scene,
-	const aiNode* node,
-	std::vector<glm::vec3>& positions,
-	std::vector<glm::vec2>& uvs,
-	std::vector<glm::vec3>& normals,
-	std::vector<glm::vec3>& tangents,
-	std::vector<glm::vec3>& bitangents,
+	const VertexLayout& layout,
+	std::vector<unsigned char>& vertexData,
 	std::vector<unsigned int>& indices)
 {
-	// process each mesh located at the current node
-	for (unsigned int i = 0; i < node->mNumMeshes; i++)
+	std::vector<MeshInstance> instances = GatherMeshInstances(scene);
+	ConvertMeshInstances(instances, layout, vertexData, indices);
+	return instances.size();
+}
+
+glm::mat4 ToGlmMatrix(const aiMatrix4x4& matrix)
+{
+	// aiMatrix4x4 is row major, glm column major
+	glm::mat4 result;
+	for (unsigned int row = 0; row < 4; ++row)
 	{
-		// the node object only contains indices to index the actual objects in the scene. 
-		// the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-		MeshProcessing(mesh, scene, positions, uvs, normals, tangents, bitangents, indices);
+		for (unsigned int column = 0; column < 4; ++column)
+		{
+			result[column][row] = matrix[row][column];
+		}
 	}
-	// after we've processed all of the meshes (if any) we then recursively process each of the children nodes
-	for (unsigned int i = 0; i < node->mNumChildren; i++)
+	return result;
+}
+
+// Node hierarchy in topological order, with the meshes every node draws
+void FlattenSceneNodes(const aiScene* scene, SceneData& sceneData)
+{
+	// pre-order walk: a node is always appended after its parent
+	std::vector<std::pair<const aiNode*, int32_t>> pendingNodes = { { scene->mRootNode, -1 } };
+	while (!pendingNodes.empty())
 	{
-		NodeProcessing(scene, node->mChildren[i], positions, uvs, normals, tangents, bitangents, indices);
+		const aiNode* node = pendingNodes.back().first;
+		const int32_t parent = pendingNodes.back().second;
+		pendingNodes.pop_back();
+
+		const uint32_t nodeIndex = static_cast<uint32_t>(sceneData.nodeParents.size());
+		sceneData.nodeParents.push_back(parent);
+		sceneData.nodeLocalTransforms.push_back(ToGlmMatrix(node->mTransformation));
+		sceneData.nodeNames.push_back(node->mName.C_Str());
+
+		for (unsigned int i = 0; i < node->mNumMeshes; i++)
+		{
+			sceneData.drawNodes.push_back(nodeIndex);
+			sceneData.drawSubmeshes.push_back(node->mMeshes[i]);
+		}
+		// pushed in reverse so the first child is visited next
+		for (unsigned int i = node->mNumChildren; i > 0; i--)
+		{
+			pendingNodes.push_back({ node->mChildren[i - 1], static_cast<int32_t>(nodeIndex) });
+		}
 	}
+
+	sceneData.UpdateWorldTransforms();
 }
 
-void SceneProcessing(
+void MaterialProcessing(const aiScene* scene, SceneData& sceneData)
+{
+	for (unsigned int m = 0; m < scene->mNumMaterials; m++)
+	{
+		const aiMaterial* material = scene->mMaterials[m];
+
+		aiString name;
+		material->Get(AI_MATKEY_NAME, name);
+		sceneData.materialNames.push_back(name.C_Str());
+
+		aiColor3D diffuse(1.0f, 1.0f, 1.0f);
+		material->Get(AI_MATKEY_COLOR_DIFFUSE, diffuse);
+		sceneData.materialBaseColors.push_back(glm::vec3(diffuse.r, diffuse.g, diffuse.b));
+
+		aiString albedoPath;
+		material->GetTexture(aiTextureType_DIFFUSE, 0, &albedoPath);
+		sceneData.materialAlbedoTextures.push_back(albedoPath.C_Str());
+
+		aiString normalPath;
+		material->GetTexture(aiTextureType_NORMALS, 0, &normalPath);
+		sceneData.materialNormalTextures.push_back(normalPath.C_Str());
+	}
+}
+
+// Every mesh of the file once, as a submesh of the shared buffers, in scene->mMeshes order
+void SubmeshProcessing(
 	const aiScene* scene,
-	std::vector<glm::vec3>& positions,
-	std::vector<glm::vec2>& uvs,
-	std::vector<glm::vec3>& normals,
-	std::vector<glm::vec3>& tangents,
-	std::vector<glm::vec3>& bitangents,
+	const VertexLayout& layout,
+	SceneData& sceneData,
+	std::vector<unsigned char>& vertexData,
 	std::vector<unsigned int>& indices)
 {
-	NodeProcessing(scene, scene->mRootNode, positions, uvs, normals, tangents, bitangents, indices);
+	std::vector<MeshInstance> instances;
+	instances.reserve(scene->mNumMeshes);
+	for (unsigned int m = 0; m < scene->mNumMeshes; m++)
+	{
+		instances.push_back({ scene->mMeshes[m], 0, 0 });
+	}
+	ConvertMeshInstances(instances, layout, vertexData, indices);
+
+	for (const MeshInstance& instance : instances)
+	{
+		sceneData.submeshFirstVertex.push_back(static_cast<uint32_t>(instance.firstVertex));
+		sceneData.submeshVertexCount.push_back(instance.mesh->mNumVertices);
+		sceneData.submeshFirstIndex.push_back(static_cast<uint32_t>(instance.firstIndex));
+		sceneData.submeshIndexCount.push_back(static_cast<uint32_t>(CountMeshIndices(instance.mesh)));
+		sceneData.submeshMaterials.push_back(instance.mesh->mMaterialIndex);
+	}
+}
+
+// Vertex cache order within every triangle submesh, the ranges stay where they are
+void OptimizeSubmeshes(const SceneData& sceneData, std::vector<unsigned int>& indices)
+{
+	ThreadPool::GetShared().ParallelFor(sceneData.GetSubmeshCount(), [&](size_t submesh)
+	{
+		const uint32_t firstVertex = sceneData.submeshFirstVertex[submesh];
+		const uint32_t firstIndex = sceneData.submeshFirstIndex[submesh];
+		const uint32_t indexCount = sceneData.submeshIndexCount[submesh];
+		if (indexCount == 0 || indexCount % 3 != 0)
+		{
+			return;
+		}
+
+		// the vertices of a submesh are contiguous, optimize with submesh local indices to keep the work arrays small
+		std::vector<unsigned int> submeshIndices(indices.begin() + firstIndex, indices.begin() + firstIndex + indexCount);
+		for (unsigned int& index : submeshIndices)
+		{
+			index -= firstVertex;
+		}
+		MeshOptimizer::OptimizeVertexCache(submeshIndices, sceneData.submeshVertexCount[submesh]);
+		for (size_t n = 0; n < indexCount; ++n)
+		{
+			indices[firstIndex + n] = submeshIndices[n] + firstVertex;
+		}
+	});
+}
+
+double ImportMillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Splits Importer::ReadFile time into the file parsing and each post processing step.
+// Assimp calls UpdatePostProcess before every registered step (inactive ones included) and once more when all are done.
+class ImportStepTimer : public Assimp::ProgressHandler
+{
+public:
+	explicit ImportStepTimer(MeshImportReport& report)
+		: report(report), stepStart(std::chrono::steady_clock::now())
+	{
+	}
+
+	bool Update(float /*percentage*/) override
+	{
+		return true;
+	}
+
+	void UpdatePostProcess(int currentStep, int numberOfSteps) override
+	{
+		const double milliseconds = ImportMillisecondsSince(stepStart);
+		if (runningStep < 0)
+		{
+			report.readFileTime = milliseconds;
+		}
+		else
+		{
+			report.postProcessTime += milliseconds;
+			// inactive steps only cost their flag test
+			if (milliseconds >= 0.01)
+			{
+				report.postProcessSteps.push_back({ runningStep, milliseconds });
+			}
+		}
+
+		runningStep = currentStep < numberOfSteps ? currentStep : -1;
+		stepStart = std::chrono::steady_clock::now();
+	}
+
+private:
+	MeshImportReport& report;
+	std::chrono::steady_clock::time_point stepStart;
+	int runningStep = -1;
+};
+
+// Counts and sizes of what the import produced, plus the memory high water mark
+void FillImportReportOutput(
+	MeshImportReport& report,
+	const std::vector<unsigned char>& vertexData,
+	const std::vector<unsigned int>& indices,
+	const VertexLayout& layout,
+	const MeshletData* meshletData,
+	const MeshLodChain* lodChain)
+{
+	report.vertexCount = vertexData.size() / layout.stride;
+	report.indexCount = indices.size();
+	report.outputBytes = vertexData.capacity() + indices.capacity() * sizeof(unsigned int);
+	if (meshletData)
+	{
+		report.meshletCount = meshletData->meshlets.size();
+		report.outputBytes += meshletData->meshlets.capacity() * sizeof(Meshlet) +
+			meshletData->vertices.capacity() * sizeof(unsigned int) + meshletData->triangles.capacity();
+	}
+	if (lodChain)
+	{
+		report.lodCount = lodChain->levels.size();
+		report.outputBytes += lodChain->levels.capacity() * sizeof(MeshLod) + lodChain->indices.capacity() * sizeof(unsigned int);
+	}
+	report.peakResidentBytes = MeshImportReport::GetPeakResidentBytes();
+}
+
+bool AreIndicesInRange(const unsigned int* indices, size_t indexCount, size_t vertexCount)
+{
+	for (size_t n = 0; n < indexCount; ++n)
+	{
+		if (indices[n] >= vertexCount)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool LoadFromMeshCache(
+	const MeshCache::Key& cacheKey,
+	const VertexLayout& layout,
+	std::vector<unsigned char>& vertexData,
+	std::vector<unsigned int>& indices,
+	MeshletData* meshletData,
+	MeshLodChain* lodChain)
+{
+	MeshCache cache;
+	if (!cache.Open(cacheKey))
+	{
+		return false;
+	}
+
+	// the vertices are stored interleaved, so they are only usable with the exact same layout
+	size_t layoutCount = 0, vertexBytes = 0, indexCount = 0;
+	const VertexLayout* cachedLayout = static_cast<const VertexLayout*>(cache.GetChunk(MeshCache::CHUNK_VERTEX_LAYOUT, sizeof(VertexLayout), layoutCount));
+	const unsigned char* cachedVertices = static_cast<const unsigned char*>(cache.GetChunk(MeshCache::CHUNK_VERTICES, 1, vertexBytes));
+	const unsigned int* cachedIndices = static_cast<const unsigned int*>(cache.GetChunk(MeshCache::CHUNK_INDICES, sizeof(unsigned int), indexCount));
+	if (cachedLayout == nullptr || layoutCount != 1 || memcmp(cachedLayout, &layout, sizeof(VertexLayout)) != 0 ||
+		cachedVertices == nullptr || cachedIndices == nullptr)
+	{
+		return false;
+	}
+
+	size_t meshletCount = 0, meshletVertexCount = 0, meshletTriangleBytes = 0;
+	const Meshlet* cachedMeshlets = nullptr;
+	const unsigned int* cachedMeshletVertices = nullptr;
+	const unsigned char* cachedMeshletTriangles = nullptr;
+	if (meshletData)
+	{
+		cachedMeshlets = static_cast<const Meshlet*>(cache.GetChunk(MeshCache::CHUNK_MESHLETS, sizeof(Meshlet), meshletCount));
+		cachedMeshletVertices = static_cast<const unsigned int*>(cache.GetChunk(MeshCache::CHUNK_MESHLET_VERTICES, sizeof(unsigned int), meshletVertexCount));
+		cachedMeshletTriangles = static_cast<const unsigned char*>(cache.GetChunk(MeshCache::CHUNK_MESHLET_TRIANGLES, 1, meshletTriangleBytes));
+		if (cachedMeshlets == nullptr || cachedMeshletVertices == nullptr || cachedMeshletTriangles == nullptr)
+		{
+			return false;
+		}
+	}
+
+	size_t lodCount = 0, lodIndexCount = 0, lodBoundsCount = 0;
+	const MeshLod* cachedLods = nullptr;
+	const unsigned int* cachedLodIndices = nullptr;
+	const glm::vec4* cachedLodBounds = nullptr;
+	if (lodChain)
+	{
+		cachedLods = static_cast<const MeshLod*>(cache.GetChunk(MeshCache::CHUNK_LODS, sizeof(MeshLod), lodCount));
+		cachedLodIndices = static_cast<const unsigned int*>(cache.GetChunk(MeshCache::CHUNK_LOD_INDICES, sizeof(unsigned int), lodIndexCount));
+		cachedLodBounds = static_cast<const glm::vec4*>(cache.GetChunk(MeshCache::CHUNK_LOD_BOUNDS, sizeof(glm::vec4), lodBoundsCount));
+		if (cachedLods == nullptr || cachedLodIndices == nullptr || cachedLodBounds == nullptr || lodBoundsCount != 1)
+		{
+			return false;
+		}
+	}
+
+	// the key only proves what the file was built from, not that its arrays survived: a mesh indexing past its vertices
+	// is a miss, the reimport rewrites the file
+	const size_t vertexCount = vertexBytes / layout.stride;
+	if (vertexBytes % layout.stride != 0 || !AreIndicesInRange(cachedIndices, indexCount, vertexCount) ||
+		(meshletData && !AreIndicesInRange(cachedMeshletVertices, meshletVertexCount, vertexCount)) ||
+		(lodChain && !AreIndicesInRange(cachedLodIndices, lodIndexCount, vertexCount)))
+	{
+		std::cout << "ERROR::MESH_CACHE::INVALID_DATA " << MeshCache::GetCachePath(cacheKey.sourcePath) << std::endl;
+		return false;
+	}
+
+	// copy straight out of the mapping
+	vertexData.assign(cachedVertices, cachedVertices + vertexBytes);
+	indices.assign(cachedIndices, cachedIndices + indexCount);
+	if (meshletData)
+	{
+		meshletData->meshlets.assign(cachedMeshlets, cachedMeshlets + meshletCount);
+		meshletData->vertices.assign(cachedMeshletVertices, cachedMeshletVertices + meshletVertexCount);
+		meshletData->triangles.assign(cachedMeshletTriangles, cachedMeshletTriangles + meshletTriangleBytes);
+	}
+	if (lodChain)
+	{
+		lodChain->levels.assign(cachedLods, cachedLods + lodCount);
+		lodChain->indices.assign(cachedLodIndices, cachedLodIndices + lodIndexCount);
+		lodChain->boundsCenter = glm::vec3(*cachedLodBounds);
+		lodChain->boundsRadius = cachedLodBounds->w;
+	}
+	return true;
 }
 
 // http://assimp.sourceforge.net/lib_html/usage.html
 bool AssimpHelper::ImportMesh(
 	const std::string& pFile,
-	std::vector<glm::vec3>& vertices,
-	std::vector<glm::vec2>& uvs,
-	std::vector<glm::vec3>& normals,
+	const VertexLayout& layout,
+	std::vector<unsigned char>& vertexData,
 	std::vector<unsigned int>& indices,
-	std::vector<glm::vec3>& tangents,
-	std::vector<glm::vec3>& bitangents)
+	uint32_t importFlags,
+	MeshImportReport* report,
+	MeshletData* meshletData,
+	MeshLodChain* lodChain)
 {
-	// Create an instance of the Importer class
-	Assimp::Importer importer;
-	// And have it read the given file with some example postprocessing
+	if (!IsVertexLayoutValid(layout))
+	{
+		std::cout << "ERROR::ASSIMP_HELPER::INVALID_VERTEX_LAYOUT " << pFile << std::endl;
+		return false;
+	}
+
+	const std::chrono::steady_clock::time_point importStart = std::chrono::steady_clock::now();
+
+	// everything is measured, it is only copied out when the caller asked for it
+	MeshImportReport importReport;
+	importReport.sourcePath = pFile;
+
 	// Usually - if speed is not the most important aspect for you - you'll 
 	// propably to request more postprocessing than we do in this example.
-	const aiScene* scene = importer.ReadFile(pFile,
+	const unsigned int postProcessFlags =
 		aiProcess_CalcTangentSpace |
 		aiProcess_Triangulate |
 		aiProcess_JoinIdenticalVertices |
-		aiProcess_SortByPType);
+		aiProcess_SortByPType;
+
+	// Try the binary cache first, it is rebuilt whenever the source file or the flags change
+	MeshCache::Key cacheKey;
+	const bool hasCacheKey = MeshCache::ComputeKey(pFile, postProcessFlags, importFlags, cacheKey);
+	MeshletData* cachedMeshletData = (importFlags & MESH_IMPORT_MESHLETS) ? meshletData : nullptr;
+	MeshLodChain* cachedLodChain = (importFlags & MESH_IMPORT_LODS) ? lodChain : nullptr;
+	if (hasCacheKey && LoadFromMeshCache(cacheKey, layout, vertexData, indices, cachedMeshletData, cachedLodChain))
+	{
+		if (report)
+		{
+			importReport.isFromCache = true;
+			importReport.cacheLoadTime = ImportMillisecondsSince(importStart);
+			importReport.totalTime = importReport.cacheLoadTime;
+			FillImportReportOutput(importReport, vertexData, indices, layout, cachedMeshletData, cachedLodChain);
+			*report = std::move(importReport);
+		}
+		return true;
+	}
+
+	// Create an instance of the Importer class
+	Assimp::Importer importer;
+	ImportStepTimer stepTimer(importReport);
+	importer.SetProgressHandler(&stepTimer);
+	// And have it read the given file with some example postprocessing
+	const aiScene* scene = importer.ReadFile(pFile, postProcessFlags);
+	// the importer deletes its progress handler unless it is replaced by the default one first
+	importer.SetProgressHandler(nullptr);
 
 	// If the import failed, report it
 	if (!scene)
@@ -142,10 +591,147 @@ bool AssimpHelper::ImportMesh(
 		return false;
 	}
 	// Now we can access the file's contents. 
-	SceneProcessing(scene, vertices, uvs, normals, tangents, bitangents, indices);
+	std::chrono::steady_clock::time_point stageStart = std::chrono::steady_clock::now();
+	importReport.meshCount = SceneProcessing(scene, layout, vertexData, indices);
+	importReport.conversionTime = ImportMillisecondsSince(stageStart);
+
+	// the overdraw pass needs the positions
+	if ((importFlags & MESH_IMPORT_OPTIMIZE) && layout.positionOffset >= 0)
+	{
+		stageStart = std::chrono::steady_clock::now();
+		importReport.optimization = MeshOptimizer::OptimizeMesh(vertexData, layout.stride, layout.positionOffset, indices);
+		importReport.isOptimized = true;
+		importReport.optimizationTime = ImportMillisecondsSince(stageStart);
+	}
+
+	// built after the optimization so that the clusters follow the optimized triangle order
+	MeshletData meshlets;
+	if ((importFlags & MESH_IMPORT_MESHLETS) && layout.positionOffset >= 0)
+	{
+		stageStart = std::chrono::steady_clock::now();
+		MeshletBuilder::BuildMeshlets(meshlets, indices, vertexData.data(), layout.stride, layout.positionOffset);
+		importReport.meshletTime = ImportMillisecondsSince(stageStart);
+	}
+
+	// simplified from the optimized mesh, every level gets its own vertex cache order
+	MeshLodChain lods;
+	if ((importFlags & MESH_IMPORT_LODS) && layout.positionOffset >= 0)
+	{
+		stageStart = std::chrono::steady_clock::now();
+		MeshSimplifier::BuildLodChain(lods, indices, vertexData.data(), layout.stride, layout.positionOffset, vertexData.size() / layout.stride);
+		importReport.lodTime = ImportMillisecondsSince(stageStart);
+	}
+
+	if (hasCacheKey)
+	{
+		stageStart = std::chrono::steady_clock::now();
+		std::vector<MeshCache::Chunk> chunks = {
+			{ MeshCache::CHUNK_VERTEX_LAYOUT, sizeof(VertexLayout), &layout, 1 },
+			{ MeshCache::CHUNK_VERTICES, 1, vertexData.data(), vertexData.size() },
+			{ MeshCache::CHUNK_INDICES, sizeof(unsigned int), indices.data(), indices.size() },
+		};
+		if (importFlags & MESH_IMPORT_MESHLETS)
+		{
+			chunks.push_back({ MeshCache::CHUNK_MESHLETS, sizeof(Meshlet), meshlets.meshlets.data(), meshlets.meshlets.size() });
+			chunks.push_back({ MeshCache::CHUNK_MESHLET_VERTICES, sizeof(unsigned int), meshlets.vertices.data(), meshlets.vertices.size() });
+			chunks.push_back({ MeshCache::CHUNK_MESHLET_TRIANGLES, 1, meshlets.triangles.data(), meshlets.triangles.size() });
+		}
+		const glm::vec4 lodBounds(lods.boundsCenter, lods.boundsRadius);
+		if (importFlags & MESH_IMPORT_LODS)
+		{
+			chunks.push_back({ MeshCache::CHUNK_LODS, sizeof(MeshLod), lods.levels.data(), lods.levels.size() });
+			chunks.push_back({ MeshCache::CHUNK_LOD_INDICES, sizeof(unsigned int), lods.indices.data(), lods.indices.size() });
+			chunks.push_back({ MeshCache::CHUNK_LOD_BOUNDS, sizeof(glm::vec4), &lodBounds, 1 });
+		}
+		MeshCache::Write(cacheKey, chunks);
+		importReport.cacheWriteTime = ImportMillisecondsSince(stageStart);
+	}
+
+	if (report)
+	{
+		importReport.totalTime = ImportMillisecondsSince(importStart);
+		FillImportReportOutput(importReport, vertexData, indices, layout, &meshlets, &lods);
+		*report = std::move(importReport);
+	}
+
+	if (meshletData)
+	{
+		*meshletData = std::move(meshlets);
+	}
+	if (lodChain)
+	{
+		*lodChain = std::move(lods);
+	}
 
 	// We're done. Everything will be cleaned up by the importer destructor
 	return true;
 }
 
+bool AssimpHelper::ImportScene(
+	const std::string& pFile,
+	const VertexLayout& layout,
+	SceneData& sceneData,
+	std::vector<unsigned char>& vertexData,
+	std::vector<unsigned int>& indices,
+	uint32_t importFlags,
+	MeshImportReport* report)
+{
+	if (!IsVertexLayoutValid(layout))
+	{
+		std::cout << "ERROR::ASSIMP_HELPER::INVALID_VERTEX_LAYOUT " << pFile << std::endl;
+		return false;
+	}
+
+	const std::chrono::steady_clock::time_point importStart = std::chrono::steady_clock::now();
+
+	MeshImportReport importReport;
+	importReport.sourcePath = pFile;
+
+	// same processing as ImportMesh
+	const unsigned int postProcessFlags =
+		aiProcess_CalcTangentSpace |
+		aiProcess_Triangulate |
+		aiProcess_JoinIdenticalVertices |
+		aiProcess_SortByPType;
+
+	Assimp::Importer importer;
+	ImportStepTimer stepTimer(importReport);
+	importer.SetProgressHandler(&stepTimer);
+	const aiScene* scene = importer.ReadFile(pFile, postProcessFlags);
+	// the importer deletes its progress handler unless it is replaced by the default one first
+	importer.SetProgressHandler(nullptr);
+
+	if (!scene)
+	{
+		std::cout << "Assimp loading error::\n" << importer.GetErrorString() << std::endl;
+		return false;
+	}
+
+	std::chrono::steady_clock::time_point stageStart = std::chrono::steady_clock::now();
+	sceneData = SceneData();
+	SubmeshProcessing(scene, layout, sceneData, vertexData, indices);
+	FlattenSceneNodes(scene, sceneData);
+	MaterialProcessing(scene, sceneData);
+	importReport.meshCount = sceneData.GetSubmeshCount();
+	importReport.conversionTime = ImportMillisecondsSince(stageStart);
+
+	if (importFlags & MESH_IMPORT_OPTIMIZE)
+	{
+		stageStart = std::chrono::steady_clock::now();
+		importReport.optimization.before = MeshOptimizer::AnalyzeVertexCache(indices, vertexData.size() / layout.stride);
+		OptimizeSubmeshes(sceneData, indices);
+		importReport.optimization.after = MeshOptimizer::AnalyzeVertexCache(indices, vertexData.size() / layout.stride);
+		importReport.isOptimized = true;
+		importReport.optimizationTime = ImportMillisecondsSince(stageStart);
+	}
+
+	if (report)
+	{
+		importReport.totalTime = ImportMillisecondsSince(importStart);
+		FillImportReportOutput(importReport, vertexData, indices, layout, nullptr, nullptr);
+		*report = std::move(importReport);
+	}
+	return true;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
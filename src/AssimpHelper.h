@@ -1,20 +1,74 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
 #include <vector>
 
 #include <glm/glm.hpp>
 
+#include "MeshImportReport.h"
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "SceneData.h"
+
+// Describes where each attribute is written inside one interleaved vertex.
+// Offsets are in bytes from the start of the vertex, -1 means the attribute is not written.
+// position, color, normal, tangent and bitangent are written as 3 floats, uv as 2 floats.
+struct VertexLayout
+{
+	uint32_t stride = 0;
+	int32_t positionOffset = -1;
+	int32_t colorOffset = -1;
+	int32_t uvOffset = -1;
+	int32_t normalOffset = -1;
+	int32_t tangentOffset = -1;
+	int32_t bitangentOffset = -1;
+};
+
+// Optional processing ImportMesh runs after the conversion, its result is stored in the mesh cache as well
+enum MeshImportFlags : uint32_t
+{
+	MESH_IMPORT_NONE = 0,
+	// Reorder the triangles for the vertex cache and overdraw, then the vertices for fetch locality (see MeshOptimizer)
+	MESH_IMPORT_OPTIMIZE = 1 << 0,
+	// Split the triangles into meshlets with culling bounds (see MeshletBuilder)
+	MESH_IMPORT_MESHLETS = 1 << 1,
+	// Simplify the mesh into a chain of levels of detail (see MeshSimplifier)
+	MESH_IMPORT_LODS = 1 << 2,
+};
+
 class AssimpHelper
 {
 public:
 
+	// Imports every mesh of the file straight into an interleaved vertex buffer described by layout.
+	// vertexData (stride * vertex count bytes) and indices are replaced, each of them is allocated once.
+	// importFlags is a combination of MeshImportFlags. report receives the stage timings and output sizes (the
+	// optimization statistics only when the optimization actually ran, i.e. not when the mesh came from the cache,
+	// and uploadTime is left to the caller). meshletData receives the meshlets
+	// when MESH_IMPORT_MESHLETS is set (built from the full resolution mesh) and lodChain the levels of detail when
+	// MESH_IMPORT_LODS is set.
+	// Fails without reading the file when the layout stride is 0 or an attribute of the layout ends past the stride.
 	static bool ImportMesh(const std::string& pFile,
-		std::vector<glm::vec3>& vertices,
-		std::vector<glm::vec2>& uvs,
-		std::vector<glm::vec3>& normals,
+		const VertexLayout& layout,
+		std::vector<unsigned char>& vertexData,
+		std::vector<unsigned int>& indices,
+		uint32_t importFlags = MESH_IMPORT_NONE,
+		MeshImportReport* report = nullptr,
+		MeshletData* meshletData = nullptr,
+		MeshLodChain* lodChain = nullptr);
+
+	// Imports the file keeping its structure: every mesh once, as a submesh of one shared vertex and index buffer,
+	// plus the node hierarchy, transforms and materials in sceneData (node transforms are not baked into the vertices).
+	// Of the importFlags only MESH_IMPORT_OPTIMIZE applies (vertex cache order within each submesh). Not cached.
+	// The layout is checked like ImportMesh does.
+	static bool ImportScene(const std::string& pFile,
+		const VertexLayout& layout,
+		SceneData& sceneData,
+		std::vector<unsigned char>& vertexData,
 		std::vector<unsigned int>& indices,
-		std::vector<glm::vec3>& tangents = std::vector<glm::vec3>(),
-		std::vector<glm::vec3>& bitangents = std::vector<glm::vec3>());
+		uint32_t importFlags = MESH_IMPORT_NONE,
+		MeshImportReport* report = nullptr);
 
-};
\ No newline at end of file
+};
@@ -0,0 +1,506 @@
+#include "BlockCompressor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLOCK_COMPRESSOR_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#include "ThreadPool.h"
+
+// Texels of a 4x4 block for BC1, one array per channel so that 4 texels fit an SSE register
+struct ColorBlock
+{
+	alignas(16) float r[16];
+	alignas(16) float g[16];
+	alignas(16) float b[16];
+};
+
+// Texel (x, y) clamped to the image, so partial blocks on the right / bottom edge repeat the last column / row
+const unsigned char* GetBlockTexel(const unsigned char* pixels, uint32_t width, uint32_t height, uint32_t channels, uint32_t x, uint32_t y)
+{
+	return pixels + (size_t(std::min(y, height - 1)) * width + std::min(x, width - 1)) * channels;
+}
+
+void LoadColorBlock(ColorBlock& block, const unsigned char* pixels, uint32_t width, uint32_t height, uint32_t channels, uint32_t blockX, uint32_t blockY)
+{
+	for (uint32_t n = 0; n < 16; ++n)
+	{
+		const unsigned char* texel = GetBlockTexel(pixels, width, height, channels, blockX * 4 + n % 4, blockY * 4 + n / 4);
+		block.r[n] = texel[0];
+		block.g[n] = texel[1];
+		block.b[n] = texel[2];
+	}
+}
+
+void LoadChannelBlock(unsigned char values[16], const unsigned char* pixels, uint32_t width, uint32_t height, uint32_t channels, uint32_t channel, uint32_t blockX, uint32_t blockY)
+{
+	for (uint32_t n = 0; n < 16; ++n)
+	{
+		values[n] = GetBlockTexel(pixels, width, height, channels, blockX * 4 + n % 4, blockY * 4 + n / 4)[channel];
+	}
+}
+
+uint16_t PackRgb565(const float color[3])
+{
+	const int r = std::min(std::max(static_cast<int>(color[0] * (31.0f / 255.0f) + 0.5f), 0), 31);
+	const int g = std::min(std::max(static_cast<int>(color[1] * (63.0f / 255.0f) + 0.5f), 0), 63);
+	const int b = std::min(std::max(static_cast<int>(color[2] * (31.0f / 255.0f) + 0.5f), 0), 31);
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void UnpackRgb565(uint16_t color, int rgb[3])
+{
+	const int r = (color >> 11) & 31;
+	const int g = (color >> 5) & 63;
+	const int b = color & 31;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+// Palette the decoder derives from the two endpoints, 4 color mode when color0 > color1, 3 color + black otherwise
+void GetBC1Palette(uint16_t color0, uint16_t color1, int palette[4][3])
+{
+	UnpackRgb565(color0, palette[0]);
+	UnpackRgb565(color1, palette[1]);
+	for (int c = 0; c < 3; ++c)
+	{
+		if (color0 > color1)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		else
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+}
+
+// Nearest palette entry of every texel, returns the summed squared error
+float FindBC1Indices(const ColorBlock& block, const int palette[4][3], uint32_t& indices)
+{
+	indices = 0;
+	float error = 0.0f;
+
+#ifdef BLOCK_COMPRESSOR_SSE2
+	for (int n = 0; n < 16; n += 4)
+	{
+		const __m128 r = _mm_load_ps(&block.r[n]);
+		const __m128 g = _mm_load_ps(&block.g[n]);
+		const __m128 b = _mm_load_ps(&block.b[n]);
+		__m128 bestDistance = _mm_set1_ps(std::numeric_limits<float>::max());
+		__m128i bestIndex = _mm_setzero_si128();
+		for (int p = 0; p < 4; ++p)
+		{
+			const __m128 dr = _mm_sub_ps(r, _mm_set1_ps(static_cast<float>(palette[p][0])));
+			const __m128 dg = _mm_sub_ps(g, _mm_set1_ps(static_cast<float>(palette[p][1])));
+			const __m128 db = _mm_sub_ps(b, _mm_set1_ps(static_cast<float>(palette[p][2])));
+			const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+			const __m128i isCloser = _mm_castps_si128(_mm_cmplt_ps(distance, bestDistance));
+			bestDistance = _mm_min_ps(distance, bestDistance);
+			bestIndex = _mm_or_si128(_mm_and_si128(isCloser, _mm_set1_epi32(p)), _mm_andnot_si128(isCloser, bestIndex));
+		}
+
+		alignas(16) int32_t laneIndices[4];
+		alignas(16) float laneDistances[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(laneIndices), bestIndex);
+		_mm_store_ps(laneDistances, bestDistance);
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			indices |= uint32_t(laneIndices[lane]) << (2 * (n + lane));
+			error += laneDistances[lane];
+		}
+	}
+#else
+	for (int n = 0; n < 16; ++n)
+	{
+		float bestDistance = std::numeric_limits<float>::max();
+		uint32_t bestIndex = 0;
+		for (uint32_t p = 0; p < 4; ++p)
+		{
+			const float dr = block.r[n] - palette[p][0];
+			const float dg = block.g[n] - palette[p][1];
+			const float db = block.b[n] - palette[p][2];
+			const float distance = dr * dr + dg * dg + db * db;
+			if (distance < bestDistance)
+			{
+				bestDistance = distance;
+				bestIndex = p;
+			}
+		}
+		indices |= bestIndex << (2 * n);
+		error += bestDistance;
+	}
+#endif
+
+	return error;
+}
+
+// Encodes block with the given endpoints into output, returns the squared error
+float EncodeBC1Endpoints(const ColorBlock& block, const float endpoint0[3], const float endpoint1[3], unsigned char output[8])
+{
+	uint16_t color0 = PackRgb565(endpoint0);
+	uint16_t color1 = PackRgb565(endpoint1);
+	// 4 color mode needs color0 > color1, with equal endpoints every index picks color0 anyway
+	if (color0 < color1)
+	{
+		std::swap(color0, color1);
+	}
+
+	int palette[4][3];
+	GetBC1Palette(color0, color1, palette);
+	uint32_t indices;
+	const float error = FindBC1Indices(block, palette, indices);
+
+	memcpy(output, &color0, 2);
+	memcpy(output + 2, &color1, 2);
+	memcpy(output + 4, &indices, 4);
+	return error;
+}
+
+// Endpoints from the principal axis of the block colors, then one least squares refit of the endpoints to the chosen indices
+void EncodeBC1Block(const ColorBlock& block, unsigned char output[8])
+{
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for (int n = 0; n < 16; ++n)
+	{
+		mean[0] += block.r[n];
+		mean[1] += block.g[n];
+		mean[2] += block.b[n];
+	}
+	for (float& channel : mean)
+	{
+		channel /= 16.0f;
+	}
+
+	float covariance[6] = {};	// rr, rg, rb, gg, gb, bb
+	for (int n = 0; n < 16; ++n)
+	{
+		const float r = block.r[n] - mean[0];
+		const float g = block.g[n] - mean[1];
+		const float b = block.b[n] - mean[2];
+		covariance[0] += r * r;
+		covariance[1] += r * g;
+		covariance[2] += r * b;
+		covariance[3] += g * g;
+		covariance[4] += g * b;
+		covariance[5] += b * b;
+	}
+
+	// power iteration converges to the dominant eigenvector in a few steps for 3x3
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for (int iteration = 0; iteration < 8; ++iteration)
+	{
+		const float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+		const float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+		const float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+		const float length = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+		if (length == 0.0f)
+		{
+			break;
+		}
+		axis[0] = x / length;
+		axis[1] = y / length;
+		axis[2] = z / length;
+	}
+	const float axisLengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+	float minT = 0.0f;
+	float maxT = 0.0f;
+	for (int n = 0; n < 16; ++n)
+	{
+		const float t = ((block.r[n] - mean[0]) * axis[0] + (block.g[n] - mean[1]) * axis[1] + (block.b[n] - mean[2]) * axis[2]) / axisLengthSquared;
+		minT = std::min(minT, t);
+		maxT = std::max(maxT, t);
+	}
+
+	float endpoint0[3];
+	float endpoint1[3];
+	for (int c = 0; c < 3; ++c)
+	{
+		endpoint0[c] = std::min(std::max(mean[c] + axis[c] * maxT, 0.0f), 255.0f);
+		endpoint1[c] = std::min(std::max(mean[c] + axis[c] * minT, 0.0f), 255.0f);
+	}
+
+	const float error = EncodeBC1Endpoints(block, endpoint0, endpoint1, output);
+	if (error == 0.0f)
+	{
+		return;
+	}
+
+	// refit: weights of endpoint0 / endpoint1 for every index in 4 color mode
+	uint16_t color0;
+	uint16_t color1;
+	uint32_t indices;
+	memcpy(&color0, output, 2);
+	memcpy(&color1, output + 2, 2);
+	memcpy(&indices, output + 4, 4);
+	if (color0 == color1)
+	{
+		return;
+	}
+
+	const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+	float alphaAlpha = 0.0f;
+	float betaBeta = 0.0f;
+	float alphaBeta = 0.0f;
+	float alphaColor[3] = {};
+	float betaColor[3] = {};
+	for (int n = 0; n < 16; ++n)
+	{
+		const float alpha = weights[(indices >> (2 * n)) & 3];
+		const float beta = 1.0f - alpha;
+		alphaAlpha += alpha * alpha;
+		betaBeta += beta * beta;
+		alphaBeta += alpha * beta;
+		const float color[3] = { block.r[n], block.g[n], block.b[n] };
+		for (int c = 0; c < 3; ++c)
+		{
+			alphaColor[c] += alpha * color[c];
+			betaColor[c] += beta * color[c];
+		}
+	}
+
+	const float determinant = alphaAlpha * betaBeta - alphaBeta * alphaBeta;
+	if (std::fabs(determinant) < 1e-6f)
+	{
+		return;
+	}
+
+	float refit0[3];
+	float refit1[3];
+	for (int c = 0; c < 3; ++c)
+	{
+		refit0[c] = std::min(std::max((betaBeta * alphaColor[c] - alphaBeta * betaColor[c]) / determinant, 0.0f), 255.0f);
+		refit1[c] = std::min(std::max((alphaAlpha * betaColor[c] - alphaBeta * alphaColor[c]) / determinant, 0.0f), 255.0f);
+	}
+
+	unsigned char refitOutput[8];
+	if (EncodeBC1Endpoints(block, refit0, refit1, refitOutput) < error)
+	{
+		memcpy(output, refitOutput, 8);
+	}
+}
+
+// 8 value mode: endpoint0 = max, endpoint1 = min, the 6 others evenly spaced in between
+void EncodeBC4Block(const unsigned char values[16], unsigned char output[8])
+{
+	uint32_t levels[16];
+
+#ifdef BLOCK_COMPRESSOR_SSE2
+	const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values));
+	__m128i minimum = _mm_min_epu8(bytes, _mm_srli_si128(bytes, 8));
+	minimum = _mm_min_epu8(minimum, _mm_srli_si128(minimum, 4));
+	minimum = _mm_min_epu8(minimum, _mm_srli_si128(minimum, 2));
+	minimum = _mm_min_epu8(minimum, _mm_srli_si128(minimum, 1));
+	__m128i maximum = _mm_max_epu8(bytes, _mm_srli_si128(bytes, 8));
+	maximum = _mm_max_epu8(maximum, _mm_srli_si128(maximum, 4));
+	maximum = _mm_max_epu8(maximum, _mm_srli_si128(maximum, 2));
+	maximum = _mm_max_epu8(maximum, _mm_srli_si128(maximum, 1));
+	const int minValue = _mm_cvtsi128_si32(minimum) & 0xff;
+	const int maxValue = _mm_cvtsi128_si32(maximum) & 0xff;
+#else
+	const int minValue = *std::min_element(values, values + 16);
+	const int maxValue = *std::max_element(values, values + 16);
+#endif
+
+	output[0] = static_cast<unsigned char>(maxValue);
+	output[1] = static_cast<unsigned char>(minValue);
+	if (maxValue == minValue)
+	{
+		memset(output + 2, 0, 6);
+		return;
+	}
+
+	// level 0 is the min, 7 the max
+	const float scale = 7.0f / static_cast<float>(maxValue - minValue);
+#ifdef BLOCK_COMPRESSOR_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+	const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+	const __m128i words[4] = { _mm_unpacklo_epi16(low, zero), _mm_unpackhi_epi16(low, zero), _mm_unpacklo_epi16(high, zero), _mm_unpackhi_epi16(high, zero) };
+	for (int n = 0; n < 4; ++n)
+	{
+		const __m128 value = _mm_sub_ps(_mm_cvtepi32_ps(words[n]), _mm_set1_ps(static_cast<float>(minValue)));
+		const __m128i level = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, _mm_set1_ps(scale)), _mm_set1_ps(0.5f)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&levels[n * 4]), level);
+	}
+#else
+	for (int n = 0; n < 16; ++n)
+	{
+		levels[n] = static_cast<uint32_t>((values[n] - minValue) * scale + 0.5f);
+	}
+#endif
+
+	uint64_t indices = 0;
+	for (int n = 0; n < 16; ++n)
+	{
+		const uint32_t level = std::min(levels[n], 7u);
+		const uint64_t index = level == 7 ? 0 : (level == 0 ? 1 : 8 - level);
+		indices |= index << (3 * n);
+	}
+	for (int n = 0; n < 6; ++n)
+	{
+		output[2 + n] = static_cast<unsigned char>(indices >> (8 * n));
+	}
+}
+
+void DecodeBC1Block(const unsigned char block[8], unsigned char texels[16 * 3])
+{
+	uint16_t color0;
+	uint16_t color1;
+	uint32_t indices;
+	memcpy(&color0, block, 2);
+	memcpy(&color1, block + 2, 2);
+	memcpy(&indices, block + 4, 4);
+
+	int palette[4][3];
+	GetBC1Palette(color0, color1, palette);
+	for (int n = 0; n < 16; ++n)
+	{
+		const int* color = palette[(indices >> (2 * n)) & 3];
+		for (int c = 0; c < 3; ++c)
+		{
+			texels[n * 3 + c] = static_cast<unsigned char>(color[c]);
+		}
+	}
+}
+
+void DecodeBC4Block(const unsigned char block[8], unsigned char values[16])
+{
+	const int value0 = block[0];
+	const int value1 = block[1];
+	int palette[8] = { value0, value1 };
+	for (int n = 2; n < 8; ++n)
+	{
+		if (value0 > value1)
+		{
+			palette[n] = ((8 - n) * value0 + (n - 1) * value1) / 7;
+		}
+		else if (n < 6)
+		{
+			palette[n] = ((6 - n) * value0 + (n - 1) * value1) / 5;
+		}
+		else
+		{
+			palette[n] = n == 6 ? 0 : 255;
+		}
+	}
+
+	uint64_t indices = 0;
+	for (int n = 0; n < 6; ++n)
+	{
+		indices |= uint64_t(block[2 + n]) << (8 * n);
+	}
+	for (int n = 0; n < 16; ++n)
+	{
+		values[n] = static_cast<unsigned char>(palette[(indices >> (3 * n)) & 7]);
+	}
+}
+
+std::vector<unsigned char> BlockCompressor::Compress(uint32_t format, const unsigned char* pixels, uint32_t width, uint32_t height, uint32_t channels)
+{
+	std::vector<unsigned char> blocks(TextureContainer::GetImageSize(format, width, height));
+	const uint32_t blocksX = (width + 3) / 4;
+	const uint32_t blocksY = (height + 3) / 4;
+	const size_t blockSize = format == TEXTURE_FORMAT_BC5 ? 16 : 8;
+
+	ThreadPool::GetShared().ParallelFor(blocksY, [&](size_t blockY)
+	{
+		for (uint32_t blockX = 0; blockX < blocksX; ++blockX)
+		{
+			unsigned char* output = &blocks[(blockY * blocksX + blockX) * blockSize];
+			if (format == TEXTURE_FORMAT_BC1)
+			{
+				ColorBlock block;
+				LoadColorBlock(block, pixels, width, height, channels, blockX, static_cast<uint32_t>(blockY));
+				EncodeBC1Block(block, output);
+			}
+			else
+			{
+				// BC5 is a BC4 block for the first channel followed by one for the second
+				for (uint32_t channel = 0; channel < (format == TEXTURE_FORMAT_BC5 ? 2u : 1u); ++channel)
+				{
+					unsigned char values[16];
+					LoadChannelBlock(values, pixels, width, height, channels, channel, blockX, static_cast<uint32_t>(blockY));
+					EncodeBC4Block(values, output + channel * 8);
+				}
+			}
+		}
+	});
+	return blocks;
+}
+
+std::vector<unsigned char> BlockCompressor::Decompress(uint32_t format, const unsigned char* blocks, uint32_t width, uint32_t height)
+{
+	const uint32_t channels = TextureContainer::GetFormatChannels(format);
+	std::vector<unsigned char> pixels(size_t(width) * height * channels);
+	const uint32_t blocksX = (width + 3) / 4;
+	const uint32_t blocksY = (height + 3) / 4;
+	const size_t blockSize = format == TEXTURE_FORMAT_BC5 ? 16 : 8;
+
+	for (uint32_t blockY = 0; blockY < blocksY; ++blockY)
+	{
+		for (uint32_t blockX = 0; blockX < blocksX; ++blockX)
+		{
+			const unsigned char* block = blocks + (size_t(blockY) * blocksX + blockX) * blockSize;
+			unsigned char texels[16 * 3];
+			if (format == TEXTURE_FORMAT_BC1)
+			{
+				DecodeBC1Block(block, texels);
+			}
+			else
+			{
+				for (uint32_t channel = 0; channel < channels; ++channel)
+				{
+					unsigned char values[16];
+					DecodeBC4Block(block + channel * 8, values);
+					for (int n = 0; n < 16; ++n)
+					{
+						texels[n * channels + channel] = values[n];
+					}
+				}
+			}
+
+			// drop the texels of partial blocks that fall outside of the image
+			for (uint32_t n = 0; n < 16; ++n)
+			{
+				const uint32_t x = blockX * 4 + n % 4;
+				const uint32_t y = blockY * 4 + n / 4;
+				if (x < width && y < height)
+				{
+					memcpy(&pixels[(size_t(y) * width + x) * channels], &texels[n * channels], channels);
+				}
+			}
+		}
+	}
+	return pixels;
+}
+
+double BlockCompressor::ComputePsnr(const unsigned char* reference, uint32_t referenceChannels,
+	const unsigned char* image, uint32_t imageChannels, size_t texelCount, uint32_t compareChannels)
+{
+	double squaredError = 0.0;
+	for (size_t n = 0; n < texelCount; ++n)
+	{
+		for (uint32_t c = 0; c < compareChannels; ++c)
+		{
+			const double difference = double(reference[n * referenceChannels + c]) - double(image[n * imageChannels + c]);
+			squaredError += difference * difference;
+		}
+	}
+
+	const double meanSquaredError = squaredError / (double(texelCount) * compareChannels);
+	if (meanSquaredError == 0.0)
+	{
+		return std::numeric_limits<double>::infinity();
+	}
+	return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "TextureContainer.h"
+
+// CPU encoder and decoder of the block compressed TextureContainerFormat values (BC1, BC4, BC5).
+// Every 4x4 texel block is encoded independently, rows of blocks are spread over the shared ThreadPool
+// and the per block math uses SSE2 when the compiler targets it.
+class BlockCompressor
+{
+public:
+	// pixels holds width x height texels of channels bytes, rows tightly packed.
+	// BC1 encodes the first 3 channels (no alpha), BC4 the first one and BC5 the first two.
+	// Images that aren't a multiple of 4 repeat their last row / column into the partial blocks.
+	static std::vector<unsigned char> Compress(uint32_t format, const unsigned char* pixels, uint32_t width, uint32_t height, uint32_t channels);
+
+	// Decoded image with TextureContainer::GetFormatChannels(format) channels per texel
+	static std::vector<unsigned char> Decompress(uint32_t format, const unsigned char* blocks, uint32_t width, uint32_t height);
+
+	// Peak signal to noise ratio in dB over the first compareChannels channels of texelCount texels,
+	// infinity when both images are identical
+	static double ComputePsnr(const unsigned char* reference, uint32_t referenceChannels,
+		const unsigned char* image, uint32_t imageChannels, size_t texelCount, uint32_t compareChannels);
+};
@@ -0,0 +1,144 @@
+#include "FileWatcher.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+
+// inotify reports the writes as they happen, there is no interval to wait
+FileWatcher::FileWatcher(const std::string& directory, std::chrono::milliseconds /*pollInterval*/)
+	: directory(directory)
+{
+	inotifyFile = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotifyFile < 0)
+	{
+		std::cout << "ERROR::FILE_WATCHER::INOTIFY_INIT_FAILED" << std::endl;
+		return;
+	}
+
+	// editors either rewrite the file or move a new one over it
+	if (inotify_add_watch(inotifyFile, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+	{
+		std::cout << "ERROR::FILE_WATCHER::CAN_NOT_WATCH " << directory << std::endl;
+		close(inotifyFile);
+		inotifyFile = -1;
+	}
+}
+
+FileWatcher::~FileWatcher()
+{
+	if (inotifyFile >= 0)
+	{
+		close(inotifyFile);
+	}
+}
+
+bool FileWatcher::IsWatching() const
+{
+	return inotifyFile >= 0;
+}
+
+std::vector<std::string> FileWatcher::Poll()
+{
+	std::vector<std::string> changedPaths;
+	if (inotifyFile < 0)
+	{
+		return changedPaths;
+	}
+
+	alignas(inotify_event) char events[4096];
+	while (true)
+	{
+		const ssize_t size = read(inotifyFile, events, sizeof(events));
+		if (size <= 0)
+		{
+			// EAGAIN, nothing left
+			break;
+		}
+
+		for (ssize_t offset = 0; offset < size;)
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(events + offset);
+			if (event->len > 0 && !(event->mask & IN_ISDIR))
+			{
+				const std::string path = directory + "/" + event->name;
+				if (std::find(changedPaths.begin(), changedPaths.end(), path) == changedPaths.end())
+				{
+					changedPaths.push_back(path);
+				}
+			}
+			offset += sizeof(inotify_event) + event->len;
+		}
+	}
+	return changedPaths;
+}
+
+#else
+
+FileWatcher::FileWatcher(const std::string& directory, std::chrono::milliseconds pollInterval)
+	: directory(directory), pollInterval(pollInterval), lastPoll(std::chrono::steady_clock::now())
+{
+	std::error_code error;
+	isWatching = std::filesystem::is_directory(directory, error);
+	if (!isWatching)
+	{
+		std::cout << "ERROR::FILE_WATCHER::CAN_NOT_WATCH " << directory << std::endl;
+		return;
+	}
+	ScanWriteTimes(nullptr);
+}
+
+FileWatcher::~FileWatcher()
+{
+}
+
+bool FileWatcher::IsWatching() const
+{
+	return isWatching;
+}
+
+std::vector<std::string> FileWatcher::Poll()
+{
+	std::vector<std::string> changedPaths;
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (!isWatching || now - lastPoll < pollInterval)
+	{
+		return changedPaths;
+	}
+
+	lastPoll = now;
+	ScanWriteTimes(&changedPaths);
+	return changedPaths;
+}
+
+void FileWatcher::ScanWriteTimes(std::vector<std::string>* changedPaths)
+{
+	std::error_code error;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory, error))
+	{
+		if (!entry.is_regular_file(error))
+		{
+			continue;
+		}
+
+		const std::chrono::nanoseconds writeTime = entry.last_write_time(error).time_since_epoch();
+		const std::string path = directory + "/" + entry.path().filename().string();
+		const auto known = writeTimes.find(path);
+		if (known == writeTimes.end() || known->second != writeTime)
+		{
+			writeTimes[path] = writeTime;
+			if (changedPaths)
+			{
+				changedPaths->push_back(path);
+			}
+		}
+	}
+}
+
+#endif
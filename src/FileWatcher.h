@@ -0,0 +1,40 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Reports the files of a directory written since the last Poll (not its subdirectories).
+// Uses inotify on Linux, which costs one non blocking read per Poll. Other platforms compare the modification
+// times of the files, at most once per pollInterval.
+class FileWatcher
+{
+public:
+	explicit FileWatcher(const std::string& directory, std::chrono::milliseconds pollInterval = std::chrono::milliseconds(500));
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	bool IsWatching() const;
+	const std::string& GetDirectory() const { return directory; }
+
+	// Paths (directory + "/" + file name) of the files written or created since the last call, each once
+	std::vector<std::string> Poll();
+
+private:
+	std::string directory;
+
+#ifdef __linux__
+	int inotifyFile = -1;
+#else
+	// Modification time of every file, changed files are the ones whose time differs
+	std::unordered_map<std::string, std::chrono::nanoseconds> writeTimes;
+	std::chrono::milliseconds pollInterval;
+	std::chrono::steady_clock::time_point lastPoll;
+	bool isWatching = false;
+
+	void ScanWriteTimes(std::vector<std::string>* changedPaths);
+#endif
+};
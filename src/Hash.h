@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// 64 bit FNV-1a variant that consumes 8 bytes per step (tail bytes one at a time).
+// Not cryptographic, only used to detect changed content and build cache keys.
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull)
+{
+	const uint64_t prime = 1099511628211ull;
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+	uint64_t hash = seed;
+	size_t n = 0;
+	for (; n + 8 <= size; n += 8)
+	{
+		uint64_t word;
+		memcpy(&word, bytes + n, sizeof(word));
+		hash = (hash ^ word) * prime;
+	}
+	for (; n < size; ++n)
+	{
+		hash = (hash ^ bytes[n]) * prime;
+	}
+	// final avalanche so that nearby inputs don't produce nearby hashes
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdull;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+inline uint64_t HashString(const std::string& text, uint64_t seed = 14695981039346656037ull)
+{
+	return HashBytes(text.data(), text.size(), seed);
+}
@@ -0,0 +1,198 @@
+#include "MeshCache.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "Hash.h"
+
+// Bump every time the file layout or the data produced by the importer changes
+const uint32_t MESH_CACHE_MAGIC = 0x434D5753; // "SWMC"
+const uint32_t MESH_CACHE_VERSION = 7;
+const uint64_t MESH_CACHE_ALIGNMENT = 16;
+
+struct MeshCacheFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sourceHash;
+	uint64_t sourceSize;
+	uint64_t sourcePathHash;
+	uint32_t postProcessFlags;
+	uint32_t importFlags;
+	uint32_t chunkCount;
+	uint32_t reserved;
+};
+
+struct MeshCacheFileChunk
+{
+	uint32_t id;
+	uint32_t elementSize;
+	uint64_t offset;
+	uint64_t count;
+};
+
+uint64_t AlignCacheOffset(uint64_t offset)
+{
+	return (offset + MESH_CACHE_ALIGNMENT - 1) & ~(MESH_CACHE_ALIGNMENT - 1);
+}
+
+bool MeshCache::ComputeKey(const std::string& sourcePath, uint32_t postProcessFlags, uint32_t importFlags, Key& key)
+{
+	MappedFile source;
+	if (!source.Open(sourcePath))
+	{
+		return false;
+	}
+
+	key.sourcePath = sourcePath;
+	key.sourceHash = HashBytes(source.GetData(), source.GetSize());
+	key.sourceSize = source.GetSize();
+	key.postProcessFlags = postProcessFlags;
+	key.importFlags = importFlags;
+	return true;
+}
+
+std::string MeshCache::GetCachePath(const std::string& sourcePath)
+{
+	return sourcePath + ".meshcache";
+}
+
+bool MeshCache::Write(const Key& key, const std::vector<Chunk>& chunks)
+{
+	MeshCacheFileHeader header = {};
+	header.magic = MESH_CACHE_MAGIC;
+	header.version = MESH_CACHE_VERSION;
+	header.sourceHash = key.sourceHash;
+	header.sourceSize = key.sourceSize;
+	header.sourcePathHash = HashString(key.sourcePath);
+	header.postProcessFlags = key.postProcessFlags;
+	header.importFlags = key.importFlags;
+	header.chunkCount = static_cast<uint32_t>(chunks.size());
+
+	// lay out the chunks after the header and the chunk table
+	std::vector<MeshCacheFileChunk> table(chunks.size());
+	uint64_t offset = sizeof(MeshCacheFileHeader) + sizeof(MeshCacheFileChunk) * chunks.size();
+	for (size_t n = 0; n < chunks.size(); ++n)
+	{
+		offset = AlignCacheOffset(offset);
+		table[n].id = chunks[n].id;
+		table[n].elementSize = chunks[n].elementSize;
+		table[n].offset = offset;
+		table[n].count = chunks[n].count;
+		offset += uint64_t(chunks[n].elementSize) * chunks[n].count;
+	}
+
+	const std::string cachePath = GetCachePath(key.sourcePath);
+	const std::string temporaryPath = cachePath + ".tmp";
+	{
+		std::ofstream cacheFile(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!cacheFile)
+		{
+			std::cout << "ERROR::MESH_CACHE::CAN_NOT_CREATE_FILE " << temporaryPath << std::endl;
+			return false;
+		}
+
+		cacheFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		cacheFile.write(reinterpret_cast<const char*>(table.data()), sizeof(MeshCacheFileChunk) * table.size());
+
+		const char padding[MESH_CACHE_ALIGNMENT] = {};
+		for (size_t n = 0; n < chunks.size(); ++n)
+		{
+			const uint64_t position = static_cast<uint64_t>(cacheFile.tellp());
+			cacheFile.write(padding, static_cast<std::streamsize>(table[n].offset - position));
+			cacheFile.write(static_cast<const char*>(chunks[n].data), static_cast<std::streamsize>(uint64_t(chunks[n].elementSize) * chunks[n].count));
+		}
+
+		if (!cacheFile)
+		{
+			std::cout << "ERROR::MESH_CACHE::WRITE_FAILED " << temporaryPath << std::endl;
+			cacheFile.close();
+			std::remove(temporaryPath.c_str());
+			return false;
+		}
+	}
+
+	// std::rename doesn't replace existing files on every platform
+	std::remove(cachePath.c_str());
+	if (std::rename(temporaryPath.c_str(), cachePath.c_str()) != 0)
+	{
+		std::remove(temporaryPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool MeshCache::Open(const Key& key)
+{
+	Close();
+
+	if (!file.Open(GetCachePath(key.sourcePath)))
+	{
+		return false;
+	}
+
+	const unsigned char* data = file.GetData();
+	const size_t size = file.GetSize();
+	if (size < sizeof(MeshCacheFileHeader))
+	{
+		Close();
+		return false;
+	}
+
+	const MeshCacheFileHeader* header = reinterpret_cast<const MeshCacheFileHeader*>(data);
+	const bool isValid =
+		header->magic == MESH_CACHE_MAGIC &&
+		header->version == MESH_CACHE_VERSION &&
+		header->sourceHash == key.sourceHash &&
+		header->sourceSize == key.sourceSize &&
+		header->sourcePathHash == HashString(key.sourcePath) &&
+		header->postProcessFlags == key.postProcessFlags &&
+		header->importFlags == key.importFlags &&
+		sizeof(MeshCacheFileHeader) + sizeof(MeshCacheFileChunk) * uint64_t(header->chunkCount) <= size;
+	if (!isValid)
+	{
+		Close();
+		return false;
+	}
+
+	// make sure no chunk points outside of the file
+	const MeshCacheFileChunk* table = reinterpret_cast<const MeshCacheFileChunk*>(data + sizeof(MeshCacheFileHeader));
+	for (uint32_t n = 0; n < header->chunkCount; ++n)
+	{
+		const uint64_t bytes = uint64_t(table[n].elementSize) * table[n].count;
+		if (table[n].offset > size || bytes > size - table[n].offset)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void MeshCache::Close()
+{
+	file.Close();
+}
+
+const void* MeshCache::GetChunk(uint32_t id, size_t elementSize, size_t& count) const
+{
+	if (!file.IsOpen())
+	{
+		return nullptr;
+	}
+
+	const unsigned char* data = file.GetData();
+	const MeshCacheFileHeader* header = reinterpret_cast<const MeshCacheFileHeader*>(data);
+	const MeshCacheFileChunk* table = reinterpret_cast<const MeshCacheFileChunk*>(data + sizeof(MeshCacheFileHeader));
+	for (uint32_t n = 0; n < header->chunkCount; ++n)
+	{
+		if (table[n].id == id && table[n].elementSize == elementSize)
+		{
+			count = static_cast<size_t>(table[n].count);
+			return data + table[n].offset;
+		}
+	}
+	return nullptr;
+}
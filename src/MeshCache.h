@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+// Binary cache of imported mesh data.
+// The file is a small header, a chunk table and the raw chunk arrays (16 byte aligned), so loading it
+// is a single mapping plus one copy per chunk. Every cache file records what it was built from
+// (source path, source content hash and size, Assimp post process and import flags and the format version) and is
+// rejected as stale when any of them differs.
+class MeshCache
+{
+public:
+	// Identifies each array stored in the cache file
+	enum ChunkId : uint32_t
+	{
+		CHUNK_VERTEX_LAYOUT = 0,
+		CHUNK_VERTICES,
+		CHUNK_INDICES,
+		CHUNK_MESHLETS,
+		CHUNK_MESHLET_VERTICES,
+		CHUNK_MESHLET_TRIANGLES,
+		CHUNK_LODS,
+		CHUNK_LOD_INDICES,
+		CHUNK_LOD_BOUNDS,
+	};
+
+	// What the cached data was produced from
+	struct Key
+	{
+		std::string sourcePath;
+		uint64_t sourceHash = 0;
+		uint64_t sourceSize = 0;
+		uint32_t postProcessFlags = 0;
+		uint32_t importFlags = 0;
+	};
+
+	struct Chunk
+	{
+		uint32_t id;
+		uint32_t elementSize;
+		const void* data;
+		uint64_t count;
+	};
+
+	// Hashes the source file contents, fails if the file can't be read
+	static bool ComputeKey(const std::string& sourcePath, uint32_t postProcessFlags, uint32_t importFlags, Key& key);
+	static std::string GetCachePath(const std::string& sourcePath);
+
+	// Writes all the chunks to the cache file of the key (through a temporary file, so a crash never leaves a half written cache)
+	static bool Write(const Key& key, const std::vector<Chunk>& chunks);
+
+	// Maps the cache file of the key, fails if it doesn't exist, is corrupted or is stale
+	bool Open(const Key& key);
+	void Close();
+
+	// Returns nullptr if the chunk isn't stored or was stored with another element size
+	const void* GetChunk(uint32_t id, size_t elementSize, size_t& count) const;
+
+private:
+	MappedFile file;
+};
@@ -0,0 +1,156 @@
+#include "MeshImportReport.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+// GetProcessMemoryInfo from kernel32, no psapi.lib needed
+#define PSAPI_VERSION 2
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+std::string EscapeJsonString(const std::string& value)
+{
+	std::string escaped;
+	escaped.reserve(value.size());
+	for (char c : value)
+	{
+		if (c == '"' || c == '\\')
+		{
+			escaped += '\\';
+			escaped += c;
+		}
+		else if (static_cast<unsigned char>(c) < 0x20)
+		{
+			const char* hexDigits = "0123456789abcdef";
+			escaped += "\\u00";
+			escaped += hexDigits[(c >> 4) & 0xf];
+			escaped += hexDigits[c & 0xf];
+		}
+		else
+		{
+			escaped += c;
+		}
+	}
+	return escaped;
+}
+
+void MeshImportReport::Print(std::ostream& stream) const
+{
+	stream << "Mesh import: " << sourcePath << (isFromCache ? " (from cache)" : "") << "\n";
+	if (isFromCache)
+	{
+		stream << "  cache load    " << cacheLoadTime << " ms\n";
+	}
+	else
+	{
+		stream << "  read file     " << readFileTime << " ms\n";
+		stream << "  post process  " << postProcessTime << " ms\n";
+		for (const PostProcessStepTiming& timing : postProcessSteps)
+		{
+			stream << "    step " << timing.step << "  " << timing.milliseconds << " ms\n";
+		}
+		stream << "  conversion    " << conversionTime << " ms\n";
+		stream << "  optimization  " << optimizationTime << " ms\n";
+		stream << "  meshlets      " << meshletTime << " ms\n";
+		stream << "  lods          " << lodTime << " ms\n";
+		stream << "  cache write   " << cacheWriteTime << " ms\n";
+	}
+	stream << "  total         " << totalTime << " ms\n";
+	stream << "  upload        " << uploadTime << " ms\n";
+	stream << "  " << meshCount << " meshes, " << vertexCount << " vertices, " << indexCount << " indices, "
+		<< meshletCount << " meshlets, " << lodCount << " lods\n";
+	stream << "  output " << outputBytes / 1024 << " KB, peak RSS " << peakResidentBytes / (1024 * 1024) << " MB\n";
+	if (isOptimized)
+	{
+		stream << "  optimization: ACMR " << optimization.before.acmr << " -> " << optimization.after.acmr
+			<< ", ATVR " << optimization.before.atvr << " -> " << optimization.after.atvr
+			<< ", vertex transforms " << optimization.before.vertexTransforms << " -> " << optimization.after.vertexTransforms << "\n";
+	}
+	stream.flush();
+}
+
+std::string MeshImportReport::ToJson() const
+{
+	std::ostringstream json;
+	json << "{\n";
+	json << "\t\"sourcePath\": \"" << EscapeJsonString(sourcePath) << "\",\n";
+	json << "\t\"isFromCache\": " << (isFromCache ? "true" : "false") << ",\n";
+	json << "\t\"timesMs\": {\n";
+	json << "\t\t\"cacheLoad\": " << cacheLoadTime << ",\n";
+	json << "\t\t\"readFile\": " << readFileTime << ",\n";
+	json << "\t\t\"postProcess\": " << postProcessTime << ",\n";
+	json << "\t\t\"postProcessSteps\": [";
+	for (size_t n = 0; n < postProcessSteps.size(); ++n)
+	{
+		json << (n > 0 ? ", " : "") << "{ \"step\": " << postProcessSteps[n].step << ", \"ms\": " << postProcessSteps[n].milliseconds << " }";
+	}
+	json << "],\n";
+	json << "\t\t\"conversion\": " << conversionTime << ",\n";
+	json << "\t\t\"optimization\": " << optimizationTime << ",\n";
+	json << "\t\t\"meshlets\": " << meshletTime << ",\n";
+	json << "\t\t\"lods\": " << lodTime << ",\n";
+	json << "\t\t\"cacheWrite\": " << cacheWriteTime << ",\n";
+	json << "\t\t\"total\": " << totalTime << ",\n";
+	json << "\t\t\"upload\": " << uploadTime << "\n";
+	json << "\t},\n";
+	json << "\t\"meshCount\": " << meshCount << ",\n";
+	json << "\t\"vertexCount\": " << vertexCount << ",\n";
+	json << "\t\"indexCount\": " << indexCount << ",\n";
+	json << "\t\"meshletCount\": " << meshletCount << ",\n";
+	json << "\t\"lodCount\": " << lodCount << ",\n";
+	json << "\t\"outputBytes\": " << outputBytes << ",\n";
+	json << "\t\"peakResidentBytes\": " << peakResidentBytes;
+	if (isOptimized)
+	{
+		json << ",\n\t\"optimization\": {\n";
+		json << "\t\t\"acmrBefore\": " << optimization.before.acmr << ", \"acmrAfter\": " << optimization.after.acmr << ",\n";
+		json << "\t\t\"atvrBefore\": " << optimization.before.atvr << ", \"atvrAfter\": " << optimization.after.atvr << ",\n";
+		json << "\t\t\"vertexTransformsBefore\": " << optimization.before.vertexTransforms << ", \"vertexTransformsAfter\": " << optimization.after.vertexTransforms << "\n";
+		json << "\t}";
+	}
+	json << "\n}\n";
+	return json.str();
+}
+
+bool MeshImportReport::WriteJson(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file)
+	{
+		std::cout << "ERROR::IMPORT_REPORT::CAN_NOT_CREATE_FILE " << path << std::endl;
+		return false;
+	}
+	file << ToJson();
+	return static_cast<bool>(file);
+}
+
+size_t MeshImportReport::GetPeakResidentBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return counters.PeakWorkingSetSize;
+	}
+	return 0;
+#else
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+	{
+		return 0;
+	}
+#ifdef __APPLE__
+	return static_cast<size_t>(usage.ru_maxrss);
+#else
+	// kilobytes on Linux
+	return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "MeshOptimizer.h"
+
+// Time spent in one Assimp post processing step. Assimp only reports the index of the step in its
+// registry (see PostStepRegistry.cpp of the Assimp version in use), not its name.
+struct PostProcessStepTiming
+{
+	int step;
+	double milliseconds;
+};
+
+// Where AssimpHelper::ImportMesh spent its time and what it produced.
+// Times are in milliseconds, stages that did not run stay at 0.
+struct MeshImportReport
+{
+	std::string sourcePath;
+	bool isFromCache = false;
+
+	double cacheLoadTime = 0.0;
+	double readFileTime = 0.0;		// Importer::ReadFile parsing, post processing excluded
+	double postProcessTime = 0.0;	// all the post processing steps
+	std::vector<PostProcessStepTiming> postProcessSteps;
+	double conversionTime = 0.0;	// aiScene to the interleaved vertices and indices
+	double optimizationTime = 0.0;
+	double meshletTime = 0.0;
+	double lodTime = 0.0;
+	double cacheWriteTime = 0.0;
+	double totalTime = 0.0;			// the whole ImportMesh call
+	double uploadTime = 0.0;		// GL upload, filled by the caller
+
+	size_t meshCount = 0;			// mesh instances in the scene (0 when loaded from the cache)
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	size_t meshletCount = 0;
+	size_t lodCount = 0;
+	size_t outputBytes = 0;			// allocated by the output vertex, index, meshlet and LOD buffers
+	size_t peakResidentBytes = 0;	// peak resident set size of the process when the import finished
+
+	bool isOptimized = false;
+	MeshOptimizationReport optimization;
+
+	void Print(std::ostream& stream) const;
+	std::string ToJson() const;
+	bool WriteJson(const std::string& path) const;
+
+	// Peak resident set size of the process so far, 0 when the platform can't tell
+	static size_t GetPeakResidentBytes();
+};
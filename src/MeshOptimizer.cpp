@@ -0,0 +1,362 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <glm/glm.hpp>
+
+// Vertex to triangles adjacency in compressed form: the triangles of vertex v are triangles[offsets[v] .. offsets[v + 1])
+struct TriangleAdjacency
+{
+	std::vector<unsigned int> offsets;
+	std::vector<unsigned int> triangles;
+};
+
+void BuildTriangleAdjacency(TriangleAdjacency& adjacency, const std::vector<unsigned int>& indices, size_t vertexCount)
+{
+	const size_t triangleCount = indices.size() / 3;
+
+	adjacency.offsets.assign(vertexCount + 1, 0);
+	for (unsigned int index : indices)
+	{
+		adjacency.offsets[index + 1]++;
+	}
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		adjacency.offsets[v + 1] += adjacency.offsets[v];
+	}
+
+	adjacency.triangles.resize(indices.size());
+	std::vector<unsigned int> cursors(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		adjacency.triangles[cursors[indices[t * 3 + 0]]++] = static_cast<unsigned int>(t);
+		adjacency.triangles[cursors[indices[t * 3 + 1]]++] = static_cast<unsigned int>(t);
+		adjacency.triangles[cursors[indices[t * 3 + 2]]++] = static_cast<unsigned int>(t);
+	}
+}
+
+// Number of vertex transforms a FIFO cache needs for triangles [begin, end).
+// A vertex is in the cache while fewer than cacheSize misses happened since it was loaded,
+// so advancing timestamp by cacheSize + 1 flushes the cache.
+unsigned int CountCacheMisses(const std::vector<unsigned int>& indices, size_t begin, size_t end, std::vector<unsigned int>& timestamps, unsigned int& timestamp, unsigned int cacheSize)
+{
+	unsigned int misses = 0;
+	for (size_t t = begin; t < end; ++t)
+	{
+		for (size_t k = 0; k < 3; ++k)
+		{
+			const unsigned int v = indices[t * 3 + k];
+			if (timestamp - timestamps[v] > cacheSize)
+			{
+				timestamps[v] = timestamp++;
+				misses++;
+			}
+		}
+	}
+	return misses;
+}
+
+VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStatistics statistics;
+
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return statistics;
+	}
+
+	std::vector<unsigned int> timestamps(vertexCount, 0);
+	// start far enough in the future that every vertex is a miss the first time
+	unsigned int timestamp = cacheSize + 1;
+	statistics.vertexTransforms = CountCacheMisses(indices, 0, triangleCount, timestamps, timestamp, cacheSize);
+
+	std::vector<bool> isReferenced(vertexCount, false);
+	size_t referencedVertices = 0;
+	for (unsigned int index : indices)
+	{
+		if (!isReferenced[index])
+		{
+			isReferenced[index] = true;
+			referencedVertices++;
+		}
+	}
+
+	statistics.acmr = float(statistics.vertexTransforms) / float(triangleCount);
+	statistics.atvr = float(statistics.vertexTransforms) / float(referencedVertices);
+	return statistics;
+}
+
+// Tipsify: emits all the triangles around a fanning vertex, then moves to the candidate that is still in the cache
+// (and will stay there after emitting its remaining triangles), falling back to recently used vertices at dead ends.
+void MeshOptimizer::OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount, std::vector<size_t>* clusterStarts)
+{
+	const size_t triangleCount = indices.size() / 3;
+	const unsigned int cacheSize = VERTEX_CACHE_SIZE;
+
+	if (clusterStarts)
+	{
+		clusterStarts->clear();
+	}
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	TriangleAdjacency adjacency;
+	BuildTriangleAdjacency(adjacency, indices, vertexCount);
+
+	// live triangles per vertex
+	std::vector<unsigned int> liveTriangles(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+	}
+
+	std::vector<unsigned int> timestamps(vertexCount, 0);
+	std::vector<bool> isEmitted(triangleCount, false);
+	std::vector<unsigned int> deadEndStack;
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+
+	unsigned int timestamp = cacheSize + 1;
+	size_t inputCursor = 0;
+	size_t fanningVertex = indices[0];
+	bool isClusterStart = true;
+
+	for (;;)
+	{
+		if (isClusterStart && clusterStarts)
+		{
+			clusterStarts->push_back(result.size() / 3);
+		}
+
+		candidates.clear();
+		for (unsigned int a = adjacency.offsets[fanningVertex]; a < adjacency.offsets[fanningVertex + 1]; ++a)
+		{
+			const unsigned int t = adjacency.triangles[a];
+			if (isEmitted[t])
+			{
+				continue;
+			}
+			isEmitted[t] = true;
+
+			for (size_t k = 0; k < 3; ++k)
+			{
+				const unsigned int v = indices[t * 3 + k];
+				result.push_back(v);
+				deadEndStack.push_back(v);
+				candidates.push_back(v);
+				liveTriangles[v]--;
+				if (timestamp - timestamps[v] > cacheSize)
+				{
+					timestamps[v] = timestamp++;
+				}
+			}
+		}
+
+		// pick the candidate that will still be in the cache once its remaining triangles are emitted, preferring the oldest one
+		long long bestVertex = -1;
+		int bestPriority = -1;
+		for (unsigned int v : candidates)
+		{
+			if (liveTriangles[v] == 0)
+			{
+				continue;
+			}
+			int priority = 0;
+			if (timestamp - timestamps[v] + 2 * liveTriangles[v] <= cacheSize)
+			{
+				priority = static_cast<int>(timestamp - timestamps[v]);
+			}
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				bestVertex = v;
+			}
+		}
+
+		isClusterStart = false;
+		if (bestVertex == -1)
+		{
+			// dead end: try the most recently emitted vertices, then scan the input in order
+			while (!deadEndStack.empty() && bestVertex == -1)
+			{
+				const unsigned int v = deadEndStack.back();
+				deadEndStack.pop_back();
+				if (liveTriangles[v] > 0)
+				{
+					bestVertex = v;
+				}
+			}
+			while (bestVertex == -1 && inputCursor < indices.size())
+			{
+				const unsigned int v = indices[inputCursor++];
+				if (liveTriangles[v] > 0)
+				{
+					bestVertex = v;
+					isClusterStart = true;
+				}
+			}
+			if (bestVertex == -1)
+			{
+				break;
+			}
+		}
+		fanningVertex = static_cast<size_t>(bestVertex);
+	}
+
+	indices.swap(result);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<size_t>& clusterStarts,
+	const unsigned char* vertexData, size_t vertexStride, size_t positionOffset, size_t vertexCount, float threshold)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || clusterStarts.empty())
+	{
+		return;
+	}
+
+	// Split the hard clusters (fan restarts) further wherever the running ACMR already reached the cluster's ACMR * threshold,
+	// splitting there costs (almost) no vertex cache efficiency once the clusters are reordered.
+	std::vector<size_t> softStarts;
+	std::vector<unsigned int> timestamps(vertexCount, 0);
+	unsigned int timestamp = MeshOptimizer::VERTEX_CACHE_SIZE + 1;
+	for (size_t c = 0; c < clusterStarts.size(); ++c)
+	{
+		const size_t begin = clusterStarts[c];
+		const size_t end = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : triangleCount;
+
+		timestamp += MeshOptimizer::VERTEX_CACHE_SIZE + 1;
+		const unsigned int clusterMisses = CountCacheMisses(indices, begin, end, timestamps, timestamp, MeshOptimizer::VERTEX_CACHE_SIZE);
+		const float clusterThreshold = threshold * float(clusterMisses) / float(end - begin);
+
+		softStarts.push_back(begin);
+		timestamp += MeshOptimizer::VERTEX_CACHE_SIZE + 1;
+		unsigned int runningMisses = 0;
+		size_t runningTriangles = 0;
+		for (size_t t = begin; t < end; ++t)
+		{
+			runningMisses += CountCacheMisses(indices, t, t + 1, timestamps, timestamp, MeshOptimizer::VERTEX_CACHE_SIZE);
+			runningTriangles++;
+			if (t + 1 < end && float(runningMisses) / float(runningTriangles) <= clusterThreshold)
+			{
+				softStarts.push_back(t + 1);
+				timestamp += MeshOptimizer::VERTEX_CACHE_SIZE + 1;
+				runningMisses = 0;
+				runningTriangles = 0;
+			}
+		}
+	}
+
+	auto getPosition = [&](unsigned int v)
+	{
+		glm::vec3 position;
+		memcpy(&position, vertexData + v * vertexStride + positionOffset, sizeof(glm::vec3));
+		return position;
+	};
+
+	// area weighted centroid and normal of every cluster
+	const size_t clusterCount = softStarts.size();
+	std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+	std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+	for (size_t c = 0; c < clusterCount; ++c)
+	{
+		const size_t begin = softStarts[c];
+		const size_t end = c + 1 < clusterCount ? softStarts[c + 1] : triangleCount;
+
+		float clusterArea = 0.0f;
+		for (size_t t = begin; t < end; ++t)
+		{
+			const glm::vec3 p0 = getPosition(indices[t * 3 + 0]);
+			const glm::vec3 p1 = getPosition(indices[t * 3 + 1]);
+			const glm::vec3 p2 = getPosition(indices[t * 3 + 2]);
+
+			const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			const float area = glm::length(normal);
+			clusterCentroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+			clusterNormals[c] += normal;
+			clusterArea += area;
+		}
+
+		meshCentroid += clusterCentroids[c];
+		meshArea += clusterArea;
+		clusterCentroids[c] = clusterArea > 0.0f ? clusterCentroids[c] / clusterArea : getPosition(indices[begin * 3]);
+	}
+	meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : glm::vec3(0.0f);
+
+	// clusters far out along their normal are likely to occlude the rest of the mesh, draw them first
+	std::vector<float> sortKeys(clusterCount);
+	std::vector<size_t> clusterOrder(clusterCount);
+	for (size_t c = 0; c < clusterCount; ++c)
+	{
+		const float normalLength = glm::length(clusterNormals[c]);
+		const glm::vec3 direction = normalLength > 0.0f ? clusterNormals[c] / normalLength : glm::vec3(0.0f);
+		sortKeys[c] = glm::dot(clusterCentroids[c] - meshCentroid, direction);
+		clusterOrder[c] = c;
+	}
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&sortKeys](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+	for (size_t c : clusterOrder)
+	{
+		const size_t begin = softStarts[c];
+		const size_t end = c + 1 < clusterCount ? softStarts[c + 1] : triangleCount;
+		result.insert(result.end(), indices.begin() + begin * 3, indices.begin() + end * 3);
+	}
+	indices.swap(result);
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch(std::vector<unsigned char>& vertexData, size_t vertexStride, std::vector<unsigned int>& indices)
+{
+	const size_t vertexCount = vertexData.size() / vertexStride;
+	const unsigned int unused = ~0u;
+
+	std::vector<unsigned int> remap(vertexCount, unused);
+	std::vector<unsigned char> result(vertexData.size());
+	unsigned int nextVertex = 0;
+	for (unsigned int& index : indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = nextVertex;
+			memcpy(result.data() + size_t(nextVertex) * vertexStride, vertexData.data() + size_t(index) * vertexStride, vertexStride);
+			nextVertex++;
+		}
+		index = remap[index];
+	}
+
+	result.resize(size_t(nextVertex) * vertexStride);
+	vertexData.swap(result);
+	return nextVertex;
+}
+
+MeshOptimizationReport MeshOptimizer::OptimizeMesh(std::vector<unsigned char>& vertexData, size_t vertexStride, size_t positionOffset,
+	std::vector<unsigned int>& indices, float overdrawThreshold)
+{
+	MeshOptimizationReport report;
+
+	const size_t vertexCount = vertexData.size() / vertexStride;
+	report.before = AnalyzeVertexCache(indices, vertexCount);
+
+	// only triangle lists can be reordered
+	if (indices.size() % 3 != 0)
+	{
+		report.after = report.before;
+		return report;
+	}
+
+	std::vector<size_t> clusterStarts;
+	OptimizeVertexCache(indices, vertexCount, &clusterStarts);
+	OptimizeOverdraw(indices, clusterStarts, vertexData.data(), vertexStride, positionOffset, vertexCount, overdrawThreshold);
+	const size_t optimizedVertexCount = OptimizeVertexFetch(vertexData, vertexStride, indices);
+
+	report.after = AnalyzeVertexCache(indices, optimizedVertexCount);
+	return report;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Statistics of a simulated FIFO post-transform vertex cache
+struct VertexCacheStatistics
+{
+	// vertex shader invocations
+	unsigned int vertexTransforms = 0;
+	// average cache miss ratio: transforms per triangle (0.5 is the best case for big regular grids, 3 is the worst)
+	float acmr = 0.0f;
+	// average transform to vertex ratio: transforms per referenced vertex (1 is optimal)
+	float atvr = 0.0f;
+};
+
+struct MeshOptimizationReport
+{
+	VertexCacheStatistics before;
+	VertexCacheStatistics after;
+};
+
+// Triangle and vertex reordering for indexed triangle lists.
+// Based on "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (Sander, Nehab, Barczak 2007).
+class MeshOptimizer
+{
+public:
+	// Size of the FIFO cache the optimizations and statistics assume
+	static const unsigned int VERTEX_CACHE_SIZE = 16;
+
+	static VertexCacheStatistics AnalyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+	// Reorders the triangles for the post-transform vertex cache (Tipsify).
+	// clusterStarts receives the first triangle of every cluster the fan walk had to restart from.
+	static void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount, std::vector<size_t>* clusterStarts = nullptr);
+
+	// Reorders the clusters of an already cache optimized index buffer so that triangles facing outwards come first.
+	// Clusters are split further while their ACMR stays under threshold times the ACMR of the whole cluster,
+	// so 1.0 keeps the cache efficiency intact and bigger values trade vertex cache hits for less overdraw.
+	static void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<size_t>& clusterStarts,
+		const unsigned char* vertexData, size_t vertexStride, size_t positionOffset, size_t vertexCount, float threshold = 1.05f);
+
+	// Reorders the vertices in the order the index buffer first references them and remaps the indices.
+	// Unreferenced vertices are removed, returns the new vertex count.
+	static size_t OptimizeVertexFetch(std::vector<unsigned char>& vertexData, size_t vertexStride, std::vector<unsigned int>& indices);
+
+	// Runs all the passes above in order and reports the vertex cache statistics before and after
+	static MeshOptimizationReport OptimizeMesh(std::vector<unsigned char>& vertexData, size_t vertexStride, size_t positionOffset,
+		std::vector<unsigned int>& indices, float overdrawThreshold = 1.05f);
+};
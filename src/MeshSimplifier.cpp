@@ -0,0 +1,546 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#include "MeshOptimizer.h"
+
+enum SimplifierVertexKind
+{
+	VERTEX_MANIFOLD = 0,	// single wedge, surrounded by triangles
+	VERTEX_BORDER,			// single wedge on an open edge of the mesh
+	VERTEX_SEAM,			// two wedges (same position, different attributes) along a closed edge loop
+	VERTEX_LOCKED,			// anything else (corners, seams on borders, non manifold)
+};
+
+// SIMPLIFIER_CAN_COLLAPSE[source kind][target kind]
+const bool SIMPLIFIER_CAN_COLLAPSE[4][4] =
+{
+	{ true, true, true, true },
+	{ false, true, false, false },
+	{ false, false, true, false },
+	{ false, false, false, false },
+};
+
+// border and seam vertices may only slide along their open edge
+const bool SIMPLIFIER_NEEDS_OPEN_EDGE[4] = { false, true, true, false };
+
+// extra weight of the planes keeping open edges (borders and seams) in place
+const double SIMPLIFIER_EDGE_WEIGHT = 10.0;
+
+// Symmetric 4x4 matrix of the sum of squared distances to a set of planes, divided by the total weight on evaluation
+struct SimplifierQuadric
+{
+	double a00, a11, a22, a01, a02, a12;
+	double b0, b1, b2;
+	double c;
+	double w;
+};
+
+void AddQuadric(SimplifierQuadric& quadric, const SimplifierQuadric& other)
+{
+	quadric.a00 += other.a00; quadric.a11 += other.a11; quadric.a22 += other.a22;
+	quadric.a01 += other.a01; quadric.a02 += other.a02; quadric.a12 += other.a12;
+	quadric.b0 += other.b0; quadric.b1 += other.b1; quadric.b2 += other.b2;
+	quadric.c += other.c;
+	quadric.w += other.w;
+}
+
+// plane n.p + d = 0, n normalized
+SimplifierQuadric QuadricFromPlane(const glm::dvec3& n, double d, double weight)
+{
+	SimplifierQuadric quadric;
+	quadric.a00 = n.x * n.x * weight; quadric.a11 = n.y * n.y * weight; quadric.a22 = n.z * n.z * weight;
+	quadric.a01 = n.x * n.y * weight; quadric.a02 = n.x * n.z * weight; quadric.a12 = n.y * n.z * weight;
+	quadric.b0 = n.x * d * weight; quadric.b1 = n.y * d * weight; quadric.b2 = n.z * d * weight;
+	quadric.c = d * d * weight;
+	quadric.w = weight;
+	return quadric;
+}
+
+// weighted mean squared distance from p to the planes
+double QuadricError(const SimplifierQuadric& quadric, const glm::vec3& position)
+{
+	const glm::dvec3 p(position);
+	const double rx = quadric.a00 * p.x + quadric.a01 * p.y + quadric.a02 * p.z;
+	const double ry = quadric.a01 * p.x + quadric.a11 * p.y + quadric.a12 * p.z;
+	const double rz = quadric.a02 * p.x + quadric.a12 * p.y + quadric.a22 * p.z;
+	const double r = p.x * rx + p.y * ry + p.z * rz + 2.0 * (quadric.b0 * p.x + quadric.b1 * p.y + quadric.b2 * p.z) + quadric.c;
+	return quadric.w > 0.0 ? std::abs(r) / quadric.w : 0.0;
+}
+
+// Outgoing half-edges of every vertex (attribute space), with the triangle each of them belongs to
+struct SimplifierAdjacency
+{
+	std::vector<unsigned int> offsets;
+	std::vector<unsigned int> targets;
+	std::vector<unsigned int> triangles;
+};
+
+void BuildSimplifierAdjacency(SimplifierAdjacency& adjacency, const std::vector<unsigned int>& indices, size_t vertexCount)
+{
+	adjacency.offsets.assign(vertexCount + 1, 0);
+	for (unsigned int index : indices)
+	{
+		adjacency.offsets[index + 1]++;
+	}
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		adjacency.offsets[v + 1] += adjacency.offsets[v];
+	}
+
+	adjacency.targets.resize(indices.size());
+	adjacency.triangles.resize(indices.size());
+	std::vector<unsigned int> cursors(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+	for (size_t n = 0; n < indices.size(); ++n)
+	{
+		const size_t triangle = n / 3;
+		const unsigned int source = indices[n];
+		const unsigned int target = indices[triangle * 3 + (n + 1) % 3];
+		const unsigned int slot = cursors[source]++;
+		adjacency.targets[slot] = target;
+		adjacency.triangles[slot] = static_cast<unsigned int>(triangle);
+	}
+}
+
+bool HasSimplifierEdge(const SimplifierAdjacency& adjacency, unsigned int source, unsigned int target)
+{
+	for (unsigned int e = adjacency.offsets[source]; e < adjacency.offsets[source + 1]; ++e)
+	{
+		if (adjacency.targets[e] == target)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+struct SimplifierPositionKey
+{
+	uint32_t x, y, z;
+	bool operator==(const SimplifierPositionKey& other) const { return x == other.x && y == other.y && z == other.z; }
+};
+
+struct SimplifierPositionKeyHash
+{
+	size_t operator()(const SimplifierPositionKey& key) const
+	{
+		return size_t((key.x * 73856093u) ^ (key.y * 19349663u) ^ (key.z * 83492791u));
+	}
+};
+
+// remap: first vertex with the same position, wedges: circular list of the vertices sharing a position
+void BuildPositionRemap(std::vector<unsigned int>& remap, std::vector<unsigned int>& wedges, const std::vector<glm::vec3>& positions)
+{
+	const size_t vertexCount = positions.size();
+	remap.resize(vertexCount);
+	wedges.resize(vertexCount);
+
+	std::unordered_map<SimplifierPositionKey, unsigned int, SimplifierPositionKeyHash> firstVertices;
+	firstVertices.reserve(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		SimplifierPositionKey key;
+		memcpy(&key, &positions[v], sizeof(key));
+		const auto inserted = firstVertices.insert({ key, static_cast<unsigned int>(v) });
+		const unsigned int first = inserted.first->second;
+
+		remap[v] = first;
+		wedges[v] = static_cast<unsigned int>(v);
+		if (first != v)
+		{
+			wedges[v] = wedges[first];
+			wedges[first] = static_cast<unsigned int>(v);
+		}
+	}
+}
+
+void ClassifyVertices(std::vector<unsigned char>& kinds, const SimplifierAdjacency& adjacency, const std::vector<unsigned int>& remap, const std::vector<unsigned int>& wedges)
+{
+	const size_t vertexCount = remap.size();
+	const unsigned int none = ~0u;
+
+	// open half-edges: no half-edge going the other way in attribute space
+	std::vector<unsigned int> openOutCount(vertexCount, 0), openInCount(vertexCount, 0);
+	std::vector<unsigned int> openOutTarget(vertexCount, none), openInSource(vertexCount, none);
+	for (unsigned int source = 0; source < vertexCount; ++source)
+	{
+		for (unsigned int e = adjacency.offsets[source]; e < adjacency.offsets[source + 1]; ++e)
+		{
+			const unsigned int target = adjacency.targets[e];
+			if (!HasSimplifierEdge(adjacency, target, source))
+			{
+				openOutCount[source]++;
+				openOutTarget[source] = target;
+				openInCount[target]++;
+				openInSource[target] = source;
+			}
+		}
+	}
+
+	kinds.assign(vertexCount, VERTEX_LOCKED);
+	for (unsigned int v = 0; v < vertexCount; ++v)
+	{
+		if (remap[v] != v)
+		{
+			continue;
+		}
+
+		if (wedges[v] == v)
+		{
+			if (openOutCount[v] == 0 && openInCount[v] == 0)
+			{
+				kinds[v] = VERTEX_MANIFOLD;
+			}
+			else if (openOutCount[v] == 1 && openInCount[v] == 1)
+			{
+				kinds[v] = VERTEX_BORDER;
+			}
+		}
+		else if (wedges[wedges[v]] == v)
+		{
+			// both wedges must have one open edge each way, and the open edges of one wedge must pair with the other's
+			const unsigned int w = wedges[v];
+			if (openOutCount[v] == 1 && openInCount[v] == 1 && openOutCount[w] == 1 && openInCount[w] == 1 &&
+				remap[openOutTarget[v]] == remap[openInSource[w]] && remap[openInSource[v]] == remap[openOutTarget[w]])
+			{
+				kinds[v] = VERTEX_SEAM;
+			}
+		}
+	}
+
+	for (unsigned int v = 0; v < vertexCount; ++v)
+	{
+		kinds[v] = kinds[remap[v]];
+	}
+}
+
+void BuildQuadrics(std::vector<SimplifierQuadric>& quadrics, const std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions,
+	const SimplifierAdjacency& adjacency, const std::vector<unsigned int>& remap, const std::vector<unsigned char>& kinds)
+{
+	quadrics.assign(positions.size(), SimplifierQuadric());
+	for (size_t t = 0; t < indices.size() / 3; ++t)
+	{
+		const unsigned int corners[3] = { indices[t * 3 + 0], indices[t * 3 + 1], indices[t * 3 + 2] };
+		const glm::dvec3 p0(positions[corners[0]]), p1(positions[corners[1]]), p2(positions[corners[2]]);
+
+		glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+		const double length = glm::length(normal);
+		if (length == 0.0)
+		{
+			continue;
+		}
+		normal /= length;
+
+		// triangle plane, weighted by area
+		const SimplifierQuadric planeQuadric = QuadricFromPlane(normal, -glm::dot(normal, p0), length * 0.5);
+		for (unsigned int corner : corners)
+		{
+			AddQuadric(quadrics[remap[corner]], planeQuadric);
+		}
+
+		// plane through open edges, perpendicular to the triangle, so borders and seams resist sliding away
+		for (size_t k = 0; k < 3; ++k)
+		{
+			const unsigned int i0 = corners[k];
+			const unsigned int i1 = corners[(k + 1) % 3];
+			const bool isOpenEdgeKind = (kinds[i0] == VERTEX_BORDER || kinds[i0] == VERTEX_SEAM) && (kinds[i1] == VERTEX_BORDER || kinds[i1] == VERTEX_SEAM);
+			if (!isOpenEdgeKind || HasSimplifierEdge(adjacency, i1, i0))
+			{
+				continue;
+			}
+
+			const glm::dvec3 e0(positions[i0]);
+			const glm::dvec3 edge = glm::dvec3(positions[i1]) - e0;
+			const double edgeLength = glm::length(edge);
+			const glm::dvec3 edgeNormal = glm::cross(edge / edgeLength, normal);
+			const SimplifierQuadric edgeQuadric = QuadricFromPlane(edgeNormal, -glm::dot(edgeNormal, e0), edgeLength * edgeLength * SIMPLIFIER_EDGE_WEIGHT);
+			AddQuadric(quadrics[remap[i0]], edgeQuadric);
+			AddQuadric(quadrics[remap[i1]], edgeQuadric);
+		}
+	}
+}
+
+// Moving source onto target must not turn any of the remaining triangles around source upside down
+bool HasSimplifierTriangleFlip(const SimplifierAdjacency& adjacency, const std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions,
+	const std::vector<unsigned int>& remap, const std::vector<unsigned int>& wedges, unsigned int source, unsigned int target)
+{
+	const unsigned int sourcePosition = remap[source];
+	const unsigned int targetPosition = remap[target];
+	const glm::vec3 newPosition = positions[target];
+
+	unsigned int wedge = source;
+	do
+	{
+		for (unsigned int e = adjacency.offsets[wedge]; e < adjacency.offsets[wedge + 1]; ++e)
+		{
+			const unsigned int* triangle = &indices[size_t(adjacency.triangles[e]) * 3];
+			if (remap[triangle[0]] == targetPosition || remap[triangle[1]] == targetPosition || remap[triangle[2]] == targetPosition)
+			{
+				// collapses into a degenerate triangle and gets removed
+				continue;
+			}
+
+			glm::vec3 before[3], after[3];
+			for (size_t k = 0; k < 3; ++k)
+			{
+				before[k] = positions[triangle[k]];
+				after[k] = remap[triangle[k]] == sourcePosition ? newPosition : before[k];
+			}
+
+			const glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+			const glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+			if (glm::dot(normalBefore, normalAfter) <= 1e-2f * glm::length(normalBefore) * glm::length(normalAfter))
+			{
+				return true;
+			}
+		}
+		wedge = wedges[wedge];
+	} while (wedge != source);
+
+	return false;
+}
+
+struct SimplifierCollapse
+{
+	unsigned int source;
+	unsigned int target;
+	float error;
+};
+
+std::vector<unsigned int> MeshSimplifier::Simplify(const std::vector<unsigned int>& indices,
+	const unsigned char* vertexData, size_t vertexStride, size_t positionOffset, size_t vertexCount,
+	size_t targetIndexCount, float* resultError)
+{
+	std::vector<unsigned int> result = indices;
+	float maxError = 0.0f;
+
+	std::vector<glm::vec3> positions(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		memcpy(&positions[v], vertexData + v * vertexStride + positionOffset, sizeof(glm::vec3));
+	}
+
+	std::vector<unsigned int> remap, wedges;
+	BuildPositionRemap(remap, wedges, positions);
+
+	// vertex kinds and quadrics come from the original topology, collapses keep borders and seams where they are
+	SimplifierAdjacency adjacency;
+	BuildSimplifierAdjacency(adjacency, result, vertexCount);
+
+	std::vector<unsigned char> kinds;
+	ClassifyVertices(kinds, adjacency, remap, wedges);
+
+	std::vector<SimplifierQuadric> quadrics;
+	BuildQuadrics(quadrics, result, positions, adjacency, remap, kinds);
+
+	std::vector<SimplifierCollapse> collapses;
+	std::vector<unsigned int> collapseRemap(vertexCount);
+	std::vector<bool> isCollapseLocked(vertexCount);
+
+	// every pass collapses a batch of independent edges (no vertex is touched twice) in increasing error order
+	while (result.size() > targetIndexCount)
+	{
+		collapses.clear();
+		for (size_t n = 0; n < result.size(); ++n)
+		{
+			const unsigned int i0 = result[n];
+			const unsigned int i1 = result[(n / 3) * 3 + (n + 1) % 3];
+			if (remap[i0] == remap[i1])
+			{
+				continue;
+			}
+
+			// closed edges show up once per side, keep one of them
+			const bool hasOpposite = HasSimplifierEdge(adjacency, i1, i0);
+			if (hasOpposite && remap[i0] > remap[i1])
+			{
+				continue;
+			}
+
+			const bool canCollapse01 = SIMPLIFIER_CAN_COLLAPSE[kinds[i0]][kinds[i1]] && (!SIMPLIFIER_NEEDS_OPEN_EDGE[kinds[i0]] || !hasOpposite);
+			const bool canCollapse10 = SIMPLIFIER_CAN_COLLAPSE[kinds[i1]][kinds[i0]] && (!SIMPLIFIER_NEEDS_OPEN_EDGE[kinds[i1]] || !hasOpposite);
+			const float error01 = canCollapse01 ? static_cast<float>(QuadricError(quadrics[remap[i0]], positions[i1])) : 0.0f;
+			const float error10 = canCollapse10 ? static_cast<float>(QuadricError(quadrics[remap[i1]], positions[i0])) : 0.0f;
+
+			if (canCollapse01 && (!canCollapse10 || error01 <= error10))
+			{
+				collapses.push_back({ i0, i1, error01 });
+			}
+			else if (canCollapse10)
+			{
+				collapses.push_back({ i1, i0, error10 });
+			}
+		}
+		if (collapses.empty())
+		{
+			break;
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const SimplifierCollapse& a, const SimplifierCollapse& b) { return a.error < b.error; });
+
+		// each collapse removes about 2 triangles; don't take collapses much worse than the one that would reach the goal
+		const size_t edgeCollapseGoal = std::max<size_t>((result.size() - targetIndexCount) / 6, 1);
+		const float errorLimit = collapses[std::min(edgeCollapseGoal, collapses.size()) - 1].error * 1.5f;
+
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			collapseRemap[v] = static_cast<unsigned int>(v);
+		}
+		std::fill(isCollapseLocked.begin(), isCollapseLocked.end(), false);
+
+		size_t appliedCollapses = 0;
+		for (const SimplifierCollapse& collapse : collapses)
+		{
+			if (appliedCollapses >= edgeCollapseGoal || collapse.error > errorLimit)
+			{
+				break;
+			}
+
+			const unsigned int sourcePosition = remap[collapse.source];
+			const unsigned int targetPosition = remap[collapse.target];
+			if (isCollapseLocked[sourcePosition] || isCollapseLocked[targetPosition])
+			{
+				continue;
+			}
+			if (HasSimplifierTriangleFlip(adjacency, result, positions, remap, wedges, collapse.source, collapse.target))
+			{
+				continue;
+			}
+
+			collapseRemap[collapse.source] = collapse.target;
+			if (kinds[collapse.source] == VERTEX_SEAM)
+			{
+				// the twin wedge follows along the other side of the seam
+				collapseRemap[wedges[collapse.source]] = wedges[collapse.target];
+			}
+
+			isCollapseLocked[sourcePosition] = true;
+			isCollapseLocked[targetPosition] = true;
+			AddQuadric(quadrics[targetPosition], quadrics[sourcePosition]);
+			maxError = std::max(maxError, collapse.error);
+			appliedCollapses++;
+		}
+		if (appliedCollapses == 0)
+		{
+			break;
+		}
+
+		// apply the collapses and drop the triangles that became degenerate
+		size_t writeCursor = 0;
+		for (size_t t = 0; t < result.size() / 3; ++t)
+		{
+			const unsigned int a = collapseRemap[result[t * 3 + 0]];
+			const unsigned int b = collapseRemap[result[t * 3 + 1]];
+			const unsigned int c = collapseRemap[result[t * 3 + 2]];
+			if (remap[a] != remap[b] && remap[b] != remap[c] && remap[c] != remap[a])
+			{
+				result[writeCursor++] = a;
+				result[writeCursor++] = b;
+				result[writeCursor++] = c;
+			}
+		}
+		result.resize(writeCursor);
+
+		BuildSimplifierAdjacency(adjacency, result, vertexCount);
+	}
+
+	if (resultError)
+	{
+		*resultError = std::sqrt(maxError);
+	}
+	return result;
+}
+
+void MeshSimplifier::BuildLodChain(MeshLodChain& lodChain, const std::vector<unsigned int>& indices,
+	const unsigned char* vertexData, size_t vertexStride, size_t positionOffset, size_t vertexCount,
+	size_t levelCount)
+{
+	lodChain.levels.clear();
+	lodChain.indices.clear();
+	lodChain.levels.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+
+	// bounding sphere used by SelectLod
+	lodChain.boundsCenter = glm::vec3(0.0f);
+	lodChain.boundsRadius = 0.0f;
+	if (vertexCount > 0)
+	{
+		auto getPosition = [&](size_t v)
+		{
+			glm::vec3 position;
+			memcpy(&position, vertexData + v * vertexStride + positionOffset, sizeof(glm::vec3));
+			return position;
+		};
+
+		glm::vec3 boundsMin = getPosition(0);
+		glm::vec3 boundsMax = boundsMin;
+		for (size_t v = 1; v < vertexCount; ++v)
+		{
+			boundsMin = glm::min(boundsMin, getPosition(v));
+			boundsMax = glm::max(boundsMax, getPosition(v));
+		}
+		lodChain.boundsCenter = (boundsMin + boundsMax) * 0.5f;
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			lodChain.boundsRadius = std::max(lodChain.boundsRadius, glm::length(getPosition(v) - lodChain.boundsCenter));
+		}
+	}
+
+	// only triangle lists can be simplified
+	if (indices.size() % 3 != 0)
+	{
+		return;
+	}
+
+	size_t previousIndexCount = indices.size();
+	for (size_t level = 1; level < levelCount; ++level)
+	{
+		// every level is simplified from the full mesh so that the errors are measured against it
+		const size_t targetIndexCount = (indices.size() / 3 >> level) * 3;
+		float error = 0.0f;
+		std::vector<unsigned int> lodIndices = Simplify(indices, vertexData, vertexStride, positionOffset, vertexCount, targetIndexCount, &error);
+		if (lodIndices.empty() || lodIndices.size() >= previousIndexCount)
+		{
+			break;
+		}
+
+		MeshOptimizer::OptimizeVertexCache(lodIndices, vertexCount);
+
+		const uint32_t indexOffset = static_cast<uint32_t>(indices.size() + lodChain.indices.size());
+		lodChain.levels.push_back({ indexOffset, static_cast<uint32_t>(lodIndices.size()), std::max(error, lodChain.levels.back().error) });
+		lodChain.indices.insert(lodChain.indices.end(), lodIndices.begin(), lodIndices.end());
+		previousIndexCount = lodIndices.size();
+	}
+}
+
+size_t MeshSimplifier::SelectLod(const MeshLodChain& lodChain, const glm::mat4& model, const glm::vec3& cameraPosition,
+	float fovY, float viewportHeight, float maxPixelError)
+{
+	if (lodChain.levels.empty())
+	{
+		return 0;
+	}
+
+	// errors and bounds are in model units
+	const float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	const glm::vec3 center = glm::vec3(model * glm::vec4(lodChain.boundsCenter, 1.0f));
+
+	// distance to the closest point of the bounding sphere, the camera inside it always gets the full mesh
+	const float distance = glm::length(center - cameraPosition) - lodChain.boundsRadius * scale;
+	if (distance <= 0.0f)
+	{
+		return 0;
+	}
+
+	const float pixelsPerUnit = viewportHeight / (2.0f * std::tan(fovY * 0.5f) * distance);
+	for (size_t level = lodChain.levels.size() - 1; level > 0; --level)
+	{
+		if (lodChain.levels[level].error * scale * pixelsPerUnit <= maxPixelError)
+		{
+			return level;
+		}
+	}
+	return 0;
+}
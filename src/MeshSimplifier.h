@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// One level of detail: a range of indices over the shared vertex buffer
+struct MeshLod
+{
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	// geometric deviation from the full resolution mesh, in model units
+	float error;
+};
+
+// Levels of detail of a mesh, level 0 is the full resolution mesh.
+// Offsets point into the mesh index buffer followed by MeshLodChain::indices.
+struct MeshLodChain
+{
+	std::vector<MeshLod> levels;
+	std::vector<unsigned int> indices;
+
+	// bounding sphere of the mesh, in model units
+	glm::vec3 boundsCenter = glm::vec3(0.0f);
+	float boundsRadius = 0.0f;
+};
+
+// Index buffer simplification by quadric error edge collapses (Garland & Heckbert).
+// Vertices are never moved or created, the simplified triangles reuse the original vertex buffer.
+// Vertices sharing a position but not the other attributes (uv / normal seams) only collapse along the seam
+// together with their twin, and mesh borders only collapse along the border, so seams and borders keep their shape.
+class MeshSimplifier
+{
+public:
+	// Collapses edges until the index count reaches targetIndexCount or no collapse is possible anymore.
+	// Returns the simplified indices, resultError receives the deviation in model units.
+	static std::vector<unsigned int> Simplify(const std::vector<unsigned int>& indices,
+		const unsigned char* vertexData, size_t vertexStride, size_t positionOffset, size_t vertexCount,
+		size_t targetIndexCount, float* resultError = nullptr);
+
+	// Level 0 is indices itself, each next level targets half the triangles of the previous one.
+	// Stops early when a level can't be simplified further.
+	static void BuildLodChain(MeshLodChain& lodChain, const std::vector<unsigned int>& indices,
+		const unsigned char* vertexData, size_t vertexStride, size_t positionOffset, size_t vertexCount,
+		size_t levelCount = 4);
+
+	// Picks the coarsest level whose error projected on screen stays under maxPixelError.
+	// fovY is in radians, viewportHeight in pixels.
+	static size_t SelectLod(const MeshLodChain& lodChain, const glm::mat4& model, const glm::vec3& cameraPosition,
+		float fovY, float viewportHeight, float maxPixelError = 1.0f);
+};
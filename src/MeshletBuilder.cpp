@@ -0,0 +1,220 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+glm::vec3 ReadMeshletPosition(const unsigned char* vertexData, size_t vertexStride, size_t positionOffset, unsigned int vertex)
+{
+	glm::vec3 position;
+	memcpy(&position, vertexData + size_t(vertex) * vertexStride + positionOffset, sizeof(glm::vec3));
+	return position;
+}
+
+// Bounding sphere and normal cone of a finished meshlet
+void ComputeMeshletBounds(Meshlet& meshlet, const MeshletData& meshletData, const unsigned char* vertexData, size_t vertexStride, size_t positionOffset)
+{
+	auto getPosition = [&](size_t localVertex)
+	{
+		return ReadMeshletPosition(vertexData, vertexStride, positionOffset, meshletData.vertices[meshlet.vertexOffset + localVertex]);
+	};
+
+	// sphere around the AABB center
+	glm::vec3 boundsMin = getPosition(0);
+	glm::vec3 boundsMax = boundsMin;
+	for (size_t v = 1; v < meshlet.vertexCount; ++v)
+	{
+		boundsMin = glm::min(boundsMin, getPosition(v));
+		boundsMax = glm::max(boundsMax, getPosition(v));
+	}
+	meshlet.center = (boundsMin + boundsMax) * 0.5f;
+	meshlet.radius = 0.0f;
+	for (size_t v = 0; v < meshlet.vertexCount; ++v)
+	{
+		meshlet.radius = std::max(meshlet.radius, glm::length(getPosition(v) - meshlet.center));
+	}
+
+	// cone axis: average of the triangle normals
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec3> corners;
+	normals.reserve(meshlet.triangleCount);
+	corners.reserve(meshlet.triangleCount);
+	glm::vec3 axis(0.0f);
+	for (size_t t = 0; t < meshlet.triangleCount; ++t)
+	{
+		const unsigned char* triangle = &meshletData.triangles[meshlet.triangleOffset + t * 3];
+		const glm::vec3 p0 = getPosition(triangle[0]);
+		const glm::vec3 normal = glm::cross(getPosition(triangle[1]) - p0, getPosition(triangle[2]) - p0);
+		const float area = glm::length(normal);
+		// degenerate triangles can't be backfacing
+		if (area > 0.0f)
+		{
+			normals.push_back(normal / area);
+			corners.push_back(p0);
+			axis += normal / area;
+		}
+	}
+
+	meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+	meshlet.coneCutoff = 1.0f;
+	meshlet.coneApex = meshlet.center;
+
+	const float axisLength = glm::length(axis);
+	if (axisLength == 0.0f)
+	{
+		return;
+	}
+	axis /= axisLength;
+
+	float minDot = 1.0f;
+	for (const glm::vec3& normal : normals)
+	{
+		minDot = std::min(minDot, glm::dot(normal, axis));
+	}
+	// normals spread over (almost) a hemisphere, the cone would never cull anything
+	if (minDot <= 0.1f)
+	{
+		return;
+	}
+
+	// move the apex back along the axis until it is behind every triangle plane
+	float maxT = 0.0f;
+	for (size_t t = 0; t < normals.size(); ++t)
+	{
+		const float distanceToPlane = glm::dot(meshlet.center - corners[t], normals[t]);
+		maxT = std::max(maxT, distanceToPlane / glm::dot(axis, normals[t]));
+	}
+
+	meshlet.coneAxis = axis;
+	meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+	meshlet.coneApex = meshlet.center - axis * maxT;
+}
+
+void MeshletBuilder::BuildMeshlets(MeshletData& meshletData, const std::vector<unsigned int>& indices,
+	const unsigned char* vertexData, size_t vertexStride, size_t positionOffset,
+	size_t maxVertices, size_t maxTriangles)
+{
+	meshletData.meshlets.clear();
+	meshletData.vertices.clear();
+	meshletData.triangles.clear();
+
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// local index of each mesh vertex in the current meshlet, 0xff when it is not part of it (so at most 255 vertices)
+	maxVertices = std::min<size_t>(maxVertices, 0xff);
+	const unsigned int vertexCount = *std::max_element(indices.begin(), indices.end()) + 1;
+	std::vector<unsigned char> localIndices(vertexCount, 0xff);
+
+	Meshlet current = {};
+	auto finishMeshlet = [&]()
+	{
+		ComputeMeshletBounds(current, meshletData, vertexData, vertexStride, positionOffset);
+		meshletData.meshlets.push_back(current);
+
+		for (size_t v = 0; v < current.vertexCount; ++v)
+		{
+			localIndices[meshletData.vertices[current.vertexOffset + v]] = 0xff;
+		}
+
+		current = {};
+		current.vertexOffset = static_cast<uint32_t>(meshletData.vertices.size());
+		current.triangleOffset = static_cast<uint32_t>(meshletData.triangles.size());
+	};
+
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		const unsigned int a = indices[t * 3 + 0];
+		const unsigned int b = indices[t * 3 + 1];
+		const unsigned int c = indices[t * 3 + 2];
+
+		const size_t newVertices = (localIndices[a] == 0xff) + (localIndices[b] == 0xff) + (localIndices[c] == 0xff);
+		if (current.vertexCount + newVertices > maxVertices || current.triangleCount + 1 > maxTriangles)
+		{
+			finishMeshlet();
+		}
+
+		for (unsigned int vertex : { a, b, c })
+		{
+			if (localIndices[vertex] == 0xff)
+			{
+				localIndices[vertex] = static_cast<unsigned char>(current.vertexCount++);
+				meshletData.vertices.push_back(vertex);
+			}
+			meshletData.triangles.push_back(localIndices[vertex]);
+		}
+		current.triangleCount++;
+	}
+
+	if (current.triangleCount > 0)
+	{
+		finishMeshlet();
+	}
+}
+
+MeshletCullingStatistics MeshletBuilder::CullMeshlets(const MeshletData& meshletData, const glm::mat4& model, const glm::mat4& view,
+	const glm::mat4& projection, const glm::vec3& cameraPosition, std::vector<unsigned int>& visibleIndices)
+{
+	MeshletCullingStatistics statistics;
+	visibleIndices.clear();
+
+	// Frustum planes in model space (Gribb & Hartmann), normalized so that distances are in model units.
+	// Testing in model space avoids transforming every meshlet.
+	const glm::mat4 clip = projection * view * model;
+	glm::vec4 planes[6];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		for (int side = 0; side < 2; ++side)
+		{
+			glm::vec4& plane = planes[axis * 2 + side];
+			for (int column = 0; column < 4; ++column)
+			{
+				plane[column] = clip[column][3] + (side == 0 ? clip[column][axis] : -clip[column][axis]);
+			}
+			plane /= glm::length(glm::vec3(plane));
+		}
+	}
+
+	const glm::vec3 modelCameraPosition = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+
+	for (const Meshlet& meshlet : meshletData.meshlets)
+	{
+		bool isOutside = false;
+		for (const glm::vec4& plane : planes)
+		{
+			if (glm::dot(glm::vec3(plane), meshlet.center) + plane.w < -meshlet.radius)
+			{
+				isOutside = true;
+				break;
+			}
+		}
+		if (isOutside)
+		{
+			statistics.frustumCulledMeshlets++;
+			continue;
+		}
+
+		const glm::vec3 apexDirection = meshlet.coneApex - modelCameraPosition;
+		const float apexDistance = glm::length(apexDirection);
+		if (apexDistance > 0.0f && glm::dot(apexDirection, meshlet.coneAxis) >= meshlet.coneCutoff * apexDistance)
+		{
+			statistics.backfaceCulledMeshlets++;
+			continue;
+		}
+
+		const unsigned int* meshletVertices = &meshletData.vertices[meshlet.vertexOffset];
+		const unsigned char* meshletTriangles = &meshletData.triangles[meshlet.triangleOffset];
+		for (size_t n = 0; n < size_t(meshlet.triangleCount) * 3; ++n)
+		{
+			visibleIndices.push_back(meshletVertices[meshletTriangles[n]]);
+		}
+
+		statistics.visibleMeshlets++;
+		statistics.visibleTriangles += meshlet.triangleCount;
+	}
+
+	return statistics;
+}
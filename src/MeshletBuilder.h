@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Small cluster of triangles with its own local vertex list and culling bounds
+struct Meshlet
+{
+	uint32_t vertexOffset;		// first entry in MeshletData::vertices
+	uint32_t triangleOffset;	// first entry in MeshletData::triangles (3 local indices per triangle)
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+
+	// bounding sphere
+	glm::vec3 center;
+	float radius;
+
+	// normal cone: every triangle is backfacing when dot(normalize(coneApex - cameraPosition), coneAxis) >= coneCutoff
+	// (coneCutoff is 1 when the triangles spread too much for the cone to ever cull)
+	glm::vec3 coneAxis;
+	float coneCutoff;
+	glm::vec3 coneApex;
+	float padding;
+};
+
+struct MeshletData
+{
+	std::vector<Meshlet> meshlets;
+	std::vector<unsigned int> vertices;		// mesh vertex index of every meshlet local vertex
+	std::vector<unsigned char> triangles;	// meshlet local vertex indices
+};
+
+struct MeshletCullingStatistics
+{
+	size_t visibleMeshlets = 0;
+	size_t frustumCulledMeshlets = 0;
+	size_t backfaceCulledMeshlets = 0;
+	size_t visibleTriangles = 0;
+};
+
+class MeshletBuilder
+{
+public:
+	static const size_t MAX_VERTICES = 64;
+	static const size_t MAX_TRIANGLES = 124;
+
+	// Splits the triangle list into meshlets, in index buffer order (run it after MeshOptimizer for tighter clusters)
+	static void BuildMeshlets(MeshletData& meshletData, const std::vector<unsigned int>& indices,
+		const unsigned char* vertexData, size_t vertexStride, size_t positionOffset,
+		size_t maxVertices = MAX_VERTICES, size_t maxTriangles = MAX_TRIANGLES);
+
+	// Culls the meshlets against the view frustum and their normal cones and writes the indices of the visible ones.
+	// cameraPosition is in world space, the meshlet bounds are transformed with model.
+	static MeshletCullingStatistics CullMeshlets(const MeshletData& meshletData, const glm::mat4& model, const glm::mat4& view,
+		const glm::mat4& projection, const glm::vec3& cameraPosition, std::vector<unsigned int>& visibleIndices);
+};
@@ -0,0 +1,100 @@
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include <stb/stb_image_resize.h>
+
+#include "ThreadPool.h"
+
+// Output rows filtered by one job, small enough to spread a 1K level over the workers
+const uint32_t MIP_BAND_ROWS = 32;
+
+// Rescales every normal to unit length, normals shrink when neighbours pointing different ways get averaged
+void RenormalizeMipNormals(unsigned char* pixels, size_t texelCount, uint32_t channels)
+{
+	for (size_t n = 0; n < texelCount; ++n)
+	{
+		unsigned char* texel = pixels + n * channels;
+		float normal[3];
+		for (int c = 0; c < 3; ++c)
+		{
+			normal[c] = texel[c] * (2.0f / 255.0f) - 1.0f;
+		}
+		const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (length == 0.0f)
+		{
+			continue;
+		}
+		for (int c = 0; c < 3; ++c)
+		{
+			const float value = (normal[c] / length * 0.5f + 0.5f) * 255.0f + 0.5f;
+			texel[c] = static_cast<unsigned char>(std::min(std::max(value, 0.0f), 255.0f));
+		}
+	}
+}
+
+uint32_t MipGenerator::GetMipCount(uint32_t width, uint32_t height)
+{
+	uint32_t count = 1;
+	uint32_t size = std::max(width, height);
+	while (size > 1)
+	{
+		size /= 2;
+		count++;
+	}
+	return count;
+}
+
+MipLevel MipGenerator::Downsample(const unsigned char* pixels, uint32_t width, uint32_t height, uint32_t channels, MipGenerationMode mode)
+{
+	MipLevel level;
+	level.width = std::max(width / 2, 1u);
+	level.height = std::max(height / 2, 1u);
+	level.pixels.resize(size_t(level.width) * level.height * channels);
+
+	const size_t rowSize = size_t(level.width) * channels;
+	const int alphaChannel = (mode == MIP_GENERATION_SRGB && channels == 4) ? 3 : STBIR_ALPHA_CHANNEL_NONE;
+	const stbir_colorspace colorSpace = mode == MIP_GENERATION_SRGB ? STBIR_COLORSPACE_SRGB : STBIR_COLORSPACE_LINEAR;
+	const uint32_t bandCount = (level.height + MIP_BAND_ROWS - 1) / MIP_BAND_ROWS;
+	ThreadPool::GetShared().ParallelFor(bandCount, [&](size_t band)
+	{
+		// the band's share of the source, in [0, 1] coordinates, keeps the same scale as filtering the whole level at once
+		const uint32_t firstRow = static_cast<uint32_t>(band) * MIP_BAND_ROWS;
+		const uint32_t endRow = std::min(firstRow + MIP_BAND_ROWS, level.height);
+		unsigned char* output = &level.pixels[rowSize * firstRow];
+		stbir_resize_region(pixels, static_cast<int>(width), static_cast<int>(height), static_cast<int>(size_t(width) * channels),
+			output, static_cast<int>(level.width), static_cast<int>(endRow - firstRow), static_cast<int>(rowSize),
+			STBIR_TYPE_UINT8, static_cast<int>(channels), alphaChannel, 0,
+			STBIR_EDGE_WRAP, STBIR_EDGE_WRAP, STBIR_FILTER_DEFAULT, STBIR_FILTER_DEFAULT, colorSpace, nullptr,
+			0.0f, float(firstRow) / float(level.height), 1.0f, float(endRow) / float(level.height));
+
+		if (mode == MIP_GENERATION_NORMAL_MAP && channels >= 3)
+		{
+			RenormalizeMipNormals(output, size_t(level.width) * (endRow - firstRow), channels);
+		}
+	});
+	return level;
+}
+
+std::vector<MipLevel> MipGenerator::GenerateMipChain(const unsigned char* pixels, uint32_t width, uint32_t height, uint32_t channels,
+	MipGenerationMode mode)
+{
+	std::vector<MipLevel> levels;
+	const uint32_t mipCount = GetMipCount(width, height);
+	levels.reserve(mipCount - 1);
+	for (uint32_t level = 1; level < mipCount; ++level)
+	{
+		if (level == 1)
+		{
+			levels.push_back(Downsample(pixels, width, height, channels, mode));
+		}
+		else
+		{
+			const MipLevel& previous = levels.back();
+			levels.push_back(Downsample(previous.pixels.data(), previous.width, previous.height, channels, mode));
+		}
+	}
+	return levels;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// One generated mip level, rows tightly packed
+struct MipLevel
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<unsigned char> pixels;
+};
+
+// How the texels of an image are averaged
+enum MipGenerationMode : uint32_t
+{
+	// plain data (roughness, ambient occlusion, displacement, ...)
+	MIP_GENERATION_LINEAR = 0,
+	// sRGB encoded color, converted to linear for the filtering then back, a 4th channel is alpha
+	MIP_GENERATION_SRGB,
+	// tangent space normals remapped to [0, 1] in the first 3 channels, renormalized after the filtering
+	MIP_GENERATION_NORMAL_MAP,
+};
+
+// Builds mip chains of 8 bit images on the CPU with stb_image_resize.
+// The filter wraps around the edges, matching the GL_REPEAT sampling of the material textures.
+class MipGenerator
+{
+public:
+	// Number of levels of a full chain down to 1x1, level 0 included
+	static uint32_t GetMipCount(uint32_t width, uint32_t height);
+
+	// Half size image (rounded down, at least 1). Bands of rows are filtered concurrently on the shared ThreadPool.
+	static MipLevel Downsample(const unsigned char* pixels, uint32_t width, uint32_t height, uint32_t channels, MipGenerationMode mode);
+
+	// Levels 1 to GetMipCount() - 1, each one downsampled from the previous one
+	static std::vector<MipLevel> GenerateMipChain(const unsigned char* pixels, uint32_t width, uint32_t height, uint32_t channels,
+		MipGenerationMode mode);
+};
@@ -0,0 +1,162 @@
+#include "PixelUploadRing.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include <glad/glad.h>
+
+// Offset alignment of the blocks
+const size_t PIXEL_UPLOAD_ALIGNMENT = 16;
+
+PixelUploadSlice::PixelUploadSlice(PixelUploadSlice&& other) noexcept
+	: data(other.data), size(other.size), ring(other.ring), offset(other.offset)
+{
+	other.ring = nullptr;
+}
+
+PixelUploadSlice& PixelUploadSlice::operator=(PixelUploadSlice&& other) noexcept
+{
+	if (this != &other)
+	{
+		if (ring)
+		{
+			ring->blocks.Submit(offset);
+		}
+		data = other.data;
+		size = other.size;
+		ring = other.ring;
+		offset = other.offset;
+		other.ring = nullptr;
+	}
+	return *this;
+}
+
+PixelUploadSlice::~PixelUploadSlice()
+{
+	// never uploaded, nothing reads the block: submitting it lets the next fence release it
+	if (ring)
+	{
+		ring->blocks.Submit(offset);
+	}
+}
+
+PixelUploadRing::PixelUploadRing(size_t capacity)
+	: blocks(capacity, PIXEL_UPLOAD_ALIGNMENT)
+{
+	if (glBufferStorage == nullptr)
+	{
+		std::cout << "PIXEL_UPLOAD_RING::NO_BUFFER_STORAGE, texture uploads read from client memory" << std::endl;
+		return;
+	}
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+	glBufferStorage(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(capacity), nullptr, flags);
+	mapping = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(capacity), flags));
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	if (mapping == nullptr)
+	{
+		std::cout << "ERROR::PIXEL_UPLOAD_RING::MAP_FAILED" << std::endl;
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+	}
+}
+
+PixelUploadRing::~PixelUploadRing()
+{
+	for (const Fence& fence : fences)
+	{
+		glDeleteSync(static_cast<GLsync>(fence.sync));
+	}
+	// deleting the buffer unmaps it
+	glDeleteBuffers(1, &buffer);
+}
+
+void PixelUploadRing::Update()
+{
+	if (blocks.Fence(nextFence))
+	{
+		Fence fence;
+		fence.sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		fence.serial = nextFence++;
+		fences.push_back(fence);
+	}
+
+	// fences signal in order, polling stops at the first pending one
+	uint64_t signaledFence = 0;
+	while (!fences.empty())
+	{
+		const GLenum result = glClientWaitSync(static_cast<GLsync>(fences.front().sync), GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+		{
+			break;
+		}
+		glDeleteSync(static_cast<GLsync>(fences.front().sync));
+		signaledFence = fences.front().serial;
+		fences.pop_front();
+	}
+	if (signaledFence != 0)
+	{
+		blocks.Release(signaledFence);
+	}
+}
+
+PixelUploadSlice PixelUploadRing::Stage(PixelUploadRing* ring, const void* data, size_t size)
+{
+	PixelUploadSlice slice;
+	slice.data = data;
+	slice.size = size;
+	if (!ring || !ring->IsAvailable() || !ring->blocks.Reserve(size, slice.offset))
+	{
+		return slice;
+	}
+
+	// the block is ours until it is submitted, the copy doesn't need the lock
+	std::memcpy(ring->mapping + slice.offset, data, size);
+	slice.ring = ring;
+	return slice;
+}
+
+void PixelUploadRing::StageRows(PixelUploadRing* ring, uint32_t image, uint32_t level, const unsigned char* pixels, size_t rowSize,
+	uint32_t rowCount, size_t sliceBytes, std::vector<PixelUploadBand>& bands)
+{
+	const uint32_t bandRows = static_cast<uint32_t>(std::max<size_t>(sliceBytes / std::max<size_t>(rowSize, 1), 1));
+	for (uint32_t firstRow = 0; firstRow < rowCount; firstRow += bandRows)
+	{
+		PixelUploadBand band;
+		band.image = image;
+		band.level = level;
+		band.firstRow = firstRow;
+		band.rows = std::min(bandRows, rowCount - firstRow);
+		band.pixels = Stage(ring, pixels + rowSize * firstRow, rowSize * band.rows);
+		bands.push_back(std::move(band));
+	}
+}
+
+void PixelUploadRing::Upload(PixelUploadSlice& slice, const std::function<void(const void*)>& upload)
+{
+	if (!slice.ring)
+	{
+		upload(slice.data);
+		return;
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slice.ring->buffer);
+	upload(reinterpret_cast<const void*>(slice.offset));
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	slice.ring->blocks.Submit(slice.offset);
+	slice.ring = nullptr;
+}
+
+PixelUploadRingStatistics PixelUploadRing::GetStatistics() const
+{
+	const RingAllocatorStatistics blockStatistics = blocks.GetStatistics();
+	PixelUploadRingStatistics statistics;
+	statistics.capacity = IsAvailable() ? blockStatistics.capacity : 0;
+	statistics.usedBytes = blockStatistics.usedBytes;
+	statistics.stagedBytes = blockStatistics.reservedBytes;
+	statistics.fullCount = blockStatistics.fullCount;
+	return statistics;
+}
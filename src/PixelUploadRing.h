@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "RingAllocator.h"
+
+class PixelUploadRing;
+
+// Pixels of one gl*TexSubImage call: copied to a block of a PixelUploadRing by PixelUploadRing::Stage, or read from the
+// client memory they are in. A staged block that is never uploaded is given back when its slice is destroyed.
+class PixelUploadSlice
+{
+public:
+	PixelUploadSlice() = default;
+	PixelUploadSlice(PixelUploadSlice&& other) noexcept;
+	PixelUploadSlice& operator=(PixelUploadSlice&& other) noexcept;
+	~PixelUploadSlice();
+
+	PixelUploadSlice(const PixelUploadSlice&) = delete;
+	PixelUploadSlice& operator=(const PixelUploadSlice&) = delete;
+
+	bool IsStaged() const { return ring != nullptr; }
+	size_t GetSize() const { return size; }
+
+private:
+	friend class PixelUploadRing;
+
+	const void* data = nullptr;
+	size_t size = 0;
+	// ring holding the copy at offset, nullptr when data is read instead
+	PixelUploadRing* ring = nullptr;
+	size_t offset = 0;
+};
+
+// Rows [firstRow, firstRow + rows) of a level of an image, uploaded by one gl*TexSubImage call
+struct PixelUploadBand
+{
+	uint32_t image = 0;
+	uint32_t level = 0;
+	uint32_t firstRow = 0;
+	uint32_t rows = 0;
+	PixelUploadSlice pixels;
+};
+
+struct PixelUploadRingStatistics
+{
+	size_t capacity = 0;
+	// staged and not released yet, the GPU may still be reading them
+	size_t usedBytes = 0;
+	size_t stagedBytes = 0;
+	// slices left in client memory because the ring was full
+	size_t fullCount = 0;
+};
+
+// Persistently mapped GL_PIXEL_UNPACK_BUFFER the texture uploads stage their pixels in. The workers that decode an image
+// copy its rows to the mapping, so the GL thread only issues the gl*TexSubImage calls reading them from the buffer, without
+// the driver copying client memory before it returns. A block is released once the fence issued after its upload is
+// signaled, in ring order. Staging never waits: a slice that doesn't fit is uploaded from client memory.
+// Needs glBufferStorage (GL 4.4 or ARB_buffer_storage). Without it IsAvailable is false and nothing is staged.
+class PixelUploadRing
+{
+public:
+	// GL thread
+	explicit PixelUploadRing(size_t capacity);
+	// GL thread, after every slice staged in it is destroyed
+	~PixelUploadRing();
+
+	PixelUploadRing(const PixelUploadRing&) = delete;
+	PixelUploadRing& operator=(const PixelUploadRing&) = delete;
+
+	bool IsAvailable() const { return buffer != 0; }
+
+	// GL thread, once per frame: fences the slices uploaded since the last call and releases the blocks the GPU is done with
+	void Update();
+
+	// Any thread, meant for the worker that decoded data: copies size bytes of data to a free block of ring.
+	// The slice reads data itself without a ring, when the ring is full or when size is larger than it.
+	static PixelUploadSlice Stage(PixelUploadRing* ring, const void* data, size_t size);
+	// Any thread: splits rowCount rows of rowSize bytes at pixels into bands of about sliceBytes (at least one row), staged
+	// one after the other, and appends them to bands
+	static void StageRows(PixelUploadRing* ring, uint32_t image, uint32_t level, const unsigned char* pixels, size_t rowSize,
+		uint32_t rowCount, size_t sliceBytes, std::vector<PixelUploadBand>& bands);
+
+	// GL thread. Calls upload with the pixels pointer for its gl*TexSubImage call: the offset of the staged copy with the ring
+	// bound as GL_PIXEL_UNPACK_BUFFER, or the client memory of the slice. The block goes back to the ring once the GPU read it.
+	static void Upload(PixelUploadSlice& slice, const std::function<void(const void*)>& upload);
+
+	PixelUploadRingStatistics GetStatistics() const;
+
+private:
+	friend class PixelUploadSlice;
+
+	struct Fence
+	{
+		void* sync = nullptr;	// GLsync
+		uint64_t serial = 0;
+	};
+
+	unsigned int buffer = 0;
+	unsigned char* mapping = nullptr;
+	RingAllocator blocks;
+
+	// GL thread only
+	std::deque<Fence> fences;
+	uint64_t nextFence = 1;
+};
@@ -0,0 +1,854 @@
+#include "PngDecoder.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PNG_DECODER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// Codes up to this length are decoded with one table lookup, the longer ones (rare) are searched by length
+const uint32_t INFLATE_FAST_BITS = 10;
+const uint32_t INFLATE_FAST_MASK = (1 << INFLATE_FAST_BITS) - 1;
+const uint32_t INFLATE_MAX_SYMBOLS = 288;
+
+// Base value and extra bits of the length symbols 257 to 285 and of the distance symbols
+const uint16_t INFLATE_LENGTH_BASES[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59,
+	67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const uint8_t INFLATE_LENGTH_EXTRA_BITS[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const uint16_t INFLATE_DISTANCE_BASES[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+	1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const uint8_t INFLATE_DISTANCE_EXTRA_BITS[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10,
+	11, 11, 12, 12, 13, 13 };
+// Order of the code length code lengths of a dynamic block
+const uint8_t INFLATE_CODE_LENGTH_ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+const unsigned char PNG_SIGNATURE[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+// same limit as stb_image
+const uint32_t PNG_MAX_DIMENSION = 1 << 24;
+
+enum PngColorType : uint32_t
+{
+	PNG_COLOR_GREY = 0,
+	PNG_COLOR_RGB = 2,
+	PNG_COLOR_PALETTE = 3,
+	PNG_COLOR_GREY_ALPHA = 4,
+	PNG_COLOR_RGBA = 6,
+};
+
+enum PngFilter : uint8_t
+{
+	PNG_FILTER_NONE = 0,
+	PNG_FILTER_SUB,
+	PNG_FILTER_UP,
+	PNG_FILTER_AVERAGE,
+	PNG_FILTER_PAETH,
+};
+
+// Canonical Huffman code of a deflate block
+struct InflateHuffmanCode
+{
+	// (length << 9) | symbol of the codes of at most INFLATE_FAST_BITS bits, indexed by the next bits of the stream.
+	// 0 for the longer codes.
+	uint16_t fast[1 << INFLATE_FAST_BITS];
+	// first code of each length, and index of its symbol in symbols
+	uint16_t firstCode[16];
+	uint16_t firstSymbol[16];
+	// code past the last one of each length, left aligned on 16 bits
+	uint32_t maxCode[17];
+	// in code order
+	uint8_t lengths[INFLATE_MAX_SYMBOLS];
+	uint16_t symbols[INFLATE_MAX_SYMBOLS];
+};
+
+uint32_t ReverseInflateBits(uint32_t code, uint32_t length)
+{
+	code = ((code & 0xAAAA) >> 1) | ((code & 0x5555) << 1);
+	code = ((code & 0xCCCC) >> 2) | ((code & 0x3333) << 2);
+	code = ((code & 0xF0F0) >> 4) | ((code & 0x0F0F) << 4);
+	code = ((code & 0xFF00) >> 8) | ((code & 0x00FF) << 8);
+	return code >> (16 - length);
+}
+
+bool BuildInflateHuffmanCode(const uint8_t* lengths, uint32_t symbolCount, InflateHuffmanCode& code)
+{
+	uint32_t counts[16] = {};
+	for (uint32_t symbol = 0; symbol < symbolCount; ++symbol)
+	{
+		counts[lengths[symbol]]++;
+	}
+	counts[0] = 0;
+
+	uint32_t nextCode[16] = {};
+	uint32_t firstCode = 0;
+	uint32_t firstSymbol = 0;
+	for (uint32_t length = 1; length < 16; ++length)
+	{
+		if (counts[length] > (1u << length))
+		{
+			return false;
+		}
+		nextCode[length] = firstCode;
+		code.firstCode[length] = static_cast<uint16_t>(firstCode);
+		code.firstSymbol[length] = static_cast<uint16_t>(firstSymbol);
+		firstCode += counts[length];
+		if (counts[length] > 0 && firstCode - 1 >= (1u << length))
+		{
+			return false;
+		}
+		code.maxCode[length] = firstCode << (16 - length);
+		firstCode <<= 1;
+		firstSymbol += counts[length];
+	}
+	code.maxCode[16] = 0x10000;
+
+	std::memset(code.fast, 0, sizeof(code.fast));
+	for (uint32_t symbol = 0; symbol < symbolCount; ++symbol)
+	{
+		const uint32_t length = lengths[symbol];
+		if (length == 0)
+		{
+			continue;
+		}
+
+		const uint32_t index = code.firstSymbol[length] + nextCode[length] - code.firstCode[length];
+		code.lengths[index] = static_cast<uint8_t>(length);
+		code.symbols[index] = static_cast<uint16_t>(symbol);
+		if (length <= INFLATE_FAST_BITS)
+		{
+			// the stream holds the codes most significant bit first
+			for (uint32_t bits = ReverseInflateBits(nextCode[length], length); bits < (1u << INFLATE_FAST_BITS); bits += 1u << length)
+			{
+				code.fast[bits] = static_cast<uint16_t>((length << 9) | symbol);
+			}
+		}
+		nextCode[length]++;
+	}
+	return true;
+}
+
+// Little endian bit buffer refilled 8 bytes at a time
+struct InflateBitReader
+{
+	const unsigned char* next = nullptr;
+	const unsigned char* end = nullptr;
+	uint64_t bits = 0;
+	uint32_t count = 0;
+	// zero bytes appended past the end of the stream
+	uint32_t paddingBytes = 0;
+
+	// At least 56 bits in the buffer, count stays under 64. The whole word load leaves bits above count that the next refill
+	// ORs again at the same place, so it doesn't need to be exact. Assumes a little endian CPU, as every target of the project is.
+	void Refill()
+	{
+		if (end - next >= 8)
+		{
+			uint64_t word;
+			std::memcpy(&word, next, sizeof(word));
+			bits |= word << count;
+			next += (63 - count) >> 3;
+			count |= 56;
+			return;
+		}
+
+		while (count < 56)
+		{
+			if (next < end)
+			{
+				bits |= uint64_t(*next++) << count;
+			}
+			else
+			{
+				paddingBytes++;
+			}
+			count += 8;
+		}
+	}
+
+	uint32_t Read(uint32_t bitCount)
+	{
+		const uint32_t value = static_cast<uint32_t>(bits & ((uint64_t(1) << bitCount) - 1));
+		bits >>= bitCount;
+		count -= bitCount;
+		return value;
+	}
+
+	// Symbol of the next code, -1 when the stream holds no valid code
+	int Decode(const InflateHuffmanCode& code)
+	{
+		const uint32_t entry = code.fast[bits & INFLATE_FAST_MASK];
+		if (entry != 0)
+		{
+			Read(entry >> 9);
+			return static_cast<int>(entry & 511);
+		}
+
+		const uint32_t leftAligned = ReverseInflateBits(static_cast<uint32_t>(bits & 0xFFFF), 16);
+		uint32_t length = INFLATE_FAST_BITS + 1;
+		while (length < 16 && leftAligned >= code.maxCode[length])
+		{
+			length++;
+		}
+		if (length == 16)
+		{
+			return -1;
+		}
+		const uint32_t index = (leftAligned >> (16 - length)) - code.firstCode[length] + code.firstSymbol[length];
+		if (index >= INFLATE_MAX_SYMBOLS || code.lengths[index] != length)
+		{
+			return -1;
+		}
+		Read(length);
+		return code.symbols[index];
+	}
+
+	// Byte the next bit belongs to, once the bits of the current byte are dropped
+	const unsigned char* AlignToByte()
+	{
+		Read(count & 7);
+		const unsigned char* position = next - (count >> 3) + paddingBytes;
+		bits = 0;
+		count = 0;
+		paddingBytes = 0;
+		return position;
+	}
+
+	bool IsPastEnd() const
+	{
+		return paddingBytes > (count >> 3);
+	}
+};
+
+bool GetFixedInflateCodes(const InflateHuffmanCode*& lengthCode, const InflateHuffmanCode*& distanceCode)
+{
+	struct FixedCodes
+	{
+		InflateHuffmanCode lengthCode;
+		InflateHuffmanCode distanceCode;
+		bool isValid = false;
+
+		FixedCodes()
+		{
+			uint8_t lengths[INFLATE_MAX_SYMBOLS];
+			std::memset(lengths, 8, 144);
+			std::memset(lengths + 144, 9, 256 - 144);
+			std::memset(lengths + 256, 7, 280 - 256);
+			std::memset(lengths + 280, 8, INFLATE_MAX_SYMBOLS - 280);
+			uint8_t distanceLengths[30];
+			std::memset(distanceLengths, 5, sizeof(distanceLengths));
+			isValid = BuildInflateHuffmanCode(lengths, INFLATE_MAX_SYMBOLS, lengthCode) &&
+				BuildInflateHuffmanCode(distanceLengths, 30, distanceCode);
+		}
+	};
+	static const FixedCodes fixedCodes;
+
+	lengthCode = &fixedCodes.lengthCode;
+	distanceCode = &fixedCodes.distanceCode;
+	return fixedCodes.isValid;
+}
+
+bool ReadDynamicInflateCodes(InflateBitReader& reader, InflateHuffmanCode& lengthCode, InflateHuffmanCode& distanceCode)
+{
+	reader.Refill();
+	const uint32_t lengthCount = reader.Read(5) + 257;
+	const uint32_t distanceCount = reader.Read(5) + 1;
+	const uint32_t codeLengthCount = reader.Read(4) + 4;
+
+	uint8_t codeLengthLengths[19] = {};
+	for (uint32_t n = 0; n < codeLengthCount; ++n)
+	{
+		reader.Refill();
+		codeLengthLengths[INFLATE_CODE_LENGTH_ORDER[n]] = static_cast<uint8_t>(reader.Read(3));
+	}
+	InflateHuffmanCode codeLengthCode;
+	if (!BuildInflateHuffmanCode(codeLengthLengths, 19, codeLengthCode))
+	{
+		return false;
+	}
+
+	// the lengths of both codes form one sequence, the repeats may cross from one to the other
+	uint8_t lengths[INFLATE_MAX_SYMBOLS + 32];
+	const uint32_t totalCount = lengthCount + distanceCount;
+	uint32_t n = 0;
+	while (n < totalCount)
+	{
+		reader.Refill();
+		const int symbol = reader.Decode(codeLengthCode);
+		if (symbol < 0)
+		{
+			return false;
+		}
+		if (symbol < 16)
+		{
+			lengths[n++] = static_cast<uint8_t>(symbol);
+			continue;
+		}
+
+		uint8_t repeated = 0;
+		uint32_t repeatCount;
+		if (symbol == 16)
+		{
+			if (n == 0)
+			{
+				return false;
+			}
+			repeated = lengths[n - 1];
+			repeatCount = reader.Read(2) + 3;
+		}
+		else if (symbol == 17)
+		{
+			repeatCount = reader.Read(3) + 3;
+		}
+		else
+		{
+			repeatCount = reader.Read(7) + 11;
+		}
+		if (n + repeatCount > totalCount)
+		{
+			return false;
+		}
+		std::memset(lengths + n, repeated, repeatCount);
+		n += repeatCount;
+	}
+
+	return lengths[256] != 0 && BuildInflateHuffmanCode(lengths, lengthCount, lengthCode) &&
+		BuildInflateHuffmanCode(lengths + lengthCount, distanceCount, distanceCode);
+}
+
+// Copies length bytes from distance bytes back, the ranges overlap when distance < length
+inline void CopyInflateMatch(unsigned char*& output, const unsigned char* outputEnd, uint32_t distance, uint32_t length)
+{
+	const unsigned char* source = output - distance;
+	unsigned char* const target = output + length;
+	if (distance >= 8 && size_t(outputEnd - output) >= size_t(length) + 8)
+	{
+		// whole words, the few bytes written past target are overwritten by what comes next
+		do
+		{
+			std::memcpy(output, source, 8);
+			output += 8;
+			source += 8;
+		} while (output < target);
+	}
+	else if (distance == 1)
+	{
+		std::memset(output, output[-1], length);
+	}
+	else
+	{
+		while (output < target)
+		{
+			*output++ = *source++;
+		}
+	}
+	output = target;
+}
+
+bool InflateHuffmanBlock(InflateBitReader& reader, const InflateHuffmanCode& lengthCode, const InflateHuffmanCode& distanceCode,
+	const unsigned char* outputStart, unsigned char*& output, const unsigned char* outputEnd)
+{
+	while (true)
+	{
+		// a length code and its extra bits, then a distance code and its extra bits take at most 48 bits
+		reader.Refill();
+		int symbol = reader.Decode(lengthCode);
+		if (symbol < 256)
+		{
+			if (symbol < 0 || output == outputEnd)
+			{
+				return false;
+			}
+			*output++ = static_cast<unsigned char>(symbol);
+			continue;
+		}
+		if (symbol == 256)
+		{
+			return !reader.IsPastEnd();
+		}
+
+		symbol -= 257;
+		if (symbol >= 29)
+		{
+			return false;
+		}
+		const uint32_t length = INFLATE_LENGTH_BASES[symbol] + reader.Read(INFLATE_LENGTH_EXTRA_BITS[symbol]);
+
+		symbol = reader.Decode(distanceCode);
+		if (symbol < 0 || symbol >= 30)
+		{
+			return false;
+		}
+		const uint32_t distance = INFLATE_DISTANCE_BASES[symbol] + reader.Read(INFLATE_DISTANCE_EXTRA_BITS[symbol]);
+		if (distance > size_t(output - outputStart) || length > size_t(outputEnd - output))
+		{
+			return false;
+		}
+		CopyInflateMatch(output, outputEnd, distance, length);
+	}
+}
+
+bool PngDecoder::Inflate(const unsigned char* data, size_t size, unsigned char* output, size_t outputSize)
+{
+	// zlib header: deflate compression, no preset dictionary
+	if (size < 2 || (data[0] & 15) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 32) != 0)
+	{
+		return false;
+	}
+
+	InflateBitReader reader;
+	reader.next = data + 2;
+	reader.end = data + size;
+	unsigned char* const outputStart = output;
+	const unsigned char* const outputEnd = output + outputSize;
+	// allocated once, a dynamic block rebuilds them
+	std::unique_ptr<InflateHuffmanCode[]> dynamicCodes(new InflateHuffmanCode[2]);
+
+	bool isFinalBlock = false;
+	while (!isFinalBlock)
+	{
+		reader.Refill();
+		isFinalBlock = reader.Read(1) != 0;
+		const uint32_t blockType = reader.Read(2);
+		if (blockType == 0)
+		{
+			const unsigned char* position = reader.AlignToByte();
+			if (reader.end - position < 4)
+			{
+				return false;
+			}
+			const uint32_t length = position[0] | (position[1] << 8);
+			const uint32_t lengthComplement = position[2] | (position[3] << 8);
+			position += 4;
+			if ((length ^ 0xFFFF) != lengthComplement || length > size_t(reader.end - position) || length > size_t(outputEnd - output))
+			{
+				return false;
+			}
+			std::memcpy(output, position, length);
+			output += length;
+			reader.next = position + length;
+		}
+		else if (blockType == 1)
+		{
+			const InflateHuffmanCode* lengthCode;
+			const InflateHuffmanCode* distanceCode;
+			if (!GetFixedInflateCodes(lengthCode, distanceCode) ||
+				!InflateHuffmanBlock(reader, *lengthCode, *distanceCode, outputStart, output, outputEnd))
+			{
+				return false;
+			}
+		}
+		else if (blockType == 2)
+		{
+			if (!ReadDynamicInflateCodes(reader, dynamicCodes[0], dynamicCodes[1]) ||
+				!InflateHuffmanBlock(reader, dynamicCodes[0], dynamicCodes[1], outputStart, output, outputEnd))
+			{
+				return false;
+			}
+		}
+		else
+		{
+			return false;
+		}
+	}
+	// the Adler-32 checksum isn't verified, stb_image doesn't either
+	return output == outputEnd;
+}
+
+// Neighbour closest to left + up - upLeft, ties going to left then up
+uint8_t PredictPaeth(int left, int up, int upLeft)
+{
+	const int leftDistance = std::abs(up - upLeft);
+	const int upDistance = std::abs(left - upLeft);
+	const int upLeftDistance = std::abs(left + up - 2 * upLeft);
+	if (leftDistance <= upDistance && leftDistance <= upLeftDistance)
+	{
+		return static_cast<uint8_t>(left);
+	}
+	return static_cast<uint8_t>(upDistance <= upLeftDistance ? up : upLeft);
+}
+
+// Reference versions, for the pixel sizes without an SSE2 one. previous is the unfiltered row above (zeros for the first row).
+void UnfilterPngRowScalar(uint8_t filter, unsigned char* row, const unsigned char* previous, size_t rowSize, size_t pixelSize)
+{
+	switch (filter)
+	{
+	case PNG_FILTER_SUB:
+		for (size_t n = pixelSize; n < rowSize; ++n)
+		{
+			row[n] = static_cast<unsigned char>(row[n] + row[n - pixelSize]);
+		}
+		break;
+	case PNG_FILTER_UP:
+		for (size_t n = 0; n < rowSize; ++n)
+		{
+			row[n] = static_cast<unsigned char>(row[n] + previous[n]);
+		}
+		break;
+	case PNG_FILTER_AVERAGE:
+		for (size_t n = 0; n < pixelSize; ++n)
+		{
+			row[n] = static_cast<unsigned char>(row[n] + (previous[n] >> 1));
+		}
+		for (size_t n = pixelSize; n < rowSize; ++n)
+		{
+			row[n] = static_cast<unsigned char>(row[n] + ((row[n - pixelSize] + previous[n]) >> 1));
+		}
+		break;
+	case PNG_FILTER_PAETH:
+		for (size_t n = 0; n < pixelSize; ++n)
+		{
+			row[n] = static_cast<unsigned char>(row[n] + previous[n]);
+		}
+		for (size_t n = pixelSize; n < rowSize; ++n)
+		{
+			row[n] = static_cast<unsigned char>(row[n] + PredictPaeth(row[n - pixelSize], previous[n], previous[n - pixelSize]));
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+#ifdef PNG_DECODER_SSE2
+template <size_t PIXEL_SIZE>
+inline __m128i LoadPngPixel(const unsigned char* pixel)
+{
+	uint64_t bytes = 0;
+	std::memcpy(&bytes, pixel, PIXEL_SIZE);
+	return _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&bytes));
+}
+
+template <size_t PIXEL_SIZE>
+inline void StorePngPixel(unsigned char* pixel, __m128i value)
+{
+	uint64_t bytes;
+	_mm_storel_epi64(reinterpret_cast<__m128i*>(&bytes), value);
+	std::memcpy(pixel, &bytes, PIXEL_SIZE);
+}
+
+// Sub, Average and Paeth depend on the pixel on the left, so one pixel (up to 8 bytes) is unfiltered per step with all its
+// channels in one register. Paeth works on 16 bit lanes, its distances don't fit 8 bits.
+template <size_t PIXEL_SIZE>
+void UnfilterPngRowSse2(uint8_t filter, unsigned char* row, const unsigned char* previous, size_t rowSize)
+{
+	const __m128i zero = _mm_setzero_si128();
+	switch (filter)
+	{
+	case PNG_FILTER_SUB:
+	{
+		__m128i left = zero;
+		for (size_t n = 0; n < rowSize; n += PIXEL_SIZE)
+		{
+			left = _mm_add_epi8(left, LoadPngPixel<PIXEL_SIZE>(row + n));
+			StorePngPixel<PIXEL_SIZE>(row + n, left);
+		}
+		break;
+	}
+	case PNG_FILTER_AVERAGE:
+	{
+		// _mm_avg_epu8 rounds up, PNG rounds down
+		const __m128i one = _mm_set1_epi8(1);
+		__m128i left = zero;
+		for (size_t n = 0; n < rowSize; n += PIXEL_SIZE)
+		{
+			const __m128i up = LoadPngPixel<PIXEL_SIZE>(previous + n);
+			const __m128i average = _mm_sub_epi8(_mm_avg_epu8(left, up), _mm_and_si128(_mm_xor_si128(left, up), one));
+			left = _mm_add_epi8(LoadPngPixel<PIXEL_SIZE>(row + n), average);
+			StorePngPixel<PIXEL_SIZE>(row + n, left);
+		}
+		break;
+	}
+	case PNG_FILTER_PAETH:
+	{
+		__m128i left = zero;
+		__m128i upLeft = zero;
+		for (size_t n = 0; n < rowSize; n += PIXEL_SIZE)
+		{
+			// distances of left + up - upLeft to each of the three neighbours
+			const __m128i up = _mm_unpacklo_epi8(LoadPngPixel<PIXEL_SIZE>(previous + n), zero);
+			const __m128i toLeft = _mm_sub_epi16(up, upLeft);
+			const __m128i toUp = _mm_sub_epi16(left, upLeft);
+			__m128i upLeftDistance = _mm_add_epi16(toLeft, toUp);
+			const __m128i leftDistance = _mm_max_epi16(toLeft, _mm_sub_epi16(zero, toLeft));
+			const __m128i upDistance = _mm_max_epi16(toUp, _mm_sub_epi16(zero, toUp));
+			upLeftDistance = _mm_max_epi16(upLeftDistance, _mm_sub_epi16(zero, upLeftDistance));
+
+			// left when its distance is the smallest, then up, then up left
+			const __m128i smallest = _mm_min_epi16(upLeftDistance, _mm_min_epi16(leftDistance, upDistance));
+			const __m128i isLeft = _mm_cmpeq_epi16(smallest, leftDistance);
+			const __m128i isUp = _mm_cmpeq_epi16(smallest, upDistance);
+			const __m128i upOrUpLeft = _mm_or_si128(_mm_and_si128(isUp, up), _mm_andnot_si128(isUp, upLeft));
+			const __m128i prediction = _mm_or_si128(_mm_and_si128(isLeft, left), _mm_andnot_si128(isLeft, upOrUpLeft));
+
+			// the high bytes are 0 on both sides, the low ones wrap around like the scalar sum
+			left = _mm_add_epi8(_mm_unpacklo_epi8(LoadPngPixel<PIXEL_SIZE>(row + n), zero), prediction);
+			upLeft = up;
+			StorePngPixel<PIXEL_SIZE>(row + n, _mm_packus_epi16(left, left));
+		}
+		break;
+	}
+	default:
+		break;
+	}
+}
+#endif
+
+bool UnfilterPngRow(uint8_t filter, unsigned char* row, const unsigned char* previous, size_t rowSize, size_t pixelSize)
+{
+	if (filter > PNG_FILTER_PAETH)
+	{
+		return false;
+	}
+	if (filter == PNG_FILTER_NONE)
+	{
+		return true;
+	}
+
+#ifdef PNG_DECODER_SSE2
+	if (filter == PNG_FILTER_UP)
+	{
+		size_t n = 0;
+		for (; n + 16 <= rowSize; n += 16)
+		{
+			const __m128i sum = _mm_add_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + n)),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + n)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(row + n), sum);
+		}
+		UnfilterPngRowScalar(filter, row + n, previous + n, rowSize - n, pixelSize);
+		return true;
+	}
+
+	switch (pixelSize)
+	{
+	case 3: UnfilterPngRowSse2<3>(filter, row, previous, rowSize); return true;
+	case 4: UnfilterPngRowSse2<4>(filter, row, previous, rowSize); return true;
+	case 6: UnfilterPngRowSse2<6>(filter, row, previous, rowSize); return true;
+	case 8: UnfilterPngRowSse2<8>(filter, row, previous, rowSize); return true;
+	default: break;
+	}
+#endif
+
+	UnfilterPngRowScalar(filter, row, previous, rowSize, pixelSize);
+	return true;
+}
+
+// Luminance weights of stb_image, applied to the samples before the reduction to 8 bits
+inline uint32_t ComputePngLuminance(uint32_t r, uint32_t g, uint32_t b)
+{
+	return (r * 77 + g * 150 + b * 29) >> 8;
+}
+
+// One unfiltered row of width pixels of channelsInFile samples of sampleSize bytes into 8 bit pixels of channels channels
+void ConvertPngRow(const unsigned char* source, unsigned char* destination, uint32_t width, uint32_t channelsInFile, uint32_t sampleSize,
+	uint32_t channels)
+{
+	if (channels == channelsInFile && sampleSize == 1)
+	{
+		std::memcpy(destination, source, size_t(width) * channels);
+		return;
+	}
+
+	if (channels == channelsInFile)
+	{
+		// 16 bit samples are big endian, their high byte comes first
+		const size_t sampleCount = size_t(width) * channels;
+		size_t n = 0;
+#ifdef PNG_DECODER_SSE2
+		const __m128i lowBytes = _mm_set1_epi16(0xFF);
+		for (; n + 16 <= sampleCount; n += 16)
+		{
+			const __m128i first = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 2 * n)), lowBytes);
+			const __m128i second = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 2 * n + 16)), lowBytes);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + n), _mm_packus_epi16(first, second));
+		}
+#endif
+		for (; n < sampleCount; ++n)
+		{
+			destination[n] = source[2 * n];
+		}
+		return;
+	}
+
+	// channel conversions happen at the precision of the file, like in stb_image
+	const uint32_t maxValue = sampleSize == 1 ? 0xFF : 0xFFFF;
+	const uint32_t shift = sampleSize == 1 ? 0 : 8;
+	uint32_t samples[4];
+	for (uint32_t x = 0; x < width; ++x)
+	{
+		for (uint32_t c = 0; c < channelsInFile; ++c)
+		{
+			const unsigned char* sample = source + (size_t(x) * channelsInFile + c) * sampleSize;
+			samples[c] = sampleSize == 1 ? sample[0] : uint32_t(sample[0] << 8) | sample[1];
+		}
+
+		const bool isGrey = channelsInFile <= 2;
+		const bool hasAlpha = channelsInFile == 2 || channelsInFile == 4;
+		const uint32_t alpha = hasAlpha ? samples[channelsInFile - 1] : maxValue;
+		const uint32_t luminance = isGrey ? samples[0] : ComputePngLuminance(samples[0], samples[1], samples[2]);
+
+		unsigned char* pixel = destination + size_t(x) * channels;
+		switch (channels)
+		{
+		case 1:
+			pixel[0] = static_cast<unsigned char>(luminance >> shift);
+			break;
+		case 2:
+			pixel[0] = static_cast<unsigned char>(luminance >> shift);
+			pixel[1] = static_cast<unsigned char>(alpha >> shift);
+			break;
+		default:
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				pixel[c] = static_cast<unsigned char>((isGrey ? samples[0] : samples[c]) >> shift);
+			}
+			if (channels == 4)
+			{
+				pixel[3] = static_cast<unsigned char>(alpha >> shift);
+			}
+			break;
+		}
+	}
+}
+
+inline uint32_t ReadPngUint32(const unsigned char* bytes)
+{
+	return (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) | bytes[3];
+}
+
+bool PngDecoder::Decode(const unsigned char* data, size_t size, int desiredChannels, bool flipVertically, PngImage& image)
+{
+	if (size < sizeof(PNG_SIGNATURE) || std::memcmp(data, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) != 0 ||
+		desiredChannels < 0 || desiredChannels > 4)
+	{
+		return false;
+	}
+
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t channelsInFile = 0;
+	uint32_t sampleSize = 0;
+	// the image data is usually split over many chunks, it is only copied when there are several
+	std::vector<std::pair<const unsigned char*, size_t>> dataChunks;
+	size_t position = sizeof(PNG_SIGNATURE);
+	bool isComplete = false;
+	while (!isComplete)
+	{
+		if (size - position < 12)
+		{
+			return false;
+		}
+		const uint32_t length = ReadPngUint32(data + position);
+		const unsigned char* type = data + position + 4;
+		const unsigned char* chunk = data + position + 8;
+		if (length > size - position - 12)
+		{
+			return false;
+		}
+		const bool isFirstChunk = position == sizeof(PNG_SIGNATURE);
+		position += size_t(length) + 12;
+
+		if (std::memcmp(type, "IHDR", 4) == 0)
+		{
+			if (!isFirstChunk || length != 13)
+			{
+				return false;
+			}
+			width = ReadPngUint32(chunk);
+			height = ReadPngUint32(chunk + 4);
+			const uint32_t bitDepth = chunk[8];
+			const uint32_t colorType = chunk[9];
+			// compression and filter method 0 are the only defined ones, interlaced images go to stb_image
+			if (width == 0 || height == 0 || width > PNG_MAX_DIMENSION || height > PNG_MAX_DIMENSION ||
+				(bitDepth != 8 && bitDepth != 16) || chunk[10] != 0 || chunk[11] != 0 || chunk[12] != 0)
+			{
+				return false;
+			}
+			switch (colorType)
+			{
+			case PNG_COLOR_GREY: channelsInFile = 1; break;
+			case PNG_COLOR_GREY_ALPHA: channelsInFile = 2; break;
+			case PNG_COLOR_RGB: channelsInFile = 3; break;
+			case PNG_COLOR_RGBA: channelsInFile = 4; break;
+			default: return false;
+			}
+			sampleSize = bitDepth / 8;
+		}
+		else if (isFirstChunk)
+		{
+			// Apple's CgBI files start with their own chunk
+			return false;
+		}
+		else if (std::memcmp(type, "IDAT", 4) == 0)
+		{
+			dataChunks.emplace_back(chunk, length);
+		}
+		else if (std::memcmp(type, "IEND", 4) == 0)
+		{
+			isComplete = true;
+		}
+		else if (std::memcmp(type, "tRNS", 4) == 0 || (std::memcmp(type, "PLTE", 4) != 0 && (type[0] & 32) == 0))
+		{
+			// a transparent color adds an alpha channel, and critical chunks we don't know change the decoding
+			return false;
+		}
+	}
+	if (dataChunks.empty())
+	{
+		return false;
+	}
+
+	std::vector<unsigned char> joinedData;
+	const unsigned char* compressedData = dataChunks[0].first;
+	size_t compressedSize = dataChunks[0].second;
+	if (dataChunks.size() > 1)
+	{
+		compressedSize = 0;
+		for (const std::pair<const unsigned char*, size_t>& chunk : dataChunks)
+		{
+			compressedSize += chunk.second;
+		}
+		joinedData.resize(compressedSize);
+		size_t offset = 0;
+		for (const std::pair<const unsigned char*, size_t>& chunk : dataChunks)
+		{
+			std::memcpy(joinedData.data() + offset, chunk.first, chunk.second);
+			offset += chunk.second;
+		}
+		compressedData = joinedData.data();
+	}
+
+	// every row starts with its filter type
+	const size_t pixelSize = size_t(channelsInFile) * sampleSize;
+	const size_t rowSize = size_t(width) * pixelSize;
+	const size_t filteredSize = (rowSize + 1) * height;
+	std::unique_ptr<unsigned char[]> filtered(new unsigned char[filteredSize]);
+	if (!Inflate(compressedData, compressedSize, filtered.get(), filteredSize))
+	{
+		return false;
+	}
+
+	const uint32_t channels = desiredChannels != 0 ? static_cast<uint32_t>(desiredChannels) : channelsInFile;
+	std::unique_ptr<unsigned char[]> pixels(new unsigned char[size_t(width) * height * channels]);
+	const std::vector<unsigned char> zeroRow(rowSize, 0);
+	const unsigned char* previous = zeroRow.data();
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		unsigned char* row = filtered.get() + (rowSize + 1) * y;
+		if (!UnfilterPngRow(row[0], row + 1, previous, rowSize, pixelSize))
+		{
+			return false;
+		}
+		const uint32_t destinationRow = flipVertically ? height - 1 - y : y;
+		ConvertPngRow(row + 1, pixels.get() + size_t(destinationRow) * width * channels, width, channelsInFile, sampleSize, channels);
+		previous = row + 1;
+	}
+
+	image.width = static_cast<int>(width);
+	image.height = static_cast<int>(height);
+	image.channels = static_cast<int>(channels);
+	image.channelsInFile = static_cast<int>(channelsInFile);
+	image.pixels = std::move(pixels);
+	return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Decoded 8 bit image, rows tightly packed
+struct PngImage
+{
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	int channelsInFile = 0;
+	std::unique_ptr<unsigned char[]> pixels;
+};
+
+// PNG decoder for the common truecolor and greyscale files, faster than stb_image on them: the zlib stream is inflated
+// with table driven Huffman decoding straight into a buffer of the final size, and the rows are unfiltered with SSE2
+// when the compiler targets it. Its output matches stbi_load for the files it accepts.
+class PngDecoder
+{
+public:
+	// Decodes the PNG file in data into desiredChannels channels (0 keeps the ones of the file), 16 bit samples are reduced
+	// to 8 bits like stb_image does. Returns false for the files it doesn't handle (palette, interlacing, tRNS
+	// transparency, bit depths under 8) and for corrupt ones, stb_image decodes them instead.
+	static bool Decode(const unsigned char* data, size_t size, int desiredChannels, bool flipVertically, PngImage& image);
+
+	// zlib stream of size bytes inflated into exactly outputSize bytes at output, false when it is corrupt or of another size
+	static bool Inflate(const unsigned char* data, size_t size, unsigned char* output, size_t outputSize);
+};
@@ -0,0 +1,126 @@
+#include "ReloadableShaderProgram.h"
+
+#include <filesystem>
+#include <iostream>
+
+#include <glad/glad.h>
+
+ReloadableShaderProgram::ReloadableShaderProgram(const std::string& vertexPath, const std::string& fragmentPath,
+	const std::vector<std::string>& vertexDefines, const std::vector<std::string>& fragmentDefines, ShaderProgramCache* cache)
+	: vertexPath(vertexPath), fragmentPath(fragmentPath), vertexDefines(vertexDefines), fragmentDefines(fragmentDefines), cache(cache)
+{
+}
+
+ReloadableShaderProgram::~ReloadableShaderProgram()
+{
+	ShaderLoader::CancelProgramBuild(build);
+	if (program != -1)
+	{
+		glDeleteProgram(program);
+	}
+}
+
+bool ReloadableShaderProgram::Load()
+{
+	ShaderLoader::CancelProgramBuild(build);
+	std::string vertexSource;
+	std::string fragmentSource;
+	PreprocessSources(vertexSource, fragmentSource);
+	const int newProgram = ShaderLoader::CreateCompileAndLinkShaderProgram(vertexSource.c_str(), fragmentSource.c_str(), cache);
+	if (newProgram == -1)
+	{
+		return false;
+	}
+
+	if (program != -1)
+	{
+		glDeleteProgram(program);
+	}
+	program = newProgram;
+	uniforms = std::make_unique<ShaderUniformTable>(program);
+	return true;
+}
+
+bool ReloadableShaderProgram::OnFileChanged(const std::string& path)
+{
+	const std::filesystem::path fileName = std::filesystem::path(path).filename();
+	for (const std::string& file : files)
+	{
+		if (std::filesystem::path(file).filename() == fileName)
+		{
+			Reload();
+			return true;
+		}
+	}
+	return false;
+}
+
+void ReloadableShaderProgram::Reload()
+{
+	// the file may have changed again since the build in flight read it
+	ShaderLoader::CancelProgramBuild(build);
+	reloadStart = std::chrono::steady_clock::now();
+
+	std::string vertexSource;
+	std::string fragmentSource;
+	PreprocessSources(vertexSource, fragmentSource);
+	build = ShaderLoader::StartProgramBuild(vertexSource, fragmentSource, cache);
+}
+
+bool ReloadableShaderProgram::Update()
+{
+	if (build.status == SHADER_BUILD_FAILED)
+	{
+		return false;
+	}
+
+	const ShaderBuildStatus status = ShaderLoader::UpdateProgramBuild(build, cache);
+	if (status == SHADER_BUILD_COMPILING || status == SHADER_BUILD_LINKING)
+	{
+		return false;
+	}
+
+	if (status == SHADER_BUILD_FAILED)
+	{
+		std::cout << "SHADER::RELOAD_FAILED " << vertexPath << " " << fragmentPath << ", keeping the previous program" << std::endl;
+		failedCount++;
+		return false;
+	}
+
+	const bool isFirstBuild = program == -1;
+	if (!isFirstBuild)
+	{
+		glDeleteProgram(program);
+	}
+	program = build.program;
+	uniforms = std::make_unique<ShaderUniformTable>(program);
+	build = ShaderProgramBuild();
+
+	lastReloadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - reloadStart).count();
+	reloadCount++;
+	std::cout << (isFirstBuild ? "SHADER::BUILT " : "SHADER::RELOADED ") << vertexPath << " " << fragmentPath << " in "
+		<< lastReloadSeconds * 1000.0 << " ms" << std::endl;
+	return true;
+}
+
+void ReloadableShaderProgram::PreprocessSources(std::string& vertexSource, std::string& fragmentSource)
+{
+	// a file that fails to read is still watched, saving it again retries
+	std::vector<std::string> vertexFiles;
+	std::vector<std::string> fragmentFiles;
+	vertexSource = ShaderLoader::PreprocessShader(vertexPath, vertexDefines, &vertexFiles);
+	fragmentSource = ShaderLoader::PreprocessShader(fragmentPath, fragmentDefines, &fragmentFiles);
+
+	files = { vertexPath, fragmentPath };
+	files.insert(files.end(), vertexFiles.begin(), vertexFiles.end());
+	files.insert(files.end(), fragmentFiles.begin(), fragmentFiles.end());
+}
+
+ReloadableShaderProgramStatistics ReloadableShaderProgram::GetStatistics() const
+{
+	ReloadableShaderProgramStatistics statistics;
+	statistics.reloadCount = reloadCount;
+	statistics.failedCount = failedCount;
+	statistics.lastReloadSeconds = lastReloadSeconds;
+	return statistics;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ShaderLoader.h"
+#include "ShaderProgramCache.h"
+#include "ShaderUniformTable.h"
+
+struct ReloadableShaderProgramStatistics
+{
+	// rebuilds that replaced the program, and those that kept the last good one because of an error
+	size_t reloadCount = 0;
+	size_t failedCount = 0;
+	// from the file change to the new program in place
+	double lastReloadSeconds = 0.0;
+};
+
+// Shader program built from a vertex and a fragment shader file, rebuilt when they or a file they include change.
+// A rebuild compiles in the background (see ShaderLoader::StartProgramBuild) and the new program replaces the current one
+// only once it links, so the frames keep drawing with the last good program meanwhile, and after a broken edit.
+// GL thread only.
+class ReloadableShaderProgram
+{
+public:
+	// The sources go through ShaderLoader::PreprocessShader with the defines of their stage. cache, if any, must outlive the program.
+	ReloadableShaderProgram(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& vertexDefines,
+		const std::vector<std::string>& fragmentDefines, ShaderProgramCache* cache = nullptr);
+	~ReloadableShaderProgram();
+
+	ReloadableShaderProgram(const ReloadableShaderProgram&) = delete;
+	ReloadableShaderProgram& operator=(const ReloadableShaderProgram&) = delete;
+
+	// Builds the program right away, false when it fails
+	bool Load();
+
+	// Starts a rebuild when path is one of the files of the program (compared by file name), a rebuild in flight is restarted.
+	// Returns whether it did.
+	bool OnFileChanged(const std::string& path);
+	// Starts a rebuild, also builds a program never loaded in the background (GetProgram is -1 until Update swaps it in)
+	void Reload();
+
+	// Once per frame: advances the rebuild, true on the frame its program replaces the previous one (which is deleted).
+	// Everything looked up from the previous program must be looked up again then, the uniform table is rebuilt with it.
+	bool Update();
+
+	// -1 until loaded
+	int GetProgram() const { return program; }
+	// Uniforms of the program, nullptr until loaded. Replaced along with the program (their values are set again).
+	ShaderUniformTable* GetUniforms() const { return uniforms.get(); }
+	bool IsReloading() const { return build.status == SHADER_BUILD_COMPILING || build.status == SHADER_BUILD_LINKING; }
+
+	ReloadableShaderProgramStatistics GetStatistics() const;
+
+private:
+	// Preprocessed sources of both stages, files is updated with what they read
+	void PreprocessSources(std::string& vertexSource, std::string& fragmentSource);
+
+	std::string vertexPath;
+	std::string fragmentPath;
+	std::vector<std::string> vertexDefines;
+	std::vector<std::string> fragmentDefines;
+	ShaderProgramCache* cache;
+	// the stage files and the files they include, as of the last build
+	std::vector<std::string> files;
+
+	int program = -1;
+	std::unique_ptr<ShaderUniformTable> uniforms;
+	ShaderProgramBuild build;
+	std::chrono::steady_clock::time_point reloadStart;
+
+	size_t reloadCount = 0;
+	size_t failedCount = 0;
+	double lastReloadSeconds = 0.0;
+};
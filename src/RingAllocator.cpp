@@ -0,0 +1,104 @@
+#include "RingAllocator.h"
+
+RingAllocator::RingAllocator(size_t capacity, size_t alignment)
+	: capacity(capacity), alignment(alignment)
+{
+}
+
+bool RingAllocator::Reserve(size_t size, size_t& offset)
+{
+	const size_t alignedSize = (size + alignment - 1) / alignment * alignment;
+	if (size == 0 || alignedSize > capacity)
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	offset = 0;
+	if (!blocks.empty())
+	{
+		// head never catches up with the first block from behind, head == tail only means an empty ring
+		const size_t tail = blocks.front().offset;
+		if (head >= tail && head + alignedSize <= capacity)
+		{
+			offset = head;
+		}
+		else if (head >= tail && alignedSize < tail)
+		{
+			// wraps around, the end of the buffer is left unused until the blocks before it are released
+			offset = 0;
+		}
+		else if (head < tail && head + alignedSize < tail)
+		{
+			offset = head;
+		}
+		else
+		{
+			fullCount++;
+			return false;
+		}
+	}
+
+	Block block;
+	block.offset = offset;
+	block.size = alignedSize;
+	blocks.push_back(block);
+	head = offset + alignedSize;
+	reservedBytes += size;
+	return true;
+}
+
+void RingAllocator::Submit(size_t offset)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (Block& block : blocks)
+	{
+		if (block.offset == offset && !block.isSubmitted)
+		{
+			block.isSubmitted = true;
+			return;
+		}
+	}
+}
+
+bool RingAllocator::Fence(uint64_t serial)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	bool isFenced = false;
+	for (Block& block : blocks)
+	{
+		if (block.isSubmitted && block.fence == 0)
+		{
+			block.fence = serial;
+			isFenced = true;
+		}
+	}
+	return isFenced;
+}
+
+void RingAllocator::Release(uint64_t signaledSerial)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	while (!blocks.empty() && blocks.front().fence != 0 && blocks.front().fence <= signaledSerial)
+	{
+		blocks.pop_front();
+	}
+	if (blocks.empty())
+	{
+		head = 0;
+	}
+}
+
+RingAllocatorStatistics RingAllocator::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	RingAllocatorStatistics statistics;
+	statistics.capacity = capacity;
+	for (const Block& block : blocks)
+	{
+		statistics.usedBytes += block.size;
+	}
+	statistics.reservedBytes = reservedBytes;
+	statistics.fullCount = fullCount;
+	return statistics;
+}
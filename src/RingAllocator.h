@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+struct RingAllocatorStatistics
+{
+	size_t capacity = 0;
+	// reserved and not released yet, the GPU may still be reading them
+	size_t usedBytes = 0;
+	size_t reservedBytes = 0;
+	// reservations refused because the ring was full
+	size_t fullCount = 0;
+};
+
+// Blocks of a buffer handed out in ring order and released in the same order once the GPU is done with them.
+// Any thread reserves a block and fills it; once the commands reading it are issued the block is submitted, the submitted
+// blocks are tagged with the serial of the next fence, and released when that fence is signaled.
+// A block reserved and not submitted yet holds up the release of the blocks after it. No GL calls, thread safe.
+class RingAllocator
+{
+public:
+	RingAllocator(size_t capacity, size_t alignment);
+
+	RingAllocator(const RingAllocator&) = delete;
+	RingAllocator& operator=(const RingAllocator&) = delete;
+
+	size_t GetCapacity() const { return capacity; }
+
+	// Offset of a free block of size bytes. False when there is no room until older blocks are released, it never waits.
+	bool Reserve(size_t size, size_t& offset);
+	// The commands reading the block at offset were issued, or it won't be read at all
+	void Submit(size_t offset);
+	// Tags the submitted blocks not tagged yet with serial, the fence issued after their commands.
+	// False when there were none, no fence is needed then.
+	bool Fence(uint64_t serial);
+	// Releases, in ring order, the blocks tagged with a serial up to signaledSerial
+	void Release(uint64_t signaledSerial);
+
+	RingAllocatorStatistics GetStatistics() const;
+
+private:
+	struct Block
+	{
+		size_t offset = 0;
+		size_t size = 0;
+		bool isSubmitted = false;
+		// serial of the fence issued after the block was submitted, 0 until then
+		uint64_t fence = 0;
+	};
+
+	size_t capacity;
+	size_t alignment;
+
+	mutable std::mutex mutex;
+	// oldest first, the free space goes from the end of the last one to the start of the first one
+	std::deque<Block> blocks;
+	size_t head = 0;
+
+	size_t reservedBytes = 0;
+	size_t fullCount = 0;
+};
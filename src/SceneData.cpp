@@ -0,0 +1,13 @@
+#include "SceneData.h"
+
+void SceneData::UpdateWorldTransforms()
+{
+	nodeWorldTransforms.resize(nodeLocalTransforms.size());
+
+	// parents come first, so their world transform is always up to date when a child reads it
+	for (size_t node = 0; node < nodeLocalTransforms.size(); ++node)
+	{
+		const int32_t parent = nodeParents[node];
+		nodeWorldTransforms[node] = parent < 0 ? nodeLocalTransforms[node] : nodeWorldTransforms[parent] * nodeLocalTransforms[node];
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Flattened scene, as a structure of arrays.
+// Nodes are stored in topological order (every parent before its children), so the world transforms are
+// updated in one linear pass. Submeshes are ranges of one vertex buffer and one index buffer shared by the whole scene.
+struct SceneData
+{
+	// nodes
+	std::vector<int32_t> nodeParents;			// -1 for the root
+	std::vector<glm::mat4> nodeLocalTransforms;
+	std::vector<glm::mat4> nodeWorldTransforms;
+	std::vector<std::string> nodeNames;
+
+	// submeshes, one per mesh of the file (indices are already rebased to the shared vertex buffer)
+	std::vector<uint32_t> submeshFirstVertex;
+	std::vector<uint32_t> submeshVertexCount;
+	std::vector<uint32_t> submeshFirstIndex;
+	std::vector<uint32_t> submeshIndexCount;
+	std::vector<uint32_t> submeshMaterials;
+
+	// draws: a submesh referenced by a node, in node order
+	std::vector<uint32_t> drawNodes;
+	std::vector<uint32_t> drawSubmeshes;
+
+	// materials
+	std::vector<std::string> materialNames;
+	std::vector<glm::vec3> materialBaseColors;
+	std::vector<std::string> materialAlbedoTextures;	// path as stored in the file, empty when there is none
+	std::vector<std::string> materialNormalTextures;
+
+	size_t GetNodeCount() const { return nodeParents.size(); }
+	size_t GetSubmeshCount() const { return submeshIndexCount.size(); }
+	size_t GetDrawCount() const { return drawNodes.size(); }
+	size_t GetMaterialCount() const { return materialNames.size(); }
+
+	// world = parent world * local for every node, call it after changing local transforms
+	void UpdateWorldTransforms();
+};
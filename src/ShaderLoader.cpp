@@ -0,0 +1,320 @@
+#include "ShaderLoader.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <glad/glad.h>
+
+// KHR_parallel_shader_compile, not part of the profile glad was generated for (ARB_parallel_shader_compile uses the same value)
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// Whether the driver is done with shader (or program when isProgram), always true without parallel compilation
+// since the status queries wait for it then
+bool IsShaderObjectComplete(GLuint object, bool isProgram)
+{
+	if (!ShaderLoader::IsParallelCompileSupported())
+	{
+		return true;
+	}
+
+	GLint isComplete = GL_FALSE;
+	if (isProgram)
+	{
+		glGetProgramiv(object, GL_COMPLETION_STATUS_KHR, &isComplete);
+	}
+	else
+	{
+		glGetShaderiv(object, GL_COMPLETION_STATUS_KHR, &isComplete);
+	}
+	return isComplete == GL_TRUE;
+}
+
+// File name of an #include "file" line, empty for the other lines
+std::string GetShaderIncludeName(const std::string& line)
+{
+	const size_t directive = line.find_first_not_of(" \t");
+	if (directive == std::string::npos || line.compare(directive, 8, "#include") != 0)
+	{
+		return std::string();
+	}
+	const size_t nameStart = line.find('"', directive + 8);
+	const size_t nameEnd = nameStart != std::string::npos ? line.find('"', nameStart + 1) : std::string::npos;
+	if (nameEnd == std::string::npos)
+	{
+		return std::string();
+	}
+	return line.substr(nameStart + 1, nameEnd - nameStart - 1);
+}
+
+// Appends the file at shaderPath to output, its includes expanded recursively (see PreprocessShader).
+// defineLines go after the #version line of the root file.
+bool AppendShaderFile(const std::string& shaderPath, const std::string& defineLines, std::vector<std::string>& files, std::string& output)
+{
+	const std::string source = ShaderLoader::ReadShader(shaderPath);
+	if (source.empty())
+	{
+		return false;
+	}
+
+	const size_t fileIndex = files.size();
+	files.push_back(shaderPath);
+	const bool isRoot = fileIndex == 0;
+	if (isRoot && source.find("#version") == std::string::npos)
+	{
+		output += defineLines;
+	}
+	else if (!isRoot)
+	{
+		output += "#line 1 " + std::to_string(fileIndex) + "\n";
+	}
+
+	std::istringstream lines(source);
+	std::string line;
+	for (size_t lineNumber = 1; std::getline(lines, line); ++lineNumber)
+	{
+		const std::string includeName = GetShaderIncludeName(line);
+		if (includeName.empty())
+		{
+			output += line + "\n";
+			if (isRoot && line.find("#version") != std::string::npos)
+			{
+				output += defineLines + "#line " + std::to_string(lineNumber + 1) + " 0\n";
+			}
+			continue;
+		}
+
+		// normalized so that "../x.glsl" from a subdirectory matches the x.glsl already included
+		const std::string includePath = (std::filesystem::path(shaderPath).parent_path() / includeName).lexically_normal().generic_string();
+		if (std::find(files.begin(), files.end(), includePath) == files.end())
+		{
+			if (!AppendShaderFile(includePath, defineLines, files, output))
+			{
+				std::cout << "ERROR::SHADER::INCLUDE_FAILED " << includePath << " from " << shaderPath << std::endl;
+				return false;
+			}
+		}
+		output += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+	}
+	return true;
+}
+
+std::string ShaderLoader::ReadShader(const std::string& shaderPath)
+{
+	// 1. retrieve the vertex/fragment source code from filePath
+	std::string shaderString;
+	std::ifstream shaderFile;
+
+	// ensure ifstream objects can throw exceptions:
+	shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+	try
+	{
+		// open files
+		shaderFile.open(shaderPath);
+		std::stringstream shaderStream;
+		// read file's buffer contents into streams
+		shaderStream << shaderFile.rdbuf();
+		// close file handlers
+		shaderFile.close();
+		// convert stream into string
+		shaderString = shaderStream.str();
+	}
+	catch (std::ifstream::failure e)
+	{
+		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << shaderPath << std::endl;
+	}
+
+	return shaderString;
+}
+
+std::string ShaderLoader::AddShaderDefines(const std::string& shaderSource, const std::vector<std::string>& defines)
+{
+	std::string defineLines;
+	for (const std::string& define : defines)
+	{
+		defineLines += "#define " + define + "\n";
+	}
+
+	const size_t versionStart = shaderSource.find("#version");
+	if (versionStart == std::string::npos)
+	{
+		return defineLines + shaderSource;
+	}
+	const size_t versionEnd = shaderSource.find('\n', versionStart);
+	if (versionEnd == std::string::npos)
+	{
+		return shaderSource + "\n" + defineLines;
+	}
+	return shaderSource.substr(0, versionEnd + 1) + defineLines + shaderSource.substr(versionEnd + 1);
+}
+
+std::string ShaderLoader::PreprocessShader(const std::string& shaderPath, const std::vector<std::string>& defines,
+	std::vector<std::string>* files)
+{
+	std::string defineLines;
+	for (const std::string& define : defines)
+	{
+		defineLines += "#define " + define + "\n";
+	}
+
+	std::vector<std::string> readFiles;
+	std::string output;
+	const bool isRead = AppendShaderFile(shaderPath, defineLines, readFiles, output);
+	if (files)
+	{
+		*files = readFiles;
+	}
+	return isRead ? output : std::string();
+}
+
+int ShaderLoader::CreateCompileAndLinkShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource,
+	ShaderProgramCache* cache)
+{
+	// the same steps as a background build, waiting for each of them
+	ShaderProgramBuild build = StartProgramBuild(vertexShaderSource, fragmentShaderSource, cache);
+	while (build.status == SHADER_BUILD_COMPILING || build.status == SHADER_BUILD_LINKING)
+	{
+		UpdateProgramBuild(build, cache);
+	}
+	return build.status == SHADER_BUILD_DONE ? build.program : -1;
+}
+
+bool ShaderLoader::IsParallelCompileSupported()
+{
+	static int isParallelCompileSupported = -1;
+	if (isParallelCompileSupported < 0)
+	{
+		isParallelCompileSupported = 0;
+		GLint extensionCount = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+		for (GLint n = 0; n < extensionCount; ++n)
+		{
+			const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(n)));
+			if (extension != nullptr && (std::string(extension) == "GL_KHR_parallel_shader_compile" ||
+				std::string(extension) == "GL_ARB_parallel_shader_compile"))
+			{
+				isParallelCompileSupported = 1;
+				break;
+			}
+		}
+	}
+	return isParallelCompileSupported == 1;
+}
+
+ShaderProgramBuild ShaderLoader::StartProgramBuild(const std::string& vertexShaderSource, const std::string& fragmentShaderSource,
+	ShaderProgramCache* cache)
+{
+	ShaderProgramBuild build;
+	if (cache)
+	{
+		build.cacheKey = cache->ComputeKey(vertexShaderSource, fragmentShaderSource);
+		build.program = cache->Load(build.cacheKey);
+		if (build.program != -1)
+		{
+			build.status = SHADER_BUILD_DONE;
+			return build;
+		}
+	}
+
+	// https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glCreateShader.xhtml
+	const char* vertexSource = vertexShaderSource.c_str();
+	build.vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(build.vertexShader, 1, &vertexSource, NULL);
+	glCompileShader(build.vertexShader);
+
+	const char* fragmentSource = fragmentShaderSource.c_str();
+	build.fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(build.fragmentShader, 1, &fragmentSource, NULL);
+	glCompileShader(build.fragmentShader);
+
+	build.status = SHADER_BUILD_COMPILING;
+	return build;
+}
+
+ShaderBuildStatus ShaderLoader::UpdateProgramBuild(ShaderProgramBuild& build, ShaderProgramCache* cache)
+{
+	int success;
+	char infoLog[512];
+	if (build.status == SHADER_BUILD_COMPILING)
+	{
+		if (!IsShaderObjectComplete(build.vertexShader, false) || !IsShaderObjectComplete(build.fragmentShader, false))
+		{
+			return build.status;
+		}
+
+		// check for shader compile errors
+		glGetShaderiv(build.vertexShader, GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			glGetShaderInfoLog(build.vertexShader, 512, NULL, infoLog);
+			std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+			CancelProgramBuild(build);
+			return build.status;
+		}
+		glGetShaderiv(build.fragmentShader, GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			glGetShaderInfoLog(build.fragmentShader, 512, NULL, infoLog);
+			std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+			CancelProgramBuild(build);
+			return build.status;
+		}
+
+		// link shaders
+		build.program = glCreateProgram();
+		glAttachShader(build.program, build.vertexShader);
+		glAttachShader(build.program, build.fragmentShader);
+		if (cache)
+		{
+			cache->PrepareProgram(build.program);
+		}
+		glLinkProgram(build.program);
+		build.status = SHADER_BUILD_LINKING;
+		return build.status;
+	}
+
+	if (build.status == SHADER_BUILD_LINKING)
+	{
+		if (!IsShaderObjectComplete(build.program, true))
+		{
+			return build.status;
+		}
+
+		// check for linking errors
+		glGetProgramiv(build.program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			glGetProgramInfoLog(build.program, 512, NULL, infoLog);
+			std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+			CancelProgramBuild(build);
+			return build.status;
+		}
+		glDeleteShader(build.vertexShader);
+		glDeleteShader(build.fragmentShader);
+		build.vertexShader = 0;
+		build.fragmentShader = 0;
+
+		if (cache)
+		{
+			cache->Store(build.cacheKey, build.program);
+		}
+		build.status = SHADER_BUILD_DONE;
+	}
+	return build.status;
+}
+
+void ShaderLoader::CancelProgramBuild(ShaderProgramBuild& build)
+{
+	// a done program belongs to the caller
+	if (build.status != SHADER_BUILD_DONE && build.program != -1)
+	{
+		glDeleteProgram(build.program);
+	}
+	glDeleteShader(build.vertexShader);
+	glDeleteShader(build.fragmentShader);
+	build = ShaderProgramBuild();
+}
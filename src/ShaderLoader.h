@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ShaderProgramCache.h"
+
+enum ShaderBuildStatus : uint32_t
+{
+	SHADER_BUILD_COMPILING = 0,
+	SHADER_BUILD_LINKING,
+	// the program is ready, it belongs to the caller
+	SHADER_BUILD_DONE,
+	// the error log was printed, nothing is left to delete
+	SHADER_BUILD_FAILED,
+};
+
+// Shaders and program of a build in flight, see ShaderLoader::StartProgramBuild
+struct ShaderProgramBuild
+{
+	unsigned int vertexShader = 0;
+	unsigned int fragmentShader = 0;
+	int program = -1;
+	uint64_t cacheKey = 0;
+	ShaderBuildStatus status = SHADER_BUILD_FAILED;
+};
+
+// Reads, compiles and links the shader programs. GL thread only, except ReadShader and AddShaderDefines.
+class ShaderLoader
+{
+public:
+	// Content of the file at shaderPath, empty (with an error printed) when it can't be read
+	static std::string ReadShader(const std::string& shaderPath);
+	// Inserts a #define for every entry of defines right after the #version line
+	static std::string AddShaderDefines(const std::string& shaderSource, const std::vector<std::string>& defines);
+	// Source of the file at shaderPath with the defines inserted after its #version line and every #include "file" line
+	// replaced by the preprocessed content of file (relative to the including file, each file included once).
+	// #line directives keep the compile errors at the right line, with the index of the file in files as source string number.
+	// files receives every file read, shaderPath first. Empty (with an error printed) when a file can't be read.
+	static std::string PreprocessShader(const std::string& shaderPath, const std::vector<std::string>& defines,
+		std::vector<std::string>* files = nullptr);
+
+	// Compiles and links the program right away, -1 on failure.
+	// With a cache the program is created from its binary when there is one, otherwise the binary of the new program is stored.
+	static int CreateCompileAndLinkShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource,
+		ShaderProgramCache* cache = nullptr);
+
+	// KHR_parallel_shader_compile (or its ARB version): the driver compiles and links on its own threads,
+	// and the completion can be polled without waiting for it
+	static bool IsParallelCompileSupported();
+
+	// Submits the compilation of both shaders and returns at once, UpdateProgramBuild does the rest.
+	// A binary found in cache makes the build done right away.
+	static ShaderProgramBuild StartProgramBuild(const std::string& vertexShaderSource, const std::string& fragmentShaderSource,
+		ShaderProgramCache* cache = nullptr);
+	// Links once both shaders are compiled, stores the binary once linked. Only queries the status of a step once the driver
+	// reports it complete when IsParallelCompileSupported, otherwise each call waits for the step it checks.
+	static ShaderBuildStatus UpdateProgramBuild(ShaderProgramBuild& build, ShaderProgramCache* cache = nullptr);
+	// Deletes whatever the build still holds, a done program belongs to the caller and is left alone
+	static void CancelProgramBuild(ShaderProgramBuild& build);
+};
@@ -0,0 +1,202 @@
+#include "ShaderProgramCache.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "Hash.h"
+#include "MappedFile.h"
+
+// Bump every time the file layout changes
+const uint32_t SHADER_PROGRAM_CACHE_MAGIC = 0x50505753; // "SWPP"
+const uint32_t SHADER_PROGRAM_CACHE_VERSION = 1;
+
+struct ShaderProgramCacheFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	uint32_t binaryFormat;
+	uint32_t binarySize;
+	// hash of the binary, a truncated or corrupted file is never handed to the driver
+	uint64_t binaryHash;
+};
+
+// Driver string as a std::string, empty when the driver has none
+std::string GetGLString(GLenum name)
+{
+	const char* value = reinterpret_cast<const char*>(glGetString(name));
+	return value != nullptr ? value : "";
+}
+
+ShaderProgramCache::ShaderProgramCache(const std::string& directory)
+	: directory(directory)
+{
+	GLint formatCount = 0;
+	if (glProgramBinary != nullptr && glGetProgramBinary != nullptr && glProgramParameteri != nullptr)
+	{
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	}
+	isAvailable = formatCount > 0;
+	if (!isAvailable)
+	{
+		std::cout << "SHADER_PROGRAM_CACHE::NO_BINARY_FORMAT, the shaders are compiled on every launch" << std::endl;
+		return;
+	}
+
+	driverHash = HashString(GetGLString(GL_VENDOR));
+	driverHash = HashString(GetGLString(GL_RENDERER), driverHash);
+	driverHash = HashString(GetGLString(GL_VERSION), driverHash);
+}
+
+uint64_t ShaderProgramCache::ComputeKey(const std::string& vertexSource, const std::string& fragmentSource) const
+{
+	// the sizes keep moving text from one stage to the other from giving the same key
+	const uint64_t sizes[2] = { vertexSource.size(), fragmentSource.size() };
+	uint64_t key = HashBytes(sizes, sizeof(sizes), driverHash);
+	key = HashString(vertexSource, key);
+	return HashString(fragmentSource, key);
+}
+
+int ShaderProgramCache::Load(uint64_t key)
+{
+	if (!isAvailable)
+	{
+		missCount++;
+		return -1;
+	}
+
+	MappedFile file;
+	if (!file.Open(GetCachePath(key)))
+	{
+		missCount++;
+		return -1;
+	}
+
+	const unsigned char* data = file.GetData();
+	const size_t size = file.GetSize();
+	const ShaderProgramCacheFileHeader* header = reinterpret_cast<const ShaderProgramCacheFileHeader*>(data);
+	const bool isValid =
+		size >= sizeof(ShaderProgramCacheFileHeader) &&
+		header->magic == SHADER_PROGRAM_CACHE_MAGIC &&
+		header->version == SHADER_PROGRAM_CACHE_VERSION &&
+		header->key == key &&
+		header->binarySize == size - sizeof(ShaderProgramCacheFileHeader) &&
+		header->binaryHash == HashBytes(data + sizeof(ShaderProgramCacheFileHeader), header->binarySize);
+	if (!isValid)
+	{
+		missCount++;
+		return -1;
+	}
+
+	const GLuint program = glCreateProgram();
+	glProgramBinary(program, header->binaryFormat, data + sizeof(ShaderProgramCacheFileHeader), static_cast<GLsizei>(header->binarySize));
+	GLint success = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		// the caller compiles the sources and stores a binary the driver accepts in place of this one
+		glDeleteProgram(program);
+		rejectedCount++;
+		missCount++;
+		return -1;
+	}
+
+	hitCount++;
+	return static_cast<int>(program);
+}
+
+void ShaderProgramCache::PrepareProgram(unsigned int program) const
+{
+	if (isAvailable)
+	{
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+}
+
+bool ShaderProgramCache::Store(uint64_t key, unsigned int program)
+{
+	if (!isAvailable)
+	{
+		return false;
+	}
+
+	GLint binarySize = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+	if (binarySize <= 0)
+	{
+		return false;
+	}
+
+	std::vector<unsigned char> binary(static_cast<size_t>(binarySize));
+	GLenum binaryFormat = 0;
+	GLsizei writtenSize = 0;
+	glGetProgramBinary(program, binarySize, &writtenSize, &binaryFormat, binary.data());
+	if (writtenSize <= 0)
+	{
+		return false;
+	}
+
+	ShaderProgramCacheFileHeader header = {};
+	header.magic = SHADER_PROGRAM_CACHE_MAGIC;
+	header.version = SHADER_PROGRAM_CACHE_VERSION;
+	header.key = key;
+	header.binaryFormat = binaryFormat;
+	header.binarySize = static_cast<uint32_t>(writtenSize);
+	header.binaryHash = HashBytes(binary.data(), header.binarySize);
+
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+
+	const std::string cachePath = GetCachePath(key);
+	const std::string temporaryPath = cachePath + ".tmp";
+	{
+		std::ofstream cacheFile(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!cacheFile)
+		{
+			std::cout << "ERROR::SHADER_PROGRAM_CACHE::CAN_NOT_CREATE_FILE " << temporaryPath << std::endl;
+			return false;
+		}
+
+		cacheFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		cacheFile.write(reinterpret_cast<const char*>(binary.data()), static_cast<std::streamsize>(header.binarySize));
+		if (!cacheFile)
+		{
+			std::cout << "ERROR::SHADER_PROGRAM_CACHE::WRITE_FAILED " << temporaryPath << std::endl;
+			cacheFile.close();
+			std::remove(temporaryPath.c_str());
+			return false;
+		}
+	}
+
+	// std::rename doesn't replace existing files on every platform
+	std::remove(cachePath.c_str());
+	if (std::rename(temporaryPath.c_str(), cachePath.c_str()) != 0)
+	{
+		std::remove(temporaryPath.c_str());
+		return false;
+	}
+	storedCount++;
+	return true;
+}
+
+std::string ShaderProgramCache::GetCachePath(uint64_t key) const
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.swprog", static_cast<unsigned long long>(key));
+	return directory + "/" + name;
+}
+
+ShaderProgramCacheStatistics ShaderProgramCache::GetStatistics() const
+{
+	ShaderProgramCacheStatistics statistics;
+	statistics.hitCount = hitCount;
+	statistics.missCount = missCount;
+	statistics.rejectedCount = rejectedCount;
+	statistics.storedCount = storedCount;
+	return statistics;
+}
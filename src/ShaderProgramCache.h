@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct ShaderProgramCacheStatistics
+{
+	// programs created from a cached binary
+	size_t hitCount = 0;
+	// programs with no binary cached yet
+	size_t missCount = 0;
+	// binaries the driver refused (updated driver, other GPU...), compiled again and replaced
+	size_t rejectedCount = 0;
+	size_t storedCount = 0;
+};
+
+// Linked program binaries (glGetProgramBinary) kept on disk, so the next launches skip compiling and linking the shaders.
+// A binary is only valid for the driver that produced it: the key covers the sources and the GL_VENDOR, GL_RENDERER and
+// GL_VERSION strings, and glProgramBinary failing for any other reason makes Load report a miss.
+// Needs glProgramBinary (GL 4.1 or ARB_get_program_binary) and a driver exposing a binary format. Without them
+// IsAvailable is false and every Load misses. GL thread only.
+class ShaderProgramCache
+{
+public:
+	// Binaries are stored as <directory>/<key>.swprog, the directory is created by the first Store
+	explicit ShaderProgramCache(const std::string& directory);
+
+	ShaderProgramCache(const ShaderProgramCache&) = delete;
+	ShaderProgramCache& operator=(const ShaderProgramCache&) = delete;
+
+	bool IsAvailable() const { return isAvailable; }
+
+	// Key of the program linked from these sources, defines included, on the current driver
+	uint64_t ComputeKey(const std::string& vertexSource, const std::string& fragmentSource) const;
+
+	// New program created from the binary cached under key, -1 when there is none or the driver rejects it
+	int Load(uint64_t key);
+	// Must be called before linking the programs given to Store, the driver may not keep their binary otherwise
+	void PrepareProgram(unsigned int program) const;
+	// Writes the binary of the linked program under key (through a temporary file, like MeshCache)
+	bool Store(uint64_t key, unsigned int program);
+
+	std::string GetCachePath(uint64_t key) const;
+
+	ShaderProgramCacheStatistics GetStatistics() const;
+
+private:
+	std::string directory;
+	bool isAvailable = false;
+	// hash of the driver strings, seeds ComputeKey
+	uint64_t driverHash = 0;
+
+	size_t hitCount = 0;
+	size_t missCount = 0;
+	size_t rejectedCount = 0;
+	size_t storedCount = 0;
+};
@@ -0,0 +1,230 @@
+#include "ShaderUniformTable.h"
+
+#include <cstring>
+
+#include <glad/glad.h>
+
+bool IsIntUniformType(unsigned int type)
+{
+	switch (type)
+	{
+	case GL_INT:
+	case GL_BOOL:
+	case GL_SAMPLER_2D:
+	case GL_SAMPLER_3D:
+	case GL_SAMPLER_CUBE:
+	case GL_SAMPLER_2D_SHADOW:
+	case GL_SAMPLER_2D_ARRAY:
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool IsFloatUniformType(unsigned int type)
+{
+	return type == GL_FLOAT;
+}
+
+bool IsVec3UniformType(unsigned int type)
+{
+	return type == GL_FLOAT_VEC3;
+}
+
+bool IsMat4UniformType(unsigned int type)
+{
+	return type == GL_FLOAT_MAT4;
+}
+
+// Bytes of the shadow of a uniform of type, 0 for the types without a setter
+size_t GetUniformValueSize(unsigned int type)
+{
+	if (IsIntUniformType(type))
+	{
+		return sizeof(GLint);
+	}
+	if (IsFloatUniformType(type))
+	{
+		return sizeof(GLfloat);
+	}
+	if (IsVec3UniformType(type))
+	{
+		return sizeof(glm::vec3);
+	}
+	if (IsMat4UniformType(type))
+	{
+		return sizeof(glm::mat4);
+	}
+	return 0;
+}
+
+ShaderUniformTable::ShaderUniformTable(int program)
+	: program(program)
+{
+	GLint uniformCount = 0;
+	GLint maxNameLength = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	std::vector<char> nameBuffer(static_cast<size_t>(maxNameLength) + 1);
+	for (GLint index = 0; index < uniformCount; ++index)
+	{
+		GLsizei nameLength = 0;
+		GLint arraySize = 0;
+		GLenum type = 0;
+		glGetActiveUniform(program, static_cast<GLuint>(index), static_cast<GLsizei>(nameBuffer.size()), &nameLength, &arraySize, &type,
+			nameBuffer.data());
+
+		std::string name(nameBuffer.data(), static_cast<size_t>(nameLength));
+		const int location = glGetUniformLocation(program, name.c_str());
+		if (location == -1)
+		{
+			// member of a uniform block
+			continue;
+		}
+		if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+		{
+			name.resize(name.size() - 3);
+		}
+
+		Uniform uniform;
+		uniform.location = location;
+		uniform.type = type;
+		uniform.offset = values.size();
+		uniform.size = GetUniformValueSize(type);
+		values.resize(values.size() + uniform.size);
+		uniforms[name] = uniform;
+	}
+
+	GLint blockCount = 0;
+	GLint maxBlockNameLength = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxBlockNameLength);
+
+	nameBuffer.resize(static_cast<size_t>(maxBlockNameLength) + 1);
+	for (GLint index = 0; index < blockCount; ++index)
+	{
+		GLsizei nameLength = 0;
+		glGetActiveUniformBlockName(program, static_cast<GLuint>(index), static_cast<GLsizei>(nameBuffer.size()), &nameLength,
+			nameBuffer.data());
+
+		UniformBlock block;
+		block.index = static_cast<unsigned int>(index);
+		blocks[std::string(nameBuffer.data(), static_cast<size_t>(nameLength))] = block;
+	}
+}
+
+int ShaderUniformTable::GetLocation(const std::string& name) const
+{
+	const auto uniform = uniforms.find(name);
+	return uniform != uniforms.end() ? uniform->second.location : -1;
+}
+
+bool ShaderUniformTable::SetInt(const std::string& name, int value)
+{
+	Uniform* uniform = Find(name, IsIntUniformType);
+	if (!uniform)
+	{
+		return false;
+	}
+	if (Shadow(*uniform, &value))
+	{
+		glUniform1i(uniform->location, value);
+	}
+	return true;
+}
+
+bool ShaderUniformTable::SetFloat(const std::string& name, float value)
+{
+	Uniform* uniform = Find(name, IsFloatUniformType);
+	if (!uniform)
+	{
+		return false;
+	}
+	if (Shadow(*uniform, &value))
+	{
+		glUniform1f(uniform->location, value);
+	}
+	return true;
+}
+
+bool ShaderUniformTable::SetVec3(const std::string& name, const glm::vec3& value)
+{
+	Uniform* uniform = Find(name, IsVec3UniformType);
+	if (!uniform)
+	{
+		return false;
+	}
+	if (Shadow(*uniform, &value[0]))
+	{
+		glUniform3fv(uniform->location, 1, &value[0]);
+	}
+	return true;
+}
+
+bool ShaderUniformTable::SetMat4(const std::string& name, const glm::mat4& value)
+{
+	Uniform* uniform = Find(name, IsMat4UniformType);
+	if (!uniform)
+	{
+		return false;
+	}
+	if (Shadow(*uniform, &value[0][0]))
+	{
+		glUniformMatrix4fv(uniform->location, 1, GL_FALSE, &value[0][0]);
+	}
+	return true;
+}
+
+bool ShaderUniformTable::SetBlockBinding(const std::string& name, unsigned int bindingPoint)
+{
+	const auto block = blocks.find(name);
+	if (block == blocks.end())
+	{
+		return false;
+	}
+	if (block->second.bindingPoint == static_cast<int>(bindingPoint))
+	{
+		skippedCount++;
+		return true;
+	}
+	glUniformBlockBinding(program, block->second.index, bindingPoint);
+	block->second.bindingPoint = static_cast<int>(bindingPoint);
+	uploadCount++;
+	return true;
+}
+
+ShaderUniformTable::Uniform* ShaderUniformTable::Find(const std::string& name, bool (*isType)(unsigned int))
+{
+	const auto uniform = uniforms.find(name);
+	if (uniform == uniforms.end() || !isType(uniform->second.type))
+	{
+		return nullptr;
+	}
+	return &uniform->second;
+}
+
+bool ShaderUniformTable::Shadow(Uniform& uniform, const void* value)
+{
+	unsigned char* shadow = values.data() + uniform.offset;
+	// byte compare, -0.0 and 0.0 count as different values
+	if (uniform.isSet && std::memcmp(shadow, value, uniform.size) == 0)
+	{
+		skippedCount++;
+		return false;
+	}
+	std::memcpy(shadow, value, uniform.size);
+	uniform.isSet = true;
+	uploadCount++;
+	return true;
+}
+
+ShaderUniformStatistics ShaderUniformTable::GetStatistics() const
+{
+	ShaderUniformStatistics statistics;
+	statistics.uniformCount = uniforms.size();
+	statistics.blockCount = blocks.size();
+	statistics.uploadCount = uploadCount;
+	statistics.skippedCount = skippedCount;
+	return statistics;
+}
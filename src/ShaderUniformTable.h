@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+struct ShaderUniformStatistics
+{
+	size_t uniformCount = 0;
+	size_t blockCount = 0;
+	// glUniform* (and glUniformBlockBinding) calls issued, and the sets skipped because the uniform already had the value
+	size_t uploadCount = 0;
+	size_t skippedCount = 0;
+};
+
+// Active uniforms of a linked program, reflected once with glGetActiveUniform, with a CPU copy of their current value.
+// The setters only call glUniform* when the value differs from the one the program already has, so the constants set every
+// draw cost a compare. The uniforms of uniform blocks have no location, their blocks are listed apart. GL thread only.
+class ShaderUniformTable
+{
+public:
+	explicit ShaderUniformTable(int program);
+
+	ShaderUniformTable(const ShaderUniformTable&) = delete;
+	ShaderUniformTable& operator=(const ShaderUniformTable&) = delete;
+
+	int GetProgram() const { return program; }
+	// -1 when the program has no such uniform (or the compiler removed it)
+	int GetLocation(const std::string& name) const;
+
+	// The program must be in use. False when it has no uniform of that name and type, nothing is uploaded then.
+	// SetInt also sets bool and sampler uniforms (the texture unit).
+	bool SetInt(const std::string& name, int value);
+	bool SetFloat(const std::string& name, float value);
+	bool SetVec3(const std::string& name, const glm::vec3& value);
+	bool SetMat4(const std::string& name, const glm::mat4& value);
+	// Binds the uniform block called name to bindingPoint (glUniformBlockBinding), skipped when it already is.
+	// False when the program has no such block. Doesn't need the program in use.
+	bool SetBlockBinding(const std::string& name, unsigned int bindingPoint);
+
+	ShaderUniformStatistics GetStatistics() const;
+
+private:
+	struct Uniform
+	{
+		int location = -1;
+		unsigned int type = 0;		// GLenum
+		// of its current value in values
+		size_t offset = 0;
+		size_t size = 0;
+		// false until the first set, the linker's default is not shadowed
+		bool isSet = false;
+	};
+
+	struct UniformBlock
+	{
+		unsigned int index = 0;
+		// -1 until set
+		int bindingPoint = -1;
+	};
+
+	// The uniform called name when its type is accepted by isType, nullptr otherwise
+	Uniform* Find(const std::string& name, bool (*isType)(unsigned int));
+	// Copies value to the shadow of uniform, false when it already held it
+	bool Shadow(Uniform& uniform, const void* value);
+
+	int program;
+	// arrays by the name of their first element, without [0]
+	std::unordered_map<std::string, Uniform> uniforms;
+	std::vector<unsigned char> values;
+	std::unordered_map<std::string, UniformBlock> blocks;
+
+	size_t uploadCount = 0;
+	size_t skippedCount = 0;
+};
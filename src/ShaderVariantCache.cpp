@@ -0,0 +1,93 @@
+#include "ShaderVariantCache.h"
+
+// define of every ShaderFeature, by bit
+const char* const SHADER_FEATURE_NAMES[SHADER_FEATURE_COUNT] =
+{
+	"NORMAL_MAP",
+	"SPECULAR",
+	"PACKED_VERTEX",
+	"MATERIAL_ARRAY",
+};
+
+ShaderVariantCache::ShaderVariantCache(const std::string& vertexPath, const std::string& fragmentPath, ShaderProgramCache* cache,
+	const std::vector<std::string>& defines)
+	: vertexPath(vertexPath), fragmentPath(fragmentPath), cache(cache), defines(defines)
+{
+}
+
+int ShaderVariantCache::GetProgram(uint32_t features, bool wait)
+{
+	std::unique_ptr<ReloadableShaderProgram>& variant = variants[features];
+	if (!variant)
+	{
+		std::vector<std::string> variantDefines = defines;
+		const std::vector<std::string> featureDefines = GetFeatureDefines(features);
+		variantDefines.insert(variantDefines.end(), featureDefines.begin(), featureDefines.end());
+		variant = std::make_unique<ReloadableShaderProgram>(vertexPath, fragmentPath, variantDefines, variantDefines, cache);
+
+		if (wait)
+		{
+			variant->Load();
+		}
+		else
+		{
+			variant->Reload();
+		}
+	}
+	return variant->GetProgram();
+}
+
+ShaderUniformTable* ShaderVariantCache::GetUniforms(uint32_t features) const
+{
+	const auto variant = variants.find(features);
+	return variant != variants.end() ? variant->second->GetUniforms() : nullptr;
+}
+
+void ShaderVariantCache::OnFileChanged(const std::string& path)
+{
+	for (auto& variant : variants)
+	{
+		variant.second->OnFileChanged(path);
+	}
+}
+
+void ShaderVariantCache::Update()
+{
+	for (auto& variant : variants)
+	{
+		variant.second->Update();
+	}
+}
+
+std::vector<std::string> ShaderVariantCache::GetFeatureDefines(uint32_t features)
+{
+	std::vector<std::string> featureDefines;
+	for (uint32_t bit = 0; bit < SHADER_FEATURE_COUNT; ++bit)
+	{
+		if (features & (1u << bit))
+		{
+			featureDefines.push_back(SHADER_FEATURE_NAMES[bit]);
+		}
+	}
+	return featureDefines;
+}
+
+ShaderVariantCacheStatistics ShaderVariantCache::GetStatistics() const
+{
+	ShaderVariantCacheStatistics statistics;
+	statistics.variantCount = variants.size();
+	for (const auto& variant : variants)
+	{
+		const ReloadableShaderProgramStatistics variantStatistics = variant.second->GetStatistics();
+		statistics.readyCount += variant.second->GetProgram() != -1 ? 1 : 0;
+		statistics.reloadCount += variantStatistics.reloadCount;
+		statistics.failedCount += variantStatistics.failedCount;
+		if (const ShaderUniformTable* uniforms = variant.second->GetUniforms())
+		{
+			const ShaderUniformStatistics uniformStatistics = uniforms->GetStatistics();
+			statistics.uniformUploadCount += uniformStatistics.uploadCount;
+			statistics.uniformSkippedCount += uniformStatistics.skippedCount;
+		}
+	}
+	return statistics;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ReloadableShaderProgram.h"
+#include "ShaderProgramCache.h"
+
+// Feature keywords of a shader variant, each one is a #define of the same name in both stages
+enum ShaderFeature : uint32_t
+{
+	SHADER_FEATURE_NONE = 0,
+	// tangent space normal mapping, the variants without it skip the TBN work and use the vertex normal
+	SHADER_FEATURE_NORMAL_MAP = 1 << 0,
+	// Blinn specular highlights driven by the roughness
+	SHADER_FEATURE_SPECULAR = 1 << 1,
+	// PackedVertexData vertices
+	SHADER_FEATURE_PACKED_VERTEX = 1 << 2,
+	// texture array materials, see TextureArrayBuilder
+	SHADER_FEATURE_MATERIAL_ARRAY = 1 << 3,
+	SHADER_FEATURE_COUNT = 4,
+};
+
+struct ShaderVariantCacheStatistics
+{
+	size_t variantCount = 0;
+	// variants with a program, the others are compiling or failed to
+	size_t readyCount = 0;
+	size_t reloadCount = 0;
+	size_t failedCount = 0;
+	// glUniform* calls of the current programs, and those their uniform tables skipped
+	size_t uniformUploadCount = 0;
+	size_t uniformSkippedCount = 0;
+};
+
+// Specialized variants of one vertex and fragment shader pair, one per combination of ShaderFeature flags (the permutation key).
+// A variant is compiled the first time it is asked for, in the background, then kept (and hot reloaded) for the next requests.
+// GL thread only.
+class ShaderVariantCache
+{
+public:
+	// defines go to every variant, before their feature keywords. cache, if any, must outlive the variants.
+	ShaderVariantCache(const std::string& vertexPath, const std::string& fragmentPath, ShaderProgramCache* cache = nullptr,
+		const std::vector<std::string>& defines = {});
+
+	ShaderVariantCache(const ShaderVariantCache&) = delete;
+	ShaderVariantCache& operator=(const ShaderVariantCache&) = delete;
+
+	// Program of the variant with features, -1 while it compiles or when it failed to. A new variant is started in the background,
+	// or built before returning with wait (for the first frame).
+	int GetProgram(uint32_t features, bool wait = false);
+	// Uniforms of the program of the variant with features, nullptr until it is built (GetProgram starts it)
+	ShaderUniformTable* GetUniforms(uint32_t features) const;
+
+	// Reloads the variants using path, see ReloadableShaderProgram::OnFileChanged
+	void OnFileChanged(const std::string& path);
+	// Once per frame: advances the builds of every variant. Programs replaced by a reload are deleted, what was looked up
+	// from them must be looked up again (GetProgram returns another program then).
+	void Update();
+
+	// Names of the ShaderFeature flags set in features
+	static std::vector<std::string> GetFeatureDefines(uint32_t features);
+
+	ShaderVariantCacheStatistics GetStatistics() const;
+
+private:
+	std::string vertexPath;
+	std::string fragmentPath;
+	ShaderProgramCache* cache;
+	std::vector<std::string> defines;
+
+	std::unordered_map<uint32_t, std::unique_ptr<ReloadableShaderProgram>> variants;
+};
@@ -0,0 +1,270 @@
+#include "TextureArrayBuilder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include <glad/glad.h>
+
+#include "MipGenerator.h"
+
+// the color and normal maps are rgb, the packed texture has the 3 packed maps
+const uint32_t TEXTURE_ARRAY_CHANNELS = 3;
+
+// texel of the layers without a map, the values shader.fs falls back to: white albedo, flat normal,
+// no occlusion, 0.6 roughness and no displacement
+const unsigned char TEXTURE_ARRAY_DEFAULTS[MATERIAL_BINDING_COUNT][TEXTURE_ARRAY_CHANNELS] =
+{
+	{ 255, 255, 255 },
+	{ 128, 128, 255 },
+	{ 255, 153, 0 },
+};
+
+// width x height image and its full mip chain filled with the default texel of binding
+DecodedImage CreateDefaultLayerImage(MaterialTextureBinding binding, uint32_t width, uint32_t height)
+{
+	auto fill = [binding](unsigned char* pixels, size_t texelCount)
+	{
+		for (size_t n = 0; n < texelCount; ++n)
+		{
+			std::memcpy(pixels + n * TEXTURE_ARRAY_CHANNELS, TEXTURE_ARRAY_DEFAULTS[binding], TEXTURE_ARRAY_CHANNELS);
+		}
+	};
+
+	DecodedImage image;
+	image.width = static_cast<int>(width);
+	image.height = static_cast<int>(height);
+	image.channels = TEXTURE_ARRAY_CHANNELS;
+	image.pixels = std::shared_ptr<unsigned char>(new unsigned char[size_t(width) * height * TEXTURE_ARRAY_CHANNELS],
+		std::default_delete<unsigned char[]>());
+	fill(image.pixels.get(), size_t(width) * height);
+
+	image.mips = std::make_shared<std::vector<MipLevel>>(MipGenerator::GetMipCount(width, height) - 1);
+	for (MipLevel& mip : *image.mips)
+	{
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+		mip.width = width;
+		mip.height = height;
+		mip.pixels.resize(size_t(width) * height * TEXTURE_ARRAY_CHANNELS);
+		fill(mip.pixels.data(), size_t(width) * height);
+	}
+	return image;
+}
+
+TextureArrayBuilder::TextureArrayBuilder(AssetLoader& assetLoader, uint32_t layerWidth, uint32_t layerHeight, uint32_t maxLayers,
+	size_t sliceBytes, PixelUploadRing* uploadRing)
+	: assetLoader(assetLoader), layerWidth(layerWidth), layerHeight(layerHeight), maxLayers(maxLayers),
+	mipCount(MipGenerator::GetMipCount(layerWidth, layerHeight)), sliceBytes(sliceBytes), uploadRing(uploadRing)
+{
+	glGenTextures(MATERIAL_BINDING_COUNT, textures);
+	for (uint32_t binding = 0; binding < MATERIAL_BINDING_COUNT; ++binding)
+	{
+		glBindTexture(GL_TEXTURE_2D_ARRAY, textures[binding]);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(mipCount - 1));
+		for (uint32_t level = 0; level < mipCount; ++level)
+		{
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLint>(level), GL_RGB8, std::max(layerWidth >> level, 1u),
+				std::max(layerHeight >> level, 1u), maxLayers, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+TextureArrayBuilder::~TextureArrayBuilder()
+{
+	glDeleteTextures(MATERIAL_BINDING_COUNT, textures);
+}
+
+int TextureArrayBuilder::AddMaterial(const std::string& setPath)
+{
+	if (layerSets.size() >= maxLayers)
+	{
+		std::cout << "ERROR::TEXTURE_ARRAY::NO_LAYER_LEFT for " << setPath << std::endl;
+		return -1;
+	}
+
+	const int layer = static_cast<int>(layerSets.size());
+	const size_t nameStart = setPath.find_last_of("/\\");
+	layerSets.push_back(nameStart == std::string::npos ? setPath : setPath.substr(nameStart + 1));
+	loadedLayers.push_back(false);
+
+	assetLoader.Load([this, setPath, layer]() -> AssetLoader::UploadStep
+	{
+		std::vector<std::string> paths;
+		std::vector<int> channels;
+		for (uint32_t slot = 0; slot < MATERIAL_TEXTURE_SLOT_COUNT; ++slot)
+		{
+			paths.push_back(TextureLoader::GetMaterialTexturePath(setPath, static_cast<MaterialTextureSlot>(slot)));
+			channels.push_back(TextureLoader::GetMaterialTextureChannels(static_cast<MaterialTextureSlot>(slot)));
+		}
+		const std::vector<DecodedImage> maps = TextureLoader::DecodeImages(paths, channels);
+
+		MaterialDescriptor descriptor;
+		std::vector<DecodedImage> images(MATERIAL_BINDING_COUNT);
+		images[MATERIAL_BINDING_ALBEDO] = maps[MATERIAL_TEXTURE_ALBEDO];
+		images[MATERIAL_BINDING_NORMAL] = maps[MATERIAL_TEXTURE_NORMAL];
+		images[MATERIAL_BINDING_PACKED] = TextureLoader::PackMaterialMaps(maps.data(), descriptor);
+
+		// the packed channels the set doesn't have hold their default, GetDescriptor reads all of them
+		DecodedImage& packed = images[MATERIAL_BINDING_PACKED];
+		const int missingChannels[3] =
+		{
+			descriptor.occlusionChannel < 0 ? TextureLoader::GetPackedChannel(MATERIAL_TEXTURE_AMBIENT_OCCLUSION) : -1,
+			descriptor.roughnessChannel < 0 ? TextureLoader::GetPackedChannel(MATERIAL_TEXTURE_ROUGHNESS) : -1,
+			descriptor.displacementChannel < 0 ? TextureLoader::GetPackedChannel(MATERIAL_TEXTURE_DISPLACEMENT) : -1,
+		};
+		for (int channel : missingChannels)
+		{
+			if (packed.pixels && channel >= 0)
+			{
+				const size_t texelCount = size_t(packed.width) * packed.height;
+				for (size_t n = 0; n < texelCount; ++n)
+				{
+					packed.pixels.get()[n * TEXTURE_ARRAY_CHANNELS + channel] = TEXTURE_ARRAY_DEFAULTS[MATERIAL_BINDING_PACKED][channel];
+				}
+			}
+		}
+
+		const MipGenerationMode mipModes[MATERIAL_BINDING_COUNT] = { TextureLoader::GetMaterialTextureMipMode(MATERIAL_TEXTURE_ALBEDO),
+			TextureLoader::GetMaterialTextureMipMode(MATERIAL_TEXTURE_NORMAL), MIP_GENERATION_LINEAR };
+		std::vector<uint32_t> firstLevels(MATERIAL_BINDING_COUNT, 0);
+		size_t defaultedMaps = 0;
+		for (uint32_t binding = 0; binding < MATERIAL_BINDING_COUNT; ++binding)
+		{
+			// the level of the layer size, the finer ones are dropped once the mips are generated
+			DecodedImage& image = images[binding];
+			bool isMatching = false;
+			for (uint32_t level = 0; image.pixels && image.channels == TEXTURE_ARRAY_CHANNELS && level < 16 && !isMatching; ++level)
+			{
+				isMatching = uint64_t(layerWidth) << level == uint64_t(image.width) && uint64_t(layerHeight) << level == uint64_t(image.height);
+				firstLevels[binding] = level;
+			}
+
+			if (isMatching)
+			{
+				TextureLoader::GenerateMips(image, mipModes[binding]);
+				continue;
+			}
+
+			if (image.pixels)
+			{
+				std::cout << "ERROR::TEXTURE_ARRAY::SIZE_MISMATCH " << setPath << " binding " << binding << " is " << image.width << "x"
+					<< image.height << ", the layers are " << layerWidth << "x" << layerHeight << std::endl;
+			}
+			image = CreateDefaultLayerImage(static_cast<MaterialTextureBinding>(binding), layerWidth, layerHeight);
+			firstLevels[binding] = 0;
+			defaultedMaps++;
+		}
+
+		return CreateUploadStep(layer, images, firstLevels, defaultedMaps);
+	});
+	return layer;
+}
+
+int TextureArrayBuilder::FindMaterial(const std::string& texturePath) const
+{
+	MaterialTextureSlot slot;
+	if (!TextureLoader::GetMaterialTextureSlot(texturePath, slot))
+	{
+		return -1;
+	}
+
+	// the path without the suffix of the map, then without its directory
+	const std::string setPath = texturePath.substr(0, texturePath.size() - TextureLoader::GetMaterialTexturePath("", slot).size());
+	const size_t nameStart = setPath.find_last_of("/\\");
+	const std::string setName = nameStart == std::string::npos ? setPath : setPath.substr(nameStart + 1);
+	const auto found = std::find(layerSets.begin(), layerSets.end(), setName);
+	return found != layerSets.end() ? static_cast<int>(found - layerSets.begin()) : -1;
+}
+
+bool TextureArrayBuilder::IsLayerLoaded(int layer) const
+{
+	return layer >= 0 && static_cast<size_t>(layer) < loadedLayers.size() && loadedLayers[layer];
+}
+
+void TextureArrayBuilder::Bind() const
+{
+	for (uint32_t binding = 0; binding < MATERIAL_BINDING_COUNT; ++binding)
+	{
+		glActiveTexture(GL_TEXTURE0 + binding);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, textures[binding]);
+	}
+}
+
+MaterialDescriptor TextureArrayBuilder::GetDescriptor()
+{
+	MaterialDescriptor descriptor;
+	descriptor.occlusionChannel = TextureLoader::GetPackedChannel(MATERIAL_TEXTURE_AMBIENT_OCCLUSION);
+	descriptor.roughnessChannel = TextureLoader::GetPackedChannel(MATERIAL_TEXTURE_ROUGHNESS);
+	descriptor.displacementChannel = TextureLoader::GetPackedChannel(MATERIAL_TEXTURE_DISPLACEMENT);
+	return descriptor;
+}
+
+TextureArrayStatistics TextureArrayBuilder::GetStatistics() const
+{
+	TextureArrayStatistics statistics;
+	statistics.layerCount = layerSets.size();
+	statistics.loadedLayerCount = static_cast<size_t>(std::count(loadedLayers.begin(), loadedLayers.end(), true));
+	statistics.maxLayers = maxLayers;
+	for (uint32_t level = 0; level < mipCount; ++level)
+	{
+		statistics.gpuBytes += size_t(std::max(layerWidth >> level, 1u)) * std::max(layerHeight >> level, 1u) * TEXTURE_ARRAY_CHANNELS;
+	}
+	statistics.gpuBytes *= size_t(maxLayers) * MATERIAL_BINDING_COUNT;
+	statistics.defaultedMapCount = defaultedMapCount;
+	return statistics;
+}
+
+AssetLoader::UploadStep TextureArrayBuilder::CreateUploadStep(int layer, const std::vector<DecodedImage>& images,
+	const std::vector<uint32_t>& firstLevels, size_t defaultedMaps)
+{
+	// binding by binding, level by level, staged on the calling worker
+	std::shared_ptr<std::vector<PixelUploadBand>> bands = std::make_shared<std::vector<PixelUploadBand>>();
+	for (uint32_t binding = 0; binding < MATERIAL_BINDING_COUNT; ++binding)
+	{
+		for (uint32_t level = 0; level < mipCount; ++level)
+		{
+			uint32_t width;
+			uint32_t height;
+			const unsigned char* pixels = TextureLoader::GetDecodedImageLevel(images[binding], firstLevels[binding] + level, width, height);
+			PixelUploadRing::StageRows(uploadRing, binding, level, pixels, size_t(width) * TEXTURE_ARRAY_CHANNELS, height, sliceBytes, *bands);
+		}
+	}
+
+	size_t nextBand = 0;
+	return [this, layer, images, firstLevels, defaultedMaps, bands, nextBand]() mutable
+	{
+		// until sliceBytes worth of rows were uploaded
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		size_t uploadedBytes = 0;
+		while (nextBand < bands->size() && uploadedBytes < sliceBytes)
+		{
+			PixelUploadBand& band = (*bands)[nextBand++];
+			uint32_t width;
+			uint32_t height;
+			TextureLoader::GetDecodedImageLevel(images[band.image], firstLevels[band.image] + band.level, width, height);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, textures[band.image]);
+			PixelUploadRing::Upload(band.pixels, [&](const void* source)
+			{
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLint>(band.level), 0, band.firstRow, layer, width, band.rows, 1, GL_RGB,
+					GL_UNSIGNED_BYTE, source);
+			});
+			uploadedBytes += band.pixels.GetSize();
+		}
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+		if (nextBand < bands->size())
+		{
+			return false;
+		}
+
+		loadedLayers[layer] = true;
+		defaultedMapCount += defaultedMaps;
+		return true;
+	};
+}
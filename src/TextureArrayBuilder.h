@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "AssetLoader.h"
+#include "PixelUploadRing.h"
+#include "TextureLoader.h"
+
+struct TextureArrayStatistics
+{
+	size_t layerCount = 0;
+	size_t loadedLayerCount = 0;
+	size_t maxLayers = 0;
+	// storage of the MATERIAL_BINDING_COUNT arrays and their mips
+	size_t gpuBytes = 0;
+	// maps missing from their set, or of a size no level of matches the layers, replaced by the defaults of shader.fs
+	size_t defaultedMapCount = 0;
+};
+
+// Packs texture sets of the same size into GL_TEXTURE_2D_ARRAY textures, one array per MaterialTextureBinding and one
+// layer per material, so draws of different materials only differ by their layer index and need no texture rebind.
+// Sets larger than the layers by a power of two use the mip of the layer size (e.g. a 2K set among 1K ones).
+// Every channel of the packed layers is filled, the ones a set doesn't have hold the shader.fs defaults,
+// so GetDescriptor fits every layer.
+// Every method must be called from the GL thread, the builder must outlive the loads it started.
+class TextureArrayBuilder
+{
+public:
+	// Allocates the arrays and their full mip chains for maxLayers layers of layerWidth x layerHeight.
+	// Loads go through assetLoader and its upload budget, sliceBytes worth of rows per upload step, through uploadRing if any.
+	TextureArrayBuilder(AssetLoader& assetLoader, uint32_t layerWidth, uint32_t layerHeight, uint32_t maxLayers, size_t sliceBytes,
+		PixelUploadRing* uploadRing = nullptr);
+	~TextureArrayBuilder();
+
+	TextureArrayBuilder(const TextureArrayBuilder&) = delete;
+	TextureArrayBuilder& operator=(const TextureArrayBuilder&) = delete;
+
+	// Layer of the texture set at setPath (e.g. "../res/textures/Tiles093_1K-PNG/Tiles093_1K"), -1 when the arrays are full.
+	// Its maps are decoded on the workers and uploaded over the next frames, the layer content is undefined until IsLayerLoaded.
+	int AddMaterial(const std::string& setPath);
+	// Layer of the set a map belongs to, from the file name of the map (e.g. "Wood018_1K_Color.png"), -1 when no layer has it
+	int FindMaterial(const std::string& texturePath) const;
+
+	bool IsLayerLoaded(int layer) const;
+	uint32_t GetLayerCount() const { return static_cast<uint32_t>(layerSets.size()); }
+
+	// Binds the array of every binding to the texture unit of that binding
+	void Bind() const;
+	unsigned int GetTexture(MaterialTextureBinding binding) const { return textures[binding]; }
+	// Channels of the packed layers, the same for all of them
+	static MaterialDescriptor GetDescriptor();
+
+	TextureArrayStatistics GetStatistics() const;
+
+private:
+	// Upload step writing images (indexed by MaterialTextureBinding) to layer, from their level firstLevels[binding].
+	// Thread safe, the rows are staged in uploadRing by the calling worker.
+	// defaultedMaps of them hold defaults instead of maps of the set.
+	AssetLoader::UploadStep CreateUploadStep(int layer, const std::vector<DecodedImage>& images, const std::vector<uint32_t>& firstLevels,
+		size_t defaultedMaps);
+
+	AssetLoader& assetLoader;
+	uint32_t layerWidth;
+	uint32_t layerHeight;
+	uint32_t maxLayers;
+	uint32_t mipCount;
+	size_t sliceBytes;
+	PixelUploadRing* uploadRing;
+
+	unsigned int textures[MATERIAL_BINDING_COUNT] = {};
+	// file name of the set of every layer, e.g. "Tiles093_1K"
+	std::vector<std::string> layerSets;
+	std::vector<bool> loadedLayers;
+	size_t defaultedMapCount = 0;
+};
@@ -0,0 +1,257 @@
+#include "TextureContainer.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+// Bump every time the file layout or the data produced by the cooker changes
+const uint32_t TEXTURE_CONTAINER_MAGIC = 0x58545753; // "SWTX"
+const uint32_t TEXTURE_CONTAINER_VERSION = 3;
+const uint64_t TEXTURE_CONTAINER_ALIGNMENT = 16;
+const size_t TEXTURE_CONTAINER_PAGE_SIZE = 4096;
+
+struct TextureContainerFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t format;
+	uint32_t flags;
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipCount;
+	uint32_t reserved;
+};
+
+struct TextureContainerFileMip
+{
+	uint64_t offset;
+	uint64_t size;
+	uint32_t width;
+	uint32_t height;
+};
+
+uint64_t AlignContainerOffset(uint64_t offset)
+{
+	return (offset + TEXTURE_CONTAINER_ALIGNMENT - 1) & ~(TEXTURE_CONTAINER_ALIGNMENT - 1);
+}
+
+std::string TextureContainer::GetContainerPath(const std::string& sourcePath)
+{
+	const size_t directoryEnd = sourcePath.find_last_of("/\\");
+	const size_t extensionStart = sourcePath.find_last_of('.');
+	if (extensionStart == std::string::npos || (directoryEnd != std::string::npos && extensionStart < directoryEnd))
+	{
+		return sourcePath + ".swtex";
+	}
+	return sourcePath.substr(0, extensionStart) + ".swtex";
+}
+
+bool TextureContainer::IsUpToDate(const std::string& sourcePath, const std::string& containerPath)
+{
+	std::error_code error;
+	const std::filesystem::file_time_type containerTime = std::filesystem::last_write_time(containerPath, error);
+	if (error)
+	{
+		return false;
+	}
+	const std::filesystem::file_time_type sourceTime = std::filesystem::last_write_time(sourcePath, error);
+	return error || sourceTime <= containerTime;
+}
+
+uint32_t TextureContainer::GetFormatChannels(uint32_t format)
+{
+	switch (format)
+	{
+	case TEXTURE_FORMAT_R8: return 1;
+	case TEXTURE_FORMAT_RG8: return 2;
+	case TEXTURE_FORMAT_RGB8: return 3;
+	case TEXTURE_FORMAT_RGBA8: return 4;
+	case TEXTURE_FORMAT_BC1: return 3;
+	case TEXTURE_FORMAT_BC4: return 1;
+	case TEXTURE_FORMAT_BC5: return 2;
+	default: return 0;
+	}
+}
+
+bool TextureContainer::IsCompressedFormat(uint32_t format)
+{
+	return format == TEXTURE_FORMAT_BC1 || format == TEXTURE_FORMAT_BC4 || format == TEXTURE_FORMAT_BC5;
+}
+
+size_t TextureContainer::GetImageSize(uint32_t format, uint32_t width, uint32_t height)
+{
+	if (IsCompressedFormat(format))
+	{
+		const size_t blockSize = format == TEXTURE_FORMAT_BC5 ? 16 : 8;
+		return size_t((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+	}
+	return size_t(width) * height * GetFormatChannels(format);
+}
+
+bool TextureContainer::Write(const std::string& path, uint32_t format, uint32_t flags, const std::vector<TextureMip>& mips)
+{
+	if (mips.empty() || format >= TEXTURE_FORMAT_COUNT)
+	{
+		return false;
+	}
+
+	TextureContainerFileHeader header = {};
+	header.magic = TEXTURE_CONTAINER_MAGIC;
+	header.version = TEXTURE_CONTAINER_VERSION;
+	header.format = format;
+	header.flags = flags;
+	header.width = mips[0].width;
+	header.height = mips[0].height;
+	header.mipCount = static_cast<uint32_t>(mips.size());
+
+	// lay out the mips after the header and the mip table, largest first
+	std::vector<TextureContainerFileMip> table(mips.size());
+	uint64_t offset = sizeof(TextureContainerFileHeader) + sizeof(TextureContainerFileMip) * mips.size();
+	for (size_t n = 0; n < mips.size(); ++n)
+	{
+		if (mips[n].size != GetImageSize(format, mips[n].width, mips[n].height))
+		{
+			std::cout << "ERROR::TEXTURE_CONTAINER::INVALID_MIP_SIZE " << path << " level " << n << std::endl;
+			return false;
+		}
+
+		offset = AlignContainerOffset(offset);
+		table[n].offset = offset;
+		table[n].size = mips[n].size;
+		table[n].width = mips[n].width;
+		table[n].height = mips[n].height;
+		offset += mips[n].size;
+	}
+
+	const std::string temporaryPath = path + ".tmp";
+	{
+		std::ofstream containerFile(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!containerFile)
+		{
+			std::cout << "ERROR::TEXTURE_CONTAINER::CAN_NOT_CREATE_FILE " << temporaryPath << std::endl;
+			return false;
+		}
+
+		containerFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		containerFile.write(reinterpret_cast<const char*>(table.data()), sizeof(TextureContainerFileMip) * table.size());
+
+		const char padding[TEXTURE_CONTAINER_ALIGNMENT] = {};
+		for (size_t n = 0; n < mips.size(); ++n)
+		{
+			const uint64_t position = static_cast<uint64_t>(containerFile.tellp());
+			containerFile.write(padding, static_cast<std::streamsize>(table[n].offset - position));
+			containerFile.write(static_cast<const char*>(mips[n].data), static_cast<std::streamsize>(mips[n].size));
+		}
+
+		if (!containerFile)
+		{
+			std::cout << "ERROR::TEXTURE_CONTAINER::WRITE_FAILED " << temporaryPath << std::endl;
+			containerFile.close();
+			std::remove(temporaryPath.c_str());
+			return false;
+		}
+	}
+
+	// std::rename doesn't replace existing files on every platform
+	std::remove(path.c_str());
+	if (std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+	{
+		std::remove(temporaryPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool TextureContainer::Open(const std::string& path)
+{
+	Close();
+
+	if (!file.Open(path))
+	{
+		return false;
+	}
+
+	const unsigned char* data = file.GetData();
+	const size_t size = file.GetSize();
+	if (size < sizeof(TextureContainerFileHeader))
+	{
+		Close();
+		return false;
+	}
+
+	const TextureContainerFileHeader* header = reinterpret_cast<const TextureContainerFileHeader*>(data);
+	const bool isValid =
+		header->magic == TEXTURE_CONTAINER_MAGIC &&
+		header->version == TEXTURE_CONTAINER_VERSION &&
+		header->format < TEXTURE_FORMAT_COUNT &&
+		header->mipCount > 0 &&
+		sizeof(TextureContainerFileHeader) + sizeof(TextureContainerFileMip) * uint64_t(header->mipCount) <= size;
+	if (!isValid)
+	{
+		Close();
+		return false;
+	}
+
+	// make sure no mip points outside of the file or disagrees with its dimensions
+	const TextureContainerFileMip* table = reinterpret_cast<const TextureContainerFileMip*>(data + sizeof(TextureContainerFileHeader));
+	for (uint32_t n = 0; n < header->mipCount; ++n)
+	{
+		if (table[n].offset > size || table[n].size > size - table[n].offset ||
+			table[n].size != GetImageSize(header->format, table[n].width, table[n].height))
+		{
+			Close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void TextureContainer::Close()
+{
+	file.Close();
+}
+
+uint32_t TextureContainer::GetFormat() const
+{
+	return IsOpen() ? reinterpret_cast<const TextureContainerFileHeader*>(file.GetData())->format : TEXTURE_FORMAT_COUNT;
+}
+
+uint32_t TextureContainer::GetFlags() const
+{
+	return IsOpen() ? reinterpret_cast<const TextureContainerFileHeader*>(file.GetData())->flags : TEXTURE_CONTAINER_NONE;
+}
+
+uint32_t TextureContainer::GetMipCount() const
+{
+	return IsOpen() ? reinterpret_cast<const TextureContainerFileHeader*>(file.GetData())->mipCount : 0;
+}
+
+TextureMip TextureContainer::GetMip(uint32_t level) const
+{
+	TextureMip mip;
+	if (level >= GetMipCount())
+	{
+		return mip;
+	}
+
+	const unsigned char* data = file.GetData();
+	const TextureContainerFileMip& entry = reinterpret_cast<const TextureContainerFileMip*>(data + sizeof(TextureContainerFileHeader))[level];
+	mip.width = entry.width;
+	mip.height = entry.height;
+	mip.data = data + entry.offset;
+	mip.size = static_cast<size_t>(entry.size);
+	return mip;
+}
+
+void TextureContainer::Prefetch() const
+{
+	const volatile unsigned char* data = file.GetData();
+	unsigned char sum = 0;
+	for (size_t offset = 0; offset < file.GetSize(); offset += TEXTURE_CONTAINER_PAGE_SIZE)
+	{
+		sum += data[offset];
+	}
+	(void)sum;
+}
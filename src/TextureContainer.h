@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+// Pixel format of the payload of a texture container
+enum TextureContainerFormat : uint32_t
+{
+	TEXTURE_FORMAT_R8 = 0,
+	TEXTURE_FORMAT_RG8,
+	TEXTURE_FORMAT_RGB8,
+	TEXTURE_FORMAT_RGBA8,
+	// 4x4 texel blocks, see BlockCompressor
+	TEXTURE_FORMAT_BC1,	// rgb, 8 bytes per block
+	TEXTURE_FORMAT_BC4,	// r, 8 bytes per block
+	TEXTURE_FORMAT_BC5,	// rg, 16 bytes per block
+	TEXTURE_FORMAT_COUNT,
+};
+
+enum TextureContainerFlags : uint32_t
+{
+	TEXTURE_CONTAINER_NONE = 0,
+	// color data, filtered in linear space when the mips are built
+	TEXTURE_CONTAINER_SRGB = 1,
+	// tangent space normals remapped to [0, 1]
+	TEXTURE_CONTAINER_NORMAL_MAP = 2,
+	// packed material texture, channels holding a map (see TextureLoader::GetPackedChannel)
+	TEXTURE_CONTAINER_PACKED_OCCLUSION = 4,
+	TEXTURE_CONTAINER_PACKED_ROUGHNESS = 8,
+	TEXTURE_CONTAINER_PACKED_DISPLACEMENT = 16,
+};
+
+// One mip level, rows (of blocks for the compressed formats) tightly packed
+struct TextureMip
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	const void* data = nullptr;
+	size_t size = 0;
+};
+
+// Cooked texture file (.swtex): a header, a mip table and the payload of every mip, ready to upload without decoding.
+// Written by the TextureCooker tool, read through a memory mapping.
+class TextureContainer
+{
+public:
+	// <directory>/<stem>.swtex next to the source image
+	static std::string GetContainerPath(const std::string& sourcePath);
+	// False when containerPath is missing or older than sourcePath. A missing source counts as up to date.
+	static bool IsUpToDate(const std::string& sourcePath, const std::string& containerPath);
+
+	// Channels of a texel, once decoded for the block compressed formats
+	static uint32_t GetFormatChannels(uint32_t format);
+	static bool IsCompressedFormat(uint32_t format);
+	// Size in bytes of a width x height image in format, partial blocks count as whole ones
+	static size_t GetImageSize(uint32_t format, uint32_t width, uint32_t height);
+
+	// mips[0] is the full resolution image, each next one half the size of the previous one (rounded down, at least 1).
+	// The file is written next to the destination then renamed, so readers never see a partial file.
+	static bool Write(const std::string& path, uint32_t format, uint32_t flags, const std::vector<TextureMip>& mips);
+
+	// Fails when the file is missing, was written by another version or is truncated
+	bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const { return file.IsOpen(); }
+	uint32_t GetFormat() const;
+	uint32_t GetFlags() const;
+	uint32_t GetMipCount() const;
+	// Points into the mapping, valid until Close()
+	TextureMip GetMip(uint32_t level) const;
+	size_t GetFileSize() const { return file.GetSize(); }
+
+	// Reads one byte of every page so that uploads from the mapping don't stall on page faults.
+	// Meant to run on a worker thread before handing the container to the GL thread.
+	void Prefetch() const;
+
+private:
+	MappedFile file;
+};
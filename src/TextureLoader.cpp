@@ -0,0 +1,646 @@
+#include "TextureLoader.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include <glad/glad.h>
+
+// http://stackoverflow.com/questions/24088002/stb-image-h-in-visual-studio-unresolved-external-symbol
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include "BlockCompressor.h"
+#include "MappedFile.h"
+#include "PngDecoder.h"
+#include "ThreadPool.h"
+
+// file name suffix of every MaterialTextureSlot
+const char* const MATERIAL_TEXTURE_SUFFIXES[MATERIAL_TEXTURE_SLOT_COUNT] =
+{
+	"_Color.png",
+	"_Normal.png",
+	"_Roughness.png",
+	"_AmbientOcclusion.png",
+	"_Displacement.png",
+};
+
+// GL format of 8 bit images with 1 to 4 channels
+const GLenum TEXTURE_UPLOAD_FORMATS[4] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+const GLint TEXTURE_UPLOAD_INTERNAL_FORMATS[4] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+
+// EXT_texture_compression_s3tc, not part of the core profile glad was generated for
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+GLenum GetBlockInternalFormat(uint32_t format)
+{
+	switch (format)
+	{
+	case TEXTURE_FORMAT_BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case TEXTURE_FORMAT_BC4: return GL_COMPRESSED_RED_RGTC1;
+	case TEXTURE_FORMAT_BC5: return GL_COMPRESSED_RG_RGTC2;
+	default: return 0;
+	}
+}
+
+bool TextureLoader::IsBlockFormatSupported(uint32_t format)
+{
+	// RGTC (BC4 / BC5) is core since GL 3.0, S3TC (BC1) is an extension every desktop driver exposes
+	if (format != TEXTURE_FORMAT_BC1)
+	{
+		return true;
+	}
+
+	static int isS3tcSupported = -1;
+	if (isS3tcSupported < 0)
+	{
+		isS3tcSupported = 0;
+		GLint extensionCount = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+		for (GLint n = 0; n < extensionCount; ++n)
+		{
+			const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(n)));
+			if (extension != nullptr && std::string(extension) == "GL_EXT_texture_compression_s3tc")
+			{
+				isS3tcSupported = 1;
+				break;
+			}
+		}
+	}
+	return isS3tcSupported == 1;
+}
+
+void TextureLoader::GetUploadFormats(uint32_t format, unsigned int& internalFormat, unsigned int& pixelFormat)
+{
+	if (TextureContainer::IsCompressedFormat(format))
+	{
+		internalFormat = GetBlockInternalFormat(format);
+		pixelFormat = 0;
+		return;
+	}
+
+	const uint32_t channels = TextureContainer::GetFormatChannels(format);
+	internalFormat = static_cast<unsigned int>(TEXTURE_UPLOAD_INTERNAL_FORMATS[channels - 1]);
+	pixelFormat = TEXTURE_UPLOAD_FORMATS[channels - 1];
+}
+
+StreamedTextureData TextureLoader::GetStreamedData(const DecodedImage& image)
+{
+	StreamedTextureData data;
+	if (!image.pixels || image.channels < 1 || image.channels > 4)
+	{
+		return data;
+	}
+
+	data.format = TEXTURE_FORMAT_R8 + static_cast<uint32_t>(image.channels) - 1;
+	TextureMip level;
+	level.width = static_cast<uint32_t>(image.width);
+	level.height = static_cast<uint32_t>(image.height);
+	level.data = image.pixels.get();
+	level.size = TextureContainer::GetImageSize(data.format, level.width, level.height);
+	data.mips.push_back(level);
+	if (image.mips)
+	{
+		for (const MipLevel& mip : *image.mips)
+		{
+			level.width = mip.width;
+			level.height = mip.height;
+			level.data = mip.pixels.data();
+			level.size = mip.pixels.size();
+			data.mips.push_back(level);
+		}
+	}
+	data.owner = std::make_shared<DecodedImage>(image);
+	return data;
+}
+
+StreamedTextureData TextureLoader::GetStreamedData(const std::shared_ptr<const TextureContainer>& container)
+{
+	StreamedTextureData data;
+	if (!container || !container->IsOpen())
+	{
+		return data;
+	}
+
+	data.format = container->GetFormat();
+	for (uint32_t level = 0; level < container->GetMipCount(); ++level)
+	{
+		data.mips.push_back(container->GetMip(level));
+	}
+	data.owner = container;
+	return data;
+}
+
+DecodedImage TextureLoader::DecodeImage(const std::string& path, int desiredChannels, bool flipVertically)
+{
+	DecodedImage image;
+	MappedFile file;
+	const bool isPng = path.size() > 4 && path.compare(path.size() - 4, 4, ".png") == 0;
+	if (isPng && file.Open(path))
+	{
+		PngImage png;
+		if (PngDecoder::Decode(file.GetData(), file.GetSize(), desiredChannels, flipVertically, png))
+		{
+			image.width = png.width;
+			image.height = png.height;
+			image.channels = png.channels;
+			image.pixels = std::shared_ptr<unsigned char>(png.pixels.release(), std::default_delete<unsigned char[]>());
+			return image;
+		}
+	}
+
+	// the other formats, and the pngs PngDecoder leaves to stb_image
+	stbi_set_flip_vertically_on_load_thread(flipVertically);
+	int channelsInFile = 0;
+	unsigned char* pixels = file.IsOpen()
+		? stbi_load_from_memory(file.GetData(), static_cast<int>(file.GetSize()), &image.width, &image.height, &channelsInFile, desiredChannels)
+		: stbi_load(path.c_str(), &image.width, &image.height, &channelsInFile, desiredChannels);
+	if (pixels == nullptr)
+	{
+		std::cout << "failed to load texture: " << path << " (" << stbi_failure_reason() << ")" << std::endl;
+		return DecodedImage();
+	}
+
+	image.channels = desiredChannels != 0 ? desiredChannels : channelsInFile;
+	image.pixels = std::shared_ptr<unsigned char>(pixels, stbi_image_free);
+	return image;
+}
+
+std::vector<DecodedImage> TextureLoader::DecodeImages(const std::vector<std::string>& paths, const std::vector<int>& desiredChannels, bool flipVertically)
+{
+	std::vector<DecodedImage> images(paths.size());
+	ThreadPool::GetShared().ParallelFor(paths.size(), [&](size_t n)
+	{
+		images[n] = DecodeImage(paths[n], desiredChannels[n], flipVertically);
+	});
+	return images;
+}
+
+void TextureLoader::GenerateMips(DecodedImage& image, MipGenerationMode mode)
+{
+	if (!image.pixels)
+	{
+		return;
+	}
+
+	image.mips = std::make_shared<std::vector<MipLevel>>(MipGenerator::GenerateMipChain(image.pixels.get(),
+		static_cast<uint32_t>(image.width), static_cast<uint32_t>(image.height), static_cast<uint32_t>(image.channels), mode));
+}
+
+const unsigned char* TextureLoader::GetDecodedImageLevel(const DecodedImage& image, uint32_t level, uint32_t& width, uint32_t& height)
+{
+	if (level == 0)
+	{
+		width = static_cast<uint32_t>(image.width);
+		height = static_cast<uint32_t>(image.height);
+		return image.pixels.get();
+	}
+	const MipLevel& mip = (*image.mips)[level - 1];
+	width = mip.width;
+	height = mip.height;
+	return mip.pixels.data();
+}
+
+AssetLoader::UploadStep TextureLoader::CreateUploadStep(const DecodedImage& image, unsigned int& texture, size_t sliceBytes,
+	PixelUploadRing* uploadRing)
+{
+	if (!image.pixels || image.channels < 1 || image.channels > 4)
+	{
+		return nullptr;
+	}
+
+	const GLenum format = TEXTURE_UPLOAD_FORMATS[image.channels - 1];
+	const GLint internalFormat = TEXTURE_UPLOAD_INTERNAL_FORMATS[image.channels - 1];
+	const uint32_t mipCount = image.mips ? static_cast<uint32_t>(image.mips->size()) + 1 : 1;
+
+	// stb_image rows are tightly packed. The bands are staged here, on the worker that decoded the image, the step only
+	// issues the uploads reading them.
+	std::shared_ptr<std::vector<PixelUploadBand>> bands = std::make_shared<std::vector<PixelUploadBand>>();
+	for (uint32_t level = 0; level < mipCount; ++level)
+	{
+		uint32_t width;
+		uint32_t height;
+		const unsigned char* pixels = GetDecodedImageLevel(image, level, width, height);
+		PixelUploadRing::StageRows(uploadRing, 0, level, pixels, size_t(width) * image.channels, height, sliceBytes, *bands);
+	}
+
+	unsigned int newTexture = 0;
+	size_t nextBand = 0;
+	return [image, format, internalFormat, mipCount, sliceBytes, bands, &texture, newTexture, nextBand]() mutable
+	{
+		if (newTexture == 0)
+		{
+			glGenTextures(1, &newTexture);
+			glBindTexture(GL_TEXTURE_2D, newTexture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(mipCount - 1));
+			for (uint32_t n = 0; n < mipCount; ++n)
+			{
+				uint32_t width;
+				uint32_t height;
+				GetDecodedImageLevel(image, n, width, height);
+				glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(n), internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+			}
+		}
+		else
+		{
+			glBindTexture(GL_TEXTURE_2D, newTexture);
+		}
+
+		// the small mips are cheap, keep going until sliceBytes worth of rows were uploaded
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		size_t uploadedBytes = 0;
+		while (nextBand < bands->size() && uploadedBytes < sliceBytes)
+		{
+			PixelUploadBand& band = (*bands)[nextBand++];
+			uint32_t width;
+			uint32_t height;
+			GetDecodedImageLevel(image, band.level, width, height);
+			PixelUploadRing::Upload(band.pixels, [&](const void* source)
+			{
+				glTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(band.level), 0, band.firstRow, width, band.rows, format, GL_UNSIGNED_BYTE,
+					source);
+			});
+			uploadedBytes += band.pixels.GetSize();
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+		if (nextBand < bands->size())
+		{
+			return false;
+		}
+
+		glDeleteTextures(1, &texture);
+		texture = newTexture;
+		return true;
+	};
+}
+
+AssetLoader::UploadStep TextureLoader::CreateUploadStep(const std::shared_ptr<const TextureContainer>& container, unsigned int& texture, size_t sliceBytes,
+	PixelUploadRing* uploadRing)
+{
+	if (!container || !container->IsOpen())
+	{
+		return nullptr;
+	}
+
+	const uint32_t containerFormat = container->GetFormat();
+	const bool isCompressed = TextureContainer::IsCompressedFormat(containerFormat);
+	const uint32_t channels = TextureContainer::GetFormatChannels(containerFormat);
+	const GLenum format = TEXTURE_UPLOAD_FORMATS[channels - 1];
+	const GLint internalFormat = TEXTURE_UPLOAD_INTERNAL_FORMATS[channels - 1];
+	const uint32_t mipCount = container->GetMipCount();
+
+	// staged on the calling worker like the decoded images: a compressed mip in one piece (it is already 4 to 8 times smaller
+	// than the raw rows), the others in row bands
+	std::shared_ptr<std::vector<PixelUploadBand>> bands = std::make_shared<std::vector<PixelUploadBand>>();
+	for (uint32_t level = 0; level < mipCount; ++level)
+	{
+		const TextureMip mip = container->GetMip(level);
+		const size_t rowSize = isCompressed ? mip.size : size_t(mip.width) * channels;
+		const uint32_t rowCount = isCompressed ? 1 : mip.height;
+		PixelUploadRing::StageRows(uploadRing, 0, level, static_cast<const unsigned char*>(mip.data), rowSize, rowCount, sliceBytes, *bands);
+	}
+
+	unsigned int newTexture = 0;
+	size_t nextBand = 0;
+	bool isDecompressing = false;
+	std::shared_ptr<std::vector<std::vector<unsigned char>>> decompressedMips;
+	return [container, containerFormat, isCompressed, format, internalFormat, channels, mipCount, sliceBytes, bands, &texture,
+		newTexture, nextBand, isDecompressing, decompressedMips]() mutable
+	{
+		if (newTexture == 0)
+		{
+			isDecompressing = isCompressed && !IsBlockFormatSupported(containerFormat);
+			if (isDecompressing)
+			{
+				// only the GL thread can tell, the staged blocks go back to the ring and the decompressed rows are uploaded from
+				// client memory
+				decompressedMips = std::make_shared<std::vector<std::vector<unsigned char>>>();
+				bands = std::make_shared<std::vector<PixelUploadBand>>();
+				for (uint32_t level = 0; level < mipCount; ++level)
+				{
+					const TextureMip mip = container->GetMip(level);
+					decompressedMips->push_back(BlockCompressor::Decompress(containerFormat, static_cast<const unsigned char*>(mip.data),
+						mip.width, mip.height));
+					PixelUploadRing::StageRows(nullptr, 0, level, decompressedMips->back().data(), size_t(mip.width) * channels, mip.height,
+						sliceBytes, *bands);
+				}
+			}
+
+			glGenTextures(1, &newTexture);
+			glBindTexture(GL_TEXTURE_2D, newTexture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(mipCount - 1));
+			// compressed mips are allocated by glCompressedTexImage2D, the others are filled in row bands
+			if (!isCompressed || isDecompressing)
+			{
+				for (uint32_t n = 0; n < mipCount; ++n)
+				{
+					const TextureMip mip = container->GetMip(n);
+					glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(n), internalFormat, mip.width, mip.height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+				}
+			}
+		}
+		else
+		{
+			glBindTexture(GL_TEXTURE_2D, newTexture);
+		}
+
+		// the small mips are cheap, keep going through them until sliceBytes worth of data was uploaded
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		size_t uploadedBytes = 0;
+		while (nextBand < bands->size() && uploadedBytes < sliceBytes)
+		{
+			PixelUploadBand& band = (*bands)[nextBand++];
+			const TextureMip mip = container->GetMip(band.level);
+			PixelUploadRing::Upload(band.pixels, [&](const void* source)
+			{
+				if (isCompressed && !isDecompressing)
+				{
+					glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(band.level), GetBlockInternalFormat(containerFormat),
+						mip.width, mip.height, 0, static_cast<GLsizei>(mip.size), source);
+					return;
+				}
+				glTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(band.level), 0, band.firstRow, mip.width, band.rows, format,
+					GL_UNSIGNED_BYTE, source);
+			});
+			uploadedBytes += band.pixels.GetSize();
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+		if (nextBand < bands->size())
+		{
+			return false;
+		}
+
+		glDeleteTextures(1, &texture);
+		texture = newTexture;
+		return true;
+	};
+}
+
+std::string TextureLoader::GetMaterialTexturePath(const std::string& setPath, MaterialTextureSlot slot)
+{
+	return setPath + MATERIAL_TEXTURE_SUFFIXES[slot];
+}
+
+int TextureLoader::GetMaterialTextureChannels(MaterialTextureSlot slot)
+{
+	return (slot == MATERIAL_TEXTURE_ALBEDO || slot == MATERIAL_TEXTURE_NORMAL) ? 3 : 1;
+}
+
+MipGenerationMode TextureLoader::GetMaterialTextureMipMode(MaterialTextureSlot slot)
+{
+	switch (slot)
+	{
+	case MATERIAL_TEXTURE_ALBEDO: return MIP_GENERATION_SRGB;
+	case MATERIAL_TEXTURE_NORMAL: return MIP_GENERATION_NORMAL_MAP;
+	default: return MIP_GENERATION_LINEAR;
+	}
+}
+
+bool TextureLoader::GetMaterialTextureSlot(const std::string& path, MaterialTextureSlot& slot)
+{
+	for (uint32_t n = 0; n < MATERIAL_TEXTURE_SLOT_COUNT; ++n)
+	{
+		const std::string suffix = MATERIAL_TEXTURE_SUFFIXES[n];
+		if (path.size() >= suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0)
+		{
+			slot = static_cast<MaterialTextureSlot>(n);
+			return true;
+		}
+	}
+	return false;
+}
+
+int TextureLoader::GetPackedChannel(MaterialTextureSlot slot)
+{
+	switch (slot)
+	{
+	case MATERIAL_TEXTURE_AMBIENT_OCCLUSION: return 0;
+	case MATERIAL_TEXTURE_ROUGHNESS: return 1;
+	case MATERIAL_TEXTURE_DISPLACEMENT: return 2;
+	default: return -1;
+	}
+}
+
+std::string TextureLoader::GetPackedContainerPath(const std::string& setPath)
+{
+	return setPath + "_Packed.swtex";
+}
+
+uint32_t TextureLoader::GetPackedContainerFlags(const MaterialDescriptor& descriptor)
+{
+	uint32_t flags = TEXTURE_CONTAINER_NONE;
+	flags |= descriptor.occlusionChannel >= 0 ? static_cast<uint32_t>(TEXTURE_CONTAINER_PACKED_OCCLUSION) : 0u;
+	flags |= descriptor.roughnessChannel >= 0 ? static_cast<uint32_t>(TEXTURE_CONTAINER_PACKED_ROUGHNESS) : 0u;
+	flags |= descriptor.displacementChannel >= 0 ? static_cast<uint32_t>(TEXTURE_CONTAINER_PACKED_DISPLACEMENT) : 0u;
+	return flags;
+}
+
+MaterialDescriptor TextureLoader::GetPackedDescriptor(uint32_t containerFlags)
+{
+	MaterialDescriptor descriptor;
+	if (containerFlags & TEXTURE_CONTAINER_PACKED_OCCLUSION)
+	{
+		descriptor.occlusionChannel = GetPackedChannel(MATERIAL_TEXTURE_AMBIENT_OCCLUSION);
+	}
+	if (containerFlags & TEXTURE_CONTAINER_PACKED_ROUGHNESS)
+	{
+		descriptor.roughnessChannel = GetPackedChannel(MATERIAL_TEXTURE_ROUGHNESS);
+	}
+	if (containerFlags & TEXTURE_CONTAINER_PACKED_DISPLACEMENT)
+	{
+		descriptor.displacementChannel = GetPackedChannel(MATERIAL_TEXTURE_DISPLACEMENT);
+	}
+	return descriptor;
+}
+
+DecodedImage TextureLoader::PackMaterialMaps(const DecodedImage* maps, MaterialDescriptor& descriptor)
+{
+	descriptor = MaterialDescriptor();
+
+	DecodedImage packed;
+	packed.channels = 3;
+	for (uint32_t slot = 0; slot < MATERIAL_TEXTURE_SLOT_COUNT; ++slot)
+	{
+		const int channel = GetPackedChannel(static_cast<MaterialTextureSlot>(slot));
+		const DecodedImage& map = maps[slot];
+		if (channel < 0 || !map.pixels)
+		{
+			continue;
+		}
+
+		if (!packed.pixels)
+		{
+			packed.width = map.width;
+			packed.height = map.height;
+			const size_t packedSize = size_t(packed.width) * packed.height * packed.channels;
+			packed.pixels = std::shared_ptr<unsigned char>(new unsigned char[packedSize](), std::default_delete<unsigned char[]>());
+		}
+		else if (map.width != packed.width || map.height != packed.height)
+		{
+			std::cout << "ERROR::TEXTURE_LOADER::PACKED_MAP_SIZE_MISMATCH " << GetMaterialTexturePath("", static_cast<MaterialTextureSlot>(slot))
+				<< " is " << map.width << "x" << map.height << " instead of " << packed.width << "x" << packed.height << std::endl;
+			continue;
+		}
+
+		// only the first channel of the map is used
+		const size_t texelCount = size_t(packed.width) * packed.height;
+		for (size_t n = 0; n < texelCount; ++n)
+		{
+			packed.pixels.get()[n * packed.channels + channel] = map.pixels.get()[n * map.channels];
+		}
+
+		switch (slot)
+		{
+		case MATERIAL_TEXTURE_AMBIENT_OCCLUSION: descriptor.occlusionChannel = channel; break;
+		case MATERIAL_TEXTURE_ROUGHNESS: descriptor.roughnessChannel = channel; break;
+		case MATERIAL_TEXTURE_DISPLACEMENT: descriptor.displacementChannel = channel; break;
+		default: break;
+		}
+	}
+
+	if (!packed.pixels)
+	{
+		return DecodedImage();
+	}
+	return packed;
+}
+
+MaterialTextureData TextureLoader::LoadMaterialTextureData(const std::string& setPath, uint32_t bindingMask)
+{
+	// cooked textures only need their pages faulted in, the maps of the others are decoded together
+	MaterialTextureData data;
+	std::vector<std::string> paths;
+	std::vector<int> channels;
+	std::vector<uint32_t> decodedSlots;
+	for (uint32_t binding = 0; binding < MATERIAL_BINDING_COUNT; ++binding)
+	{
+		if (!(bindingMask & (1u << binding)))
+		{
+			continue;
+		}
+
+		// maps the texture is made of, the albedo and normal bindings have the number of their slot
+		std::vector<MaterialTextureSlot> slots;
+		for (uint32_t slot = 0; slot < MATERIAL_TEXTURE_SLOT_COUNT; ++slot)
+		{
+			const bool isPacked = GetPackedChannel(static_cast<MaterialTextureSlot>(slot)) >= 0;
+			if (binding == MATERIAL_BINDING_PACKED ? isPacked : slot == binding)
+			{
+				slots.push_back(static_cast<MaterialTextureSlot>(slot));
+			}
+		}
+
+		const std::string containerPath = binding == MATERIAL_BINDING_PACKED ?
+			GetPackedContainerPath(setPath) : TextureContainer::GetContainerPath(GetMaterialTexturePath(setPath, slots[0]));
+		bool isUpToDate = true;
+		for (MaterialTextureSlot slot : slots)
+		{
+			isUpToDate = isUpToDate && TextureContainer::IsUpToDate(GetMaterialTexturePath(setPath, slot), containerPath);
+		}
+
+		std::shared_ptr<TextureContainer> container = std::make_shared<TextureContainer>();
+		if (isUpToDate && container->Open(containerPath))
+		{
+			container->Prefetch();
+			data.containers[binding] = container;
+			continue;
+		}
+
+		for (MaterialTextureSlot slot : slots)
+		{
+			paths.push_back(GetMaterialTexturePath(setPath, slot));
+			channels.push_back(GetMaterialTextureChannels(slot));
+			decodedSlots.push_back(slot);
+		}
+	}
+
+	const std::vector<DecodedImage> decodedImages = DecodeImages(paths, channels);
+	std::vector<DecodedImage> maps(MATERIAL_TEXTURE_SLOT_COUNT);
+	for (size_t n = 0; n < decodedSlots.size(); ++n)
+	{
+		maps[decodedSlots[n]] = decodedImages[n];
+	}
+
+	// the packed texture replaces the separate maps
+	data.images[MATERIAL_BINDING_ALBEDO] = maps[MATERIAL_TEXTURE_ALBEDO];
+	data.images[MATERIAL_BINDING_NORMAL] = maps[MATERIAL_TEXTURE_NORMAL];
+	if (data.containers[MATERIAL_BINDING_PACKED])
+	{
+		data.descriptor = GetPackedDescriptor(data.containers[MATERIAL_BINDING_PACKED]->GetFlags());
+	}
+	else if (bindingMask & (1u << MATERIAL_BINDING_PACKED))
+	{
+		data.images[MATERIAL_BINDING_PACKED] = PackMaterialMaps(maps.data(), data.descriptor);
+	}
+
+	GenerateMips(data.images[MATERIAL_BINDING_ALBEDO], GetMaterialTextureMipMode(MATERIAL_TEXTURE_ALBEDO));
+	GenerateMips(data.images[MATERIAL_BINDING_NORMAL], GetMaterialTextureMipMode(MATERIAL_TEXTURE_NORMAL));
+	GenerateMips(data.images[MATERIAL_BINDING_PACKED], MIP_GENERATION_LINEAR);
+	return data;
+}
+
+AssetLoader::UploadStep TextureLoader::CreateMaterialUploadStep(const MaterialTextureData& data, uint32_t binding, unsigned int& texture,
+	size_t sliceBytes, TextureStreamer* streamer, PixelUploadRing* uploadRing)
+{
+	const std::shared_ptr<const TextureContainer> container = data.containers[binding];
+	if (!streamer)
+	{
+		return container ? CreateUploadStep(container, texture, sliceBytes, uploadRing) :
+			CreateUploadStep(data.images[binding], texture, sliceBytes, uploadRing);
+	}
+
+	// only the mip tail is uploaded right away, the streamer brings the other levels in over the next frames
+	const StreamedTextureData streamedData = container ? GetStreamedData(container) : GetStreamedData(data.images[binding]);
+	if (streamedData.mips.empty())
+	{
+		return nullptr;
+	}
+	return [streamer, streamedData, &texture]()
+	{
+		streamer->Add(streamedData, texture);
+		return true;
+	};
+}
+
+void TextureLoader::LoadMaterialTextures(AssetLoader& assetLoader, const std::string& setPath, unsigned int* textures,
+	MaterialDescriptor& descriptor, size_t sliceBytes, TextureStreamer* streamer, PixelUploadRing* uploadRing)
+{
+	assetLoader.Load([setPath, textures, &descriptor, sliceBytes, streamer, uploadRing]() -> AssetLoader::UploadStep
+	{
+		const MaterialTextureData data = LoadMaterialTextureData(setPath);
+
+		std::vector<AssetLoader::UploadStep> uploads;
+		for (uint32_t binding = 0; binding < MATERIAL_BINDING_COUNT; ++binding)
+		{
+			AssetLoader::UploadStep upload = CreateMaterialUploadStep(data, binding, textures[binding], sliceBytes, streamer, uploadRing);
+			if (!upload)
+			{
+				continue;
+			}
+
+			uploads.push_back(upload);
+			if (binding == MATERIAL_BINDING_PACKED)
+			{
+				// the shader only reads the new channels once the packed texture holding them is bound
+				const MaterialDescriptor packedDescriptor = data.descriptor;
+				uploads.push_back([&descriptor, packedDescriptor]()
+				{
+					descriptor = packedDescriptor;
+					return true;
+				});
+			}
+		}
+		return AssetLoader::Sequence(uploads);
+	});
+}
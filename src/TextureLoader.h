@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AssetLoader.h"
+#include "MipGenerator.h"
+#include "PixelUploadRing.h"
+#include "TextureContainer.h"
+#include "TextureStreamer.h"
+
+// Maps of a material texture set, as shipped in res/textures (<set>_Color.png, <set>_Normal.png, ...)
+enum MaterialTextureSlot : uint32_t
+{
+	MATERIAL_TEXTURE_ALBEDO = 0,
+	MATERIAL_TEXTURE_NORMAL,
+	MATERIAL_TEXTURE_ROUGHNESS,
+	MATERIAL_TEXTURE_AMBIENT_OCCLUSION,
+	MATERIAL_TEXTURE_DISPLACEMENT,
+	MATERIAL_TEXTURE_SLOT_COUNT,
+};
+
+// Textures of a loaded material, also their texture unit. Ambient occlusion, roughness and displacement
+// share the packed texture, one channel each.
+enum MaterialTextureBinding : uint32_t
+{
+	MATERIAL_BINDING_ALBEDO = 0,
+	MATERIAL_BINDING_NORMAL,
+	MATERIAL_BINDING_PACKED,
+	MATERIAL_BINDING_COUNT,
+};
+
+// Channel of the packed texture holding each map, -1 when the set doesn't have it and shader.fs uses a default instead
+struct MaterialDescriptor
+{
+	int occlusionChannel = -1;
+	int roughnessChannel = -1;
+	int displacementChannel = -1;
+};
+
+// Decoded 8 bit image, rows tightly packed
+struct DecodedImage
+{
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	std::shared_ptr<unsigned char> pixels;	// null when the decoding failed
+	std::shared_ptr<std::vector<MipLevel>> mips;	// levels 1 and below, null until GenerateMips
+};
+
+// Textures of a material set as loaded by the workers, see TextureLoader::LoadMaterialTextureData
+struct MaterialTextureData
+{
+	// by MaterialTextureBinding: the cooked container when it is up to date, otherwise the decoded image with its mips
+	std::shared_ptr<TextureContainer> containers[MATERIAL_BINDING_COUNT];
+	DecodedImage images[MATERIAL_BINDING_COUNT];
+	// channels of the packed texture, when it was loaded
+	MaterialDescriptor descriptor;
+};
+
+// Texture decoding on the worker threads and upload on the GL thread, built on AssetLoader
+class TextureLoader
+{
+public:
+	// Thread safe. stb_image keeps the vertical flip in a global, DecodeImage uses its per thread replacement
+	// and sets it on every call, so concurrent decodes with different flips don't affect each other.
+	static DecodedImage DecodeImage(const std::string& path, int desiredChannels, bool flipVertically = false);
+
+	// Decodes all the images concurrently on the shared ThreadPool, the calling thread takes part
+	static std::vector<DecodedImage> DecodeImages(const std::vector<std::string>& paths, const std::vector<int>& desiredChannels, bool flipVertically = false);
+
+	// Fills image.mips with the full chain, filtered according to mode
+	static void GenerateMips(DecodedImage& image, MipGenerationMode mode);
+	// Pixels and size of level of image, level 0 is the image itself
+	static const unsigned char* GetDecodedImageLevel(const DecodedImage& image, uint32_t level, uint32_t& width, uint32_t& height);
+
+	// Upload step creating a texture from image and its mips (trilinear filtering when it has some), sliceBytes worth of rows
+	// per call. Once complete the new texture replaces texture (the previous one is deleted), so whatever texture held
+	// until then stays in use meanwhile.
+	// With an uploadRing the rows are copied to it by the calling thread (the worker that decoded image) and the step only
+	// issues the uploads reading them, the rows that didn't fit are uploaded from image.
+	static AssetLoader::UploadStep CreateUploadStep(const DecodedImage& image, unsigned int& texture, size_t sliceBytes,
+		PixelUploadRing* uploadRing = nullptr);
+
+	// Same for a cooked texture: every mip of the container is staged from the mapping (or read from it), largest first,
+	// sliceBytes worth of rows (or whole compressed mips) per call. The container must be open and stays mapped until
+	// the upload is done. Block compressed formats the driver doesn't support are decompressed on the GL thread.
+	static AssetLoader::UploadStep CreateUploadStep(const std::shared_ptr<const TextureContainer>& container, unsigned int& texture, size_t sliceBytes,
+		PixelUploadRing* uploadRing = nullptr);
+
+	// Block compressed formats the driver can sample, the others are decompressed before their upload. GL thread only.
+	static bool IsBlockFormatSupported(uint32_t format);
+	// GL internal format and pixel format of a TextureContainerFormat, the pixel format is 0 for the compressed formats
+	static void GetUploadFormats(uint32_t format, unsigned int& internalFormat, unsigned int& pixelFormat);
+
+	// Levels of image and its mips, or of every mip of the container, for TextureStreamer
+	static StreamedTextureData GetStreamedData(const DecodedImage& image);
+	static StreamedTextureData GetStreamedData(const std::shared_ptr<const TextureContainer>& container);
+
+	static std::string GetMaterialTexturePath(const std::string& setPath, MaterialTextureSlot slot);
+	// 3 channels for the color and normal maps, 1 for the others
+	static int GetMaterialTextureChannels(MaterialTextureSlot slot);
+	// sRGB for the color map, renormalized normals for the normal map, linear for the others
+	static MipGenerationMode GetMaterialTextureMipMode(MaterialTextureSlot slot);
+	// Slot of an image from its file name suffix, false when it isn't a material map
+	static bool GetMaterialTextureSlot(const std::string& path, MaterialTextureSlot& slot);
+
+	// Channel of the packed texture the map of slot goes to (ambient occlusion 0, roughness 1, displacement 2),
+	// -1 for the maps with a texture of their own
+	static int GetPackedChannel(MaterialTextureSlot slot);
+	// <set>_Packed.swtex, the packed texture has no png of its own
+	static std::string GetPackedContainerPath(const std::string& setPath);
+	// The packed channels present in a cooked packed texture are recorded in its TextureContainerFlags
+	static uint32_t GetPackedContainerFlags(const MaterialDescriptor& descriptor);
+	static MaterialDescriptor GetPackedDescriptor(uint32_t containerFlags);
+	// 3 channel image interleaving the packed maps of maps (indexed by MaterialTextureSlot, failed decodes are skipped).
+	// Maps of another size than the first one are skipped, the channels of the missing maps are 0. No pixels when there is no map.
+	static DecodedImage PackMaterialMaps(const DecodedImage* maps, MaterialDescriptor& descriptor);
+
+	// Thread safe. Loads the textures of the texture set at setPath whose bit (1 << MaterialTextureBinding) is set in bindingMask:
+	// cooked textures are mapped, the maps of the others are decoded concurrently, ambient occlusion, roughness and
+	// displacement are packed together and the mips are generated.
+	static MaterialTextureData LoadMaterialTextureData(const std::string& setPath, uint32_t bindingMask = (1u << MATERIAL_BINDING_COUNT) - 1);
+	// Upload step of binding of data into texture (see CreateUploadStep), nullptr when there is nothing to upload.
+	// With a streamer the texture is added to it instead, starting from its mip tail.
+	static AssetLoader::UploadStep CreateMaterialUploadStep(const MaterialTextureData& data, uint32_t binding, unsigned int& texture,
+		size_t sliceBytes, TextureStreamer* streamer = nullptr, PixelUploadRing* uploadRing = nullptr);
+
+	// Decodes every map of the texture set at setPath (e.g. "../res/textures/Tiles093_1K-PNG/Tiles093_1K") concurrently,
+	// packs ambient occlusion, roughness and displacement together, generates the mips, then uploads the
+	// MATERIAL_BINDING_COUNT textures on the GL thread. Textures whose maps all fail to decode keep their current texture.
+	// Textures cooked by the TextureCooker tool are mapped and uploaded with their mips instead.
+	// descriptor is updated on the GL thread once the packed texture is in place.
+	// With a streamer the textures are added to it instead, starting from their mip tail. The uploads go through uploadRing if any.
+	// textures, descriptor, streamer and uploadRing must stay alive until the loads are done.
+	static void LoadMaterialTextures(AssetLoader& assetLoader, const std::string& setPath, unsigned int* textures,
+		MaterialDescriptor& descriptor, size_t sliceBytes, TextureStreamer* streamer = nullptr, PixelUploadRing* uploadRing = nullptr);
+};
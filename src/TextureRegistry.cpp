@@ -0,0 +1,496 @@
+#include "TextureRegistry.h"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include <glad/glad.h>
+
+#include "Hash.h"
+
+// Bytes of the decoded image and its mips, also what their upload takes on the GPU
+size_t GetDecodedImageBytes(const DecodedImage& image)
+{
+	if (!image.pixels)
+	{
+		return 0;
+	}
+
+	size_t bytes = size_t(image.width) * image.height * image.channels;
+	if (image.mips)
+	{
+		for (const MipLevel& mip : *image.mips)
+		{
+			bytes += mip.pixels.size();
+		}
+	}
+	return bytes;
+}
+
+// Bytes of every level of data, also what the texture takes on the GPU once they are all streamed in
+size_t GetStreamedTextureBytes(const StreamedTextureData& data)
+{
+	size_t bytes = 0;
+	for (const TextureMip& mip : data.mips)
+	{
+		bytes += mip.size;
+	}
+	return bytes;
+}
+
+TextureHandle::TextureHandle(TextureRegistry* registry, uint32_t entry)
+	: registry(registry), entry(entry)
+{
+	registry->AddRef(entry);
+}
+
+TextureHandle::TextureHandle(const TextureHandle& other)
+	: registry(other.registry), entry(other.entry)
+{
+	if (registry)
+	{
+		registry->AddRef(entry);
+	}
+}
+
+TextureHandle::TextureHandle(TextureHandle&& other) noexcept
+	: registry(other.registry), entry(other.entry)
+{
+	other.registry = nullptr;
+	other.entry = 0;
+}
+
+TextureHandle& TextureHandle::operator=(const TextureHandle& other)
+{
+	if (this != &other)
+	{
+		// the other handle may reference the same entry, add before releasing
+		if (other.registry)
+		{
+			other.registry->AddRef(other.entry);
+		}
+		Reset();
+		registry = other.registry;
+		entry = other.entry;
+	}
+	return *this;
+}
+
+TextureHandle& TextureHandle::operator=(TextureHandle&& other) noexcept
+{
+	if (this != &other)
+	{
+		Reset();
+		registry = other.registry;
+		entry = other.entry;
+		other.registry = nullptr;
+		other.entry = 0;
+	}
+	return *this;
+}
+
+TextureHandle::~TextureHandle()
+{
+	Reset();
+}
+
+unsigned int TextureHandle::GetTexture() const
+{
+	return registry ? registry->GetTexture(entry) : 0;
+}
+
+void TextureHandle::Reset()
+{
+	if (registry)
+	{
+		registry->Release(entry);
+	}
+	registry = nullptr;
+	entry = 0;
+}
+
+TextureRegistry::TextureRegistry(AssetLoader& assetLoader, size_t budgetBytes, size_t sliceBytes, PixelUploadRing* uploadRing,
+	TextureStreamer* streamer)
+	: assetLoader(assetLoader), budgetBytes(budgetBytes), sliceBytes(sliceBytes), uploadRing(uploadRing), streamer(streamer)
+{
+}
+
+TextureRegistry::~TextureRegistry()
+{
+	// the sharers have no texture of their own
+	for (const auto& entry : entries)
+	{
+		if (entry.second.isStreamed)
+		{
+			streamer->Remove(entry.second.texture);
+		}
+		glDeleteTextures(1, &entry.second.texture);
+	}
+}
+
+TextureHandle TextureRegistry::Acquire(const std::string& path, int channels, MipGenerationMode mipMode)
+{
+	bool isNew;
+	const uint32_t entry = FindOrCreateEntry(GetEntryKey(path, channels, mipMode), isNew);
+	if (!isNew)
+	{
+		return TextureHandle(this, entry);
+	}
+
+	// the entry stays until its upload is done, the worker stages the rows for its texture
+	unsigned int* texture = &entries.at(entry).texture;
+	assetLoader.Load([this, path, channels, mipMode, entry, texture]() -> AssetLoader::UploadStep
+	{
+		// a failed decode still goes through the upload step, which marks the entry as loaded without texture
+		DecodedImage image = TextureLoader::DecodeImage(path, channels);
+		TextureLoader::GenerateMips(image, mipMode);
+		return CreateUploadStep(entry, image, mipMode, GetDecodedImageBytes(image),
+			TextureLoader::CreateUploadStep(image, *texture, sliceBytes, uploadRing));
+	});
+	return TextureHandle(this, entry);
+}
+
+TextureHandle TextureRegistry::AcquireImmediate(const std::string& path, int channels, MipGenerationMode mipMode)
+{
+	bool isNew;
+	const uint32_t entry = FindOrCreateEntry(GetEntryKey(path, channels, mipMode), isNew);
+	if (!isNew)
+	{
+		return TextureHandle(this, entry);
+	}
+
+	DecodedImage image = TextureLoader::DecodeImage(path, channels);
+	TextureLoader::GenerateMips(image, mipMode);
+	// straight from the image without slicing, staging it in the ring on the GL thread would only add a copy
+	AssetLoader::UploadStep upload = CreateUploadStep(entry, image, mipMode, GetDecodedImageBytes(image),
+		TextureLoader::CreateUploadStep(image, entries.at(entry).texture, SIZE_MAX, nullptr));
+	if (!upload())
+	{
+		std::cout << "TEXTURE_REGISTRY::IMMEDIATE_UPLOAD_DEFERRED " << path << std::endl;
+		assetLoader.Load([upload]()
+		{
+			return upload;
+		});
+	}
+	return TextureHandle(this, entry);
+}
+
+void TextureRegistry::AcquireMaterial(const std::string& setPath, TextureHandle* handles, MaterialDescriptor& descriptor)
+{
+	uint32_t bindingEntries[MATERIAL_BINDING_COUNT];
+	unsigned int* bindingTextures[MATERIAL_BINDING_COUNT];
+	uint32_t newBindings = 0;
+	for (uint32_t binding = 0; binding < MATERIAL_BINDING_COUNT; ++binding)
+	{
+		bool isNew;
+		bindingEntries[binding] = FindOrCreateEntry(GetMaterialEntryKey(setPath, binding), isNew);
+		bindingTextures[binding] = &entries.at(bindingEntries[binding]).texture;
+		newBindings |= isNew ? 1u << binding : 0;
+		handles[binding] = TextureHandle(this, bindingEntries[binding]);
+	}
+
+	Entry& packed = entries.at(bindingEntries[MATERIAL_BINDING_PACKED]);
+	if (packed.hasDescriptor)
+	{
+		descriptor = packed.descriptor;
+	}
+	else
+	{
+		packed.descriptorTargets.push_back(&descriptor);
+	}
+	if (newBindings == 0)
+	{
+		return;
+	}
+
+	// the bindings loaded together are decoded together, one job uploads them in sequence
+	assetLoader.Load([this, setPath, bindingEntries, bindingTextures, newBindings]() -> AssetLoader::UploadStep
+	{
+		const MaterialTextureData data = TextureLoader::LoadMaterialTextureData(setPath, newBindings);
+
+		std::vector<AssetLoader::UploadStep> uploads;
+		for (uint32_t binding = 0; binding < MATERIAL_BINDING_COUNT; ++binding)
+		{
+			if (!(newBindings & (1u << binding)))
+			{
+				continue;
+			}
+
+			const uint32_t entry = bindingEntries[binding];
+			const DecodedImage& image = data.images[binding];
+			const MipGenerationMode mipMode = binding == MATERIAL_BINDING_PACKED ? MIP_GENERATION_LINEAR :
+				TextureLoader::GetMaterialTextureMipMode(static_cast<MaterialTextureSlot>(binding));
+			// cooked textures have no decoded image and aren't shared, a copied container is rare next to a copied image
+			const size_t bytes = data.containers[binding] ?
+				GetStreamedTextureBytes(TextureLoader::GetStreamedData(data.containers[binding])) : GetDecodedImageBytes(image);
+			uploads.push_back(CreateUploadStep(entry, image, mipMode, bytes,
+				TextureLoader::CreateMaterialUploadStep(data, binding, *bindingTextures[binding], sliceBytes, streamer, uploadRing),
+				streamer != nullptr));
+
+			if (binding == MATERIAL_BINDING_PACKED)
+			{
+				// the shader only reads the new channels once the packed texture holding them is bound
+				const MaterialDescriptor packedDescriptor = data.descriptor;
+				uploads.push_back([this, entry, packedDescriptor]()
+				{
+					SetDescriptor(entry, packedDescriptor);
+					return true;
+				});
+			}
+		}
+		return AssetLoader::Sequence(uploads);
+	});
+}
+
+void TextureRegistry::Update()
+{
+	frame++;
+
+	while (true)
+	{
+		const TextureRegistryStatistics statistics = GetStatistics();
+		if (statistics.cpuBytes + statistics.gpuBytes <= budgetBytes)
+		{
+			break;
+		}
+
+		const uint32_t candidate = FindEvictionCandidate();
+		if (candidate == 0)
+		{
+			// what is left is in use, the budget is exceeded until some handles are released
+			break;
+		}
+		Evict(candidate);
+	}
+}
+
+TextureRegistryStatistics TextureRegistry::GetStatistics() const
+{
+	TextureRegistryStatistics statistics;
+	for (const auto& pair : entries)
+	{
+		const Entry& entry = pair.second;
+		statistics.textureCount += entry.texture != 0 ? 1 : 0;
+		statistics.referencedCount += entry.refCount > 0 ? 1 : 0;
+		statistics.cpuBytes += entry.cpuBytes;
+		statistics.gpuBytes += entry.gpuBytes;
+	}
+	statistics.budgetBytes = budgetBytes;
+	statistics.pathHits = pathHits;
+	statistics.contentHits = contentHits;
+	statistics.evictedCount = evictedCount;
+	return statistics;
+}
+
+void TextureRegistry::AddRef(uint32_t entry)
+{
+	entries.at(entry).refCount++;
+}
+
+void TextureRegistry::Release(uint32_t entry)
+{
+	// the texture stays cached, Update evicts it if the memory is needed
+	entries.at(entry).refCount--;
+}
+
+unsigned int TextureRegistry::GetTexture(uint32_t entry)
+{
+	Entry& used = entries.at(entry);
+	Entry& holder = used.owner != 0 ? entries.at(used.owner) : used;
+	used.lastUsedFrame = frame;
+	holder.lastUsedFrame = frame;
+	return holder.texture;
+}
+
+uint32_t TextureRegistry::FindOrCreateEntry(const std::string& key, bool& isNew)
+{
+	const auto found = keyEntries.find(key);
+	if (found != keyEntries.end())
+	{
+		isNew = false;
+		pathHits++;
+		return found->second;
+	}
+
+	isNew = true;
+	const uint32_t entry = nextEntry++;
+	entries[entry].key = key;
+	entries[entry].lastUsedFrame = frame;
+	keyEntries[key] = entry;
+	return entry;
+}
+
+AssetLoader::UploadStep TextureRegistry::CreateUploadStep(uint32_t entry, const DecodedImage& image, MipGenerationMode mipMode,
+	size_t bytes, AssetLoader::UploadStep upload, bool isStreamed)
+{
+	// level 0 is all the content check needs, the mips go away with the upload
+	DecodedImage content;
+	if (image.pixels)
+	{
+		content.width = image.width;
+		content.height = image.height;
+		content.channels = image.channels;
+		content.pixels = image.pixels;
+	}
+	const uint64_t contentHash = content.pixels ? HashContent(image, mipMode) : 0;
+	bool isStarted = false;
+	return [this, entry, content, mipMode, contentHash, bytes, upload, isStreamed, isStarted]() mutable
+	{
+		// entries are only evicted once loaded, this one is still there
+		Entry& loading = entries.at(entry);
+		if (!isStarted)
+		{
+			// a hash is only a hint, the pixels are compared before sharing
+			const auto sharedEntry = contentEntries.find(contentHash);
+			const bool isHashTaken = contentHash != 0 && sharedEntry != contentEntries.end();
+			if (isHashTaken && IsSameContent(entries.at(sharedEntry->second), content, mipMode))
+			{
+				// the texture may still be uploading, GetTexture picks it up once it is done. The rows staged for this
+				// one go back to the ring with upload.
+				loading.owner = sharedEntry->second;
+				loading.isLoaded = true;
+				contentHits++;
+				upload = nullptr;
+				return true;
+			}
+
+			if (!upload)
+			{
+				// the handles keep no texture, the user draws its fallback
+				loading.isLoaded = true;
+				return true;
+			}
+			isStarted = true;
+			loading.cpuBytes = bytes;
+			loading.isStreamed = isStreamed;
+			if (contentHash != 0 && !isHashTaken)
+			{
+				// on a collision the first owner keeps the hash, this texture is only shared under its own key
+				loading.contentHash = contentHash;
+				loading.content = content;
+				loading.contentMipMode = mipMode;
+				contentEntries[contentHash] = entry;
+			}
+		}
+
+		if (!upload())
+		{
+			return false;
+		}
+
+		// the decoded mips go away with this step, level 0 stays for the content check (the streamer keeps it anyway).
+		// A streamed texture is counted with all its levels.
+		loading.gpuBytes = loading.cpuBytes;
+		loading.cpuBytes = loading.isStreamed ? 0 : GetDecodedImageBytes(loading.content);
+		loading.isLoaded = true;
+		return true;
+	};
+}
+
+void TextureRegistry::SetDescriptor(uint32_t entry, const MaterialDescriptor& descriptor)
+{
+	const auto packed = entries.find(entry);
+	if (packed == entries.end())
+	{
+		// evicted while its last step was waiting, nobody holds it anymore
+		return;
+	}
+
+	packed->second.descriptor = descriptor;
+	packed->second.hasDescriptor = true;
+	for (MaterialDescriptor* target : packed->second.descriptorTargets)
+	{
+		*target = descriptor;
+	}
+	packed->second.descriptorTargets.clear();
+}
+
+uint32_t TextureRegistry::FindEvictionCandidate() const
+{
+	uint32_t candidate = 0;
+	uint64_t candidateFrame = 0;
+	for (const auto& pair : entries)
+	{
+		const Entry& entry = pair.second;
+		if (entry.owner != 0 || !entry.isLoaded)
+		{
+			continue;
+		}
+
+		bool isReferenced = entry.refCount > 0;
+		for (const auto& sharer : entries)
+		{
+			isReferenced = isReferenced || (sharer.second.owner == pair.first && sharer.second.refCount > 0);
+		}
+		if (!isReferenced && (candidate == 0 || entry.lastUsedFrame < candidateFrame))
+		{
+			candidate = pair.first;
+			candidateFrame = entry.lastUsedFrame;
+		}
+	}
+	return candidate;
+}
+
+void TextureRegistry::Evict(uint32_t entry)
+{
+	Entry& evicted = entries.at(entry);
+	if (evicted.isStreamed)
+	{
+		streamer->Remove(evicted.texture);
+	}
+	glDeleteTextures(1, &evicted.texture);
+	const auto content = contentEntries.find(evicted.contentHash);
+	if (content != contentEntries.end() && content->second == entry)
+	{
+		contentEntries.erase(content);
+	}
+
+	// the paths sharing the texture go with it, they are loaded again on their next Acquire
+	for (auto it = entries.begin(); it != entries.end();)
+	{
+		if (it->first == entry || it->second.owner == entry)
+		{
+			keyEntries.erase(it->second.key);
+			it = entries.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+	evictedCount++;
+}
+
+std::string TextureRegistry::GetEntryKey(const std::string& path, int channels, MipGenerationMode mipMode)
+{
+	// the same file decoded differently is another texture
+	return path + "|" + std::to_string(channels) + "|" + std::to_string(mipMode);
+}
+
+std::string TextureRegistry::GetMaterialEntryKey(const std::string& setPath, uint32_t binding)
+{
+	// the albedo and normal bindings are the texture of their map, Acquire of the same map shares it
+	if (binding == MATERIAL_BINDING_PACKED)
+	{
+		return GetEntryKey(TextureLoader::GetPackedContainerPath(setPath), 0, MIP_GENERATION_LINEAR);
+	}
+	const MaterialTextureSlot slot = static_cast<MaterialTextureSlot>(binding);
+	return GetEntryKey(TextureLoader::GetMaterialTexturePath(setPath, slot), TextureLoader::GetMaterialTextureChannels(slot),
+		TextureLoader::GetMaterialTextureMipMode(slot));
+}
+
+bool TextureRegistry::IsSameContent(const Entry& owner, const DecodedImage& image, MipGenerationMode mipMode)
+{
+	const DecodedImage& ownerImage = owner.content;
+	return ownerImage.pixels && image.pixels && owner.contentMipMode == mipMode && ownerImage.width == image.width &&
+		ownerImage.height == image.height && ownerImage.channels == image.channels &&
+		memcmp(ownerImage.pixels.get(), image.pixels.get(), size_t(image.width) * image.height * image.channels) == 0;
+}
+
+uint64_t TextureRegistry::HashContent(const DecodedImage& image, MipGenerationMode mipMode)
+{
+	const uint32_t description[4] = { static_cast<uint32_t>(image.width), static_cast<uint32_t>(image.height),
+		static_cast<uint32_t>(image.channels), mipMode };
+	const uint64_t seed = HashBytes(description, sizeof(description));
+	return HashBytes(image.pixels.get(), size_t(image.width) * image.height * image.channels, seed);
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "AssetLoader.h"
+#include "MipGenerator.h"
+#include "PixelUploadRing.h"
+#include "TextureLoader.h"
+#include "TextureStreamer.h"
+
+class TextureRegistry;
+
+// Reference to a texture of a TextureRegistry, the texture is kept while a handle to it exists.
+// Copying a handle adds a reference. GL thread only, like the registry.
+class TextureHandle
+{
+public:
+	TextureHandle() = default;
+	TextureHandle(const TextureHandle& other);
+	TextureHandle(TextureHandle&& other) noexcept;
+	TextureHandle& operator=(const TextureHandle& other);
+	TextureHandle& operator=(TextureHandle&& other) noexcept;
+	~TextureHandle();
+
+	bool IsValid() const { return registry != nullptr; }
+	// GL texture, 0 until it is uploaded or when it failed to load. Counts as a use for the LRU eviction.
+	unsigned int GetTexture() const;
+	void Reset();
+
+private:
+	friend class TextureRegistry;
+	TextureHandle(TextureRegistry* registry, uint32_t entry);
+
+	TextureRegistry* registry = nullptr;
+	uint32_t entry = 0;
+};
+
+struct TextureRegistryStatistics
+{
+	// GL textures, the paths sharing one count once
+	size_t textureCount = 0;
+	// textures with a handle to them
+	size_t referencedCount = 0;
+	// decoded images waiting for their upload, and level 0 of the uploaded ones kept to confirm the content matches
+	size_t cpuBytes = 0;
+	size_t gpuBytes = 0;
+	size_t budgetBytes = 0;
+	// Acquire calls served by a texture loaded under the same path, or under another path with the same pixels
+	size_t pathHits = 0;
+	size_t contentHits = 0;
+	size_t evictedCount = 0;
+};
+
+// Owns the image textures shared across materials. A path is loaded once, and images with the same pixels
+// (e.g. default_normal.jpg copied next to each material) share one texture.
+// Textures nobody holds a handle to stay cached, the least recently used ones are deleted once the registry is over its budget.
+// Every method must be called from the GL thread, the handles must be released before the registry is destroyed.
+class TextureRegistry
+{
+public:
+	// Loads go through assetLoader and its upload budget, sliceBytes worth of rows per upload step, through uploadRing if any.
+	// The material textures are streamed by streamer if any, it must outlive the registry.
+	TextureRegistry(AssetLoader& assetLoader, size_t budgetBytes, size_t sliceBytes, PixelUploadRing* uploadRing = nullptr,
+		TextureStreamer* streamer = nullptr);
+	~TextureRegistry();
+
+	TextureRegistry(const TextureRegistry&) = delete;
+	TextureRegistry& operator=(const TextureRegistry&) = delete;
+
+	// Texture of the image at path decoded with channels channels and its mips filtered according to mipMode.
+	// It is decoded on the workers and uploaded over the next frames, the handle has no texture until then.
+	TextureHandle Acquire(const std::string& path, int channels, MipGenerationMode mipMode);
+	// Same, decoded and uploaded before returning. For the small placeholders drawn until the other textures are loaded.
+	// An upload the driver can't finish at once (the texture is too large) is left to the asset loader.
+	TextureHandle AcquireImmediate(const std::string& path, int channels, MipGenerationMode mipMode);
+	// Textures of the texture set at setPath in handles, one per MaterialTextureBinding, see TextureLoader::LoadMaterialTextureData.
+	// descriptor is set once the packed texture is loaded, it must stay valid until then.
+	void AcquireMaterial(const std::string& setPath, TextureHandle* handles, MaterialDescriptor& descriptor);
+
+	// Once per frame: deletes the least recently used unreferenced textures while over the budget
+	void Update();
+
+	TextureRegistryStatistics GetStatistics() const;
+
+private:
+	friend class TextureHandle;
+
+	struct Entry
+	{
+		std::string key;
+		// entries owning a texture in contentEntries: level 0 of their decoded image, the hash matches are compared to it
+		uint64_t contentHash = 0;
+		DecodedImage content;
+		MipGenerationMode contentMipMode = MIP_GENERATION_LINEAR;
+		// entry whose texture this one shares, 0 when it has its own
+		uint32_t owner = 0;
+		unsigned int texture = 0;
+		uint32_t refCount = 0;
+		size_t cpuBytes = 0;
+		size_t gpuBytes = 0;
+		uint64_t lastUsedFrame = 0;
+		bool isLoaded = false;
+		bool isStreamed = false;
+		// packed material textures: the channels of their maps, and the descriptors waiting for them
+		MaterialDescriptor descriptor;
+		bool hasDescriptor = false;
+		std::vector<MaterialDescriptor*> descriptorTargets;
+	};
+
+	void AddRef(uint32_t entry);
+	void Release(uint32_t entry);
+	unsigned int GetTexture(uint32_t entry);
+
+	// Entry for key, a new one when there is none (isNew is set then)
+	uint32_t FindOrCreateEntry(const std::string& key, bool& isNew);
+	// Thread safe. Upload step of an entry: shares the texture of an entry with the same pixels and mipMode as image (never
+	// when image has no pixels), or runs upload, created on the worker for the texture of the entry. bytes is the memory of the texture.
+	AssetLoader::UploadStep CreateUploadStep(uint32_t entry, const DecodedImage& image, MipGenerationMode mipMode, size_t bytes,
+		AssetLoader::UploadStep upload, bool isStreamed = false);
+	// Sets the descriptor of a packed material entry and of the AcquireMaterial calls waiting for it
+	void SetDescriptor(uint32_t entry, const MaterialDescriptor& descriptor);
+	// Entry of the least recently used texture with no handle to it or to its sharers, 0 when there is none
+	uint32_t FindEvictionCandidate() const;
+	void Evict(uint32_t entry);
+
+	static std::string GetEntryKey(const std::string& path, int channels, MipGenerationMode mipMode);
+	static std::string GetMaterialEntryKey(const std::string& setPath, uint32_t binding);
+	// Thread safe. Hash of the pixels, the size and the mip filtering of image.
+	static uint64_t HashContent(const DecodedImage& image, MipGenerationMode mipMode);
+	// True when level 0 of image, filtered with mipMode, is the content of owner
+	static bool IsSameContent(const Entry& owner, const DecodedImage& image, MipGenerationMode mipMode);
+
+	AssetLoader& assetLoader;
+	size_t budgetBytes;
+	size_t sliceBytes;
+	PixelUploadRing* uploadRing;
+	TextureStreamer* streamer;
+
+	std::unordered_map<uint32_t, Entry> entries;
+	std::unordered_map<std::string, uint32_t> keyEntries;
+	// entries owning a texture, by content hash
+	std::unordered_map<uint64_t, uint32_t> contentEntries;
+	uint32_t nextEntry = 1;
+	uint64_t frame = 0;
+
+	size_t pathHits = 0;
+	size_t contentHits = 0;
+	size_t evictedCount = 0;
+};
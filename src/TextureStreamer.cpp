@@ -0,0 +1,376 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+#include <glad/glad.h>
+
+#include "BlockCompressor.h"
+#include "TextureLoader.h"
+
+// Texel rows of a block compressed level
+const uint32_t STREAMED_BLOCK_ROWS = 4;
+
+// Bytes a level takes on the GPU, decompressed levels are stored with one byte per channel
+size_t GetStreamedLevelBytes(uint32_t format, bool isDecompressing, const TextureMip& mip)
+{
+	if (isDecompressing)
+	{
+		return size_t(mip.width) * mip.height * TextureContainer::GetFormatChannels(format);
+	}
+	return TextureContainer::GetImageSize(format, mip.width, mip.height);
+}
+
+// Storage for level of the bound texture, its content is undefined until uploaded
+void AllocateStreamedLevel(uint32_t format, bool isDecompressing, uint32_t level, const TextureMip& mip)
+{
+	unsigned int internalFormat;
+	unsigned int pixelFormat;
+	if (TextureContainer::IsCompressedFormat(format) && !isDecompressing)
+	{
+		TextureLoader::GetUploadFormats(format, internalFormat, pixelFormat);
+		glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), internalFormat, mip.width, mip.height, 0,
+			static_cast<GLsizei>(mip.size), nullptr);
+		return;
+	}
+
+	TextureLoader::GetUploadFormats(isDecompressing ? TEXTURE_FORMAT_R8 + TextureContainer::GetFormatChannels(format) - 1 : format,
+		internalFormat, pixelFormat);
+	glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), static_cast<GLint>(internalFormat), mip.width, mip.height, 0, pixelFormat,
+		GL_UNSIGNED_BYTE, nullptr);
+}
+
+// Gives the storage of level of the bound texture back to the driver, levels under GL_TEXTURE_BASE_LEVEL aren't sampled
+void FreeStreamedLevel(uint32_t level)
+{
+	glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), GL_R8, 0, 0, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+}
+
+// Uploads rows [firstRow, firstRow + rowCount) of level of the bound texture, pixels holds the whole level.
+// firstRow and rowCount are multiples of 4 for the block compressed formats, except the last rows of the level.
+// Read from client memory: the streamer runs on the GL thread, staging the rows in a PixelUploadRing there would only add a copy.
+void UploadStreamedRows(uint32_t format, bool isDecompressing, uint32_t level, const TextureMip& mip,
+	const unsigned char* pixels, uint32_t firstRow, uint32_t rowCount)
+{
+	unsigned int internalFormat;
+	unsigned int pixelFormat;
+	if (TextureContainer::IsCompressedFormat(format) && !isDecompressing)
+	{
+		TextureLoader::GetUploadFormats(format, internalFormat, pixelFormat);
+		const size_t blockRowSize = TextureContainer::GetImageSize(format, mip.width, STREAMED_BLOCK_ROWS);
+		const size_t size = TextureContainer::GetImageSize(format, mip.width, rowCount);
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), 0, firstRow, mip.width, rowCount, internalFormat,
+			static_cast<GLsizei>(size), pixels + blockRowSize * (firstRow / STREAMED_BLOCK_ROWS));
+		return;
+	}
+
+	const uint32_t channels = TextureContainer::GetFormatChannels(format);
+	TextureLoader::GetUploadFormats(TEXTURE_FORMAT_R8 + channels - 1, internalFormat, pixelFormat);
+	const size_t rowSize = size_t(mip.width) * channels;
+	glTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), 0, firstRow, mip.width, rowCount, pixelFormat, GL_UNSIGNED_BYTE,
+		pixels + rowSize * firstRow);
+}
+
+TextureStreamer::TextureStreamer(size_t budgetBytes, uint32_t tailSize)
+	: budgetBytes(budgetBytes), tailSize(tailSize)
+{
+}
+
+void TextureStreamer::Add(const StreamedTextureData& data, unsigned int& texture)
+{
+	if (data.mips.empty() || data.format >= TEXTURE_FORMAT_COUNT)
+	{
+		std::cout << "ERROR::TEXTURE_STREAMER::NO_LEVELS" << std::endl;
+		return;
+	}
+
+	StreamedTexture streamed;
+	streamed.data = data;
+	streamed.isDecompressing = TextureContainer::IsCompressedFormat(data.format) && !TextureLoader::IsBlockFormatSupported(data.format);
+	const uint32_t mipCount = static_cast<uint32_t>(data.mips.size());
+	streamed.tailLevel = mipCount - 1;
+	for (uint32_t level = 0; level < mipCount; ++level)
+	{
+		if (std::max(data.mips[level].width, data.mips[level].height) <= tailSize)
+		{
+			streamed.tailLevel = level;
+			break;
+		}
+	}
+	streamed.residentLevel = streamed.tailLevel;
+	streamed.wantedLevel = streamed.tailLevel;
+
+	glGenTextures(1, &streamed.texture);
+	glBindTexture(GL_TEXTURE_2D, streamed.texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(streamed.tailLevel));
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(mipCount - 1));
+
+	// the tail is a few KB, it goes in one piece
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (uint32_t level = streamed.tailLevel; level < mipCount; ++level)
+	{
+		const TextureMip& mip = data.mips[level];
+		std::vector<unsigned char> decompressed;
+		const unsigned char* pixels = static_cast<const unsigned char*>(mip.data);
+		if (streamed.isDecompressing)
+		{
+			decompressed = BlockCompressor::Decompress(data.format, pixels, mip.width, mip.height);
+			pixels = decompressed.data();
+		}
+		AllocateStreamedLevel(data.format, streamed.isDecompressing, level, mip);
+		UploadStreamedRows(data.format, streamed.isDecompressing, level, mip, pixels, 0, mip.height);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	if (texture != 0)
+	{
+		Remove(texture);
+		glDeleteTextures(1, &texture);
+	}
+	texture = streamed.texture;
+	textures.push_back(streamed);
+}
+
+void TextureStreamer::Remove(unsigned int texture)
+{
+	if (streamingTexture == texture)
+	{
+		// the partial level is finer than GL_TEXTURE_BASE_LEVEL, nothing samples it
+		streamingTexture = 0;
+		decompressedLevel.clear();
+	}
+	textures.erase(std::remove_if(textures.begin(), textures.end(),
+		[texture](const StreamedTexture& streamed) { return streamed.texture == texture; }), textures.end());
+}
+
+void TextureStreamer::RequestScreenSize(unsigned int texture, float screenSize)
+{
+	StreamedTexture* streamed = Find(texture);
+	if (streamed)
+	{
+		streamed->screenSize = std::max(streamed->screenSize, screenSize);
+	}
+}
+
+void TextureStreamer::Update(size_t uploadBytes)
+{
+	// a level twice the screen size is never sampled, the mip selection picks the coarser one
+	for (StreamedTexture& streamed : textures)
+	{
+		streamed.wantedLevel = streamed.tailLevel;
+		if (streamed.screenSize > 0.0f)
+		{
+			const TextureMip& top = streamed.data.mips[0];
+			const float texelsPerPixel = float(std::max(top.width, top.height)) / streamed.screenSize;
+			const float level = std::floor(std::log2(std::max(texelsPerPixel, 1.0f)));
+			streamed.wantedLevel = std::min(static_cast<uint32_t>(level), streamed.tailLevel);
+		}
+	}
+
+	while (GetResidentBytes() > budgetBytes)
+	{
+		StreamedTexture* candidate = FindReleaseCandidate(std::numeric_limits<float>::infinity());
+		if (candidate)
+		{
+			ReleaseTopLevel(*candidate);
+		}
+		else if (streamingTexture != 0)
+		{
+			CancelStreaming();
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	size_t uploadedBytes = 0;
+	while (uploadedBytes < uploadBytes)
+	{
+		if (streamingTexture == 0)
+		{
+			StreamedTexture* next = nullptr;
+			for (StreamedTexture& streamed : textures)
+			{
+				if (streamed.residentLevel > streamed.wantedLevel && (!next || GetPriority(streamed) > GetPriority(*next)))
+				{
+					next = &streamed;
+				}
+			}
+			if (!next)
+			{
+				break;
+			}
+
+			// room is only made at the expense of textures needing their top level less than this one needs the new level,
+			// otherwise two textures would keep taking the same memory from each other
+			const uint32_t level = next->residentLevel - 1;
+			const TextureMip& mip = next->data.mips[level];
+			const size_t levelBytes = GetStreamedLevelBytes(next->data.format, next->isDecompressing, mip);
+			const float priority = next->screenSize / float(std::max(mip.width, mip.height));
+			bool hasRoom = true;
+			while (hasRoom && GetResidentBytes() + levelBytes > budgetBytes)
+			{
+				StreamedTexture* victim = FindReleaseCandidate(priority);
+				if (victim)
+				{
+					ReleaseTopLevel(*victim);
+				}
+				hasRoom = victim != nullptr;
+			}
+			if (!hasRoom)
+			{
+				break;
+			}
+
+			streamingTexture = next->texture;
+			streamingLevel = level;
+			streamedRows = 0;
+			glBindTexture(GL_TEXTURE_2D, streamingTexture);
+			AllocateStreamedLevel(next->data.format, next->isDecompressing, level, mip);
+			if (next->isDecompressing)
+			{
+				decompressedLevel = BlockCompressor::Decompress(next->data.format, static_cast<const unsigned char*>(mip.data), mip.width, mip.height);
+			}
+		}
+
+		StreamedTexture* streamed = Find(streamingTexture);
+		const TextureMip& mip = streamed->data.mips[streamingLevel];
+		const unsigned char* pixels = streamed->isDecompressing ?
+			decompressedLevel.data() : static_cast<const unsigned char*>(mip.data);
+
+		// whole block rows for the compressed formats, sized to what is left of uploadBytes
+		const bool isBlockUpload = TextureContainer::IsCompressedFormat(streamed->data.format) && !streamed->isDecompressing;
+		const uint32_t rowAlignment = isBlockUpload ? STREAMED_BLOCK_ROWS : 1;
+		const size_t alignedRowsSize = isBlockUpload ?
+			TextureContainer::GetImageSize(streamed->data.format, mip.width, STREAMED_BLOCK_ROWS) :
+			GetStreamedLevelBytes(streamed->data.format, streamed->isDecompressing, TextureMip{ mip.width, 1, nullptr, 0 });
+		const uint32_t bandRows = static_cast<uint32_t>(std::max<size_t>((uploadBytes - uploadedBytes) / alignedRowsSize, 1)) * rowAlignment;
+		const uint32_t rows = std::min(bandRows, mip.height - streamedRows);
+
+		glBindTexture(GL_TEXTURE_2D, streamingTexture);
+		UploadStreamedRows(streamed->data.format, streamed->isDecompressing, streamingLevel, mip, pixels, streamedRows, rows);
+		uploadedBytes += alignedRowsSize * ((rows + rowAlignment - 1) / rowAlignment);
+		streamedRows += rows;
+		if (streamedRows == mip.height)
+		{
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(streamingLevel));
+			streamed->residentLevel = streamingLevel;
+			streamingTexture = 0;
+			decompressedLevel.clear();
+			streamedLevels++;
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	for (StreamedTexture& streamed : textures)
+	{
+		streamed.screenSize = 0.0f;
+	}
+}
+
+TextureStreamingStatistics TextureStreamer::GetStatistics() const
+{
+	TextureStreamingStatistics statistics;
+	statistics.textureCount = textures.size();
+	statistics.residentBytes = GetResidentBytes();
+	statistics.budgetBytes = budgetBytes;
+	statistics.streamedLevels = streamedLevels;
+	statistics.releasedLevels = releasedLevels;
+	return statistics;
+}
+
+float TextureStreamer::ComputeScreenSize(const glm::vec3& boundsCenter, float boundsRadius, const glm::mat4& model,
+	const glm::vec3& cameraPosition, float fovY, float viewportHeight)
+{
+	const glm::vec3 center = glm::vec3(model * glm::vec4(boundsCenter, 1.0f));
+	const float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	const float radius = boundsRadius * scale;
+	const float distance = glm::length(center - cameraPosition);
+	if (distance <= radius)
+	{
+		// the camera is inside the bounds
+		return viewportHeight;
+	}
+
+	// tangent of the half angle the sphere covers, over the one of the field of view
+	const float tangent = radius / std::sqrt(distance * distance - radius * radius);
+	return std::min(tangent / std::tan(fovY * 0.5f), 1.0f) * viewportHeight;
+}
+
+TextureStreamer::StreamedTexture* TextureStreamer::Find(unsigned int texture)
+{
+	for (StreamedTexture& streamed : textures)
+	{
+		if (streamed.texture == texture)
+		{
+			return &streamed;
+		}
+	}
+	return nullptr;
+}
+
+float TextureStreamer::GetPriority(const StreamedTexture& streamed) const
+{
+	const TextureMip& resident = streamed.data.mips[streamed.residentLevel];
+	return streamed.screenSize / float(std::max(resident.width, resident.height));
+}
+
+size_t TextureStreamer::GetResidentBytes() const
+{
+	size_t bytes = 0;
+	for (const StreamedTexture& streamed : textures)
+	{
+		for (uint32_t level = streamed.residentLevel; level < streamed.data.mips.size(); ++level)
+		{
+			bytes += GetStreamedLevelBytes(streamed.data.format, streamed.isDecompressing, streamed.data.mips[level]);
+		}
+		if (streamed.texture == streamingTexture)
+		{
+			bytes += GetStreamedLevelBytes(streamed.data.format, streamed.isDecompressing, streamed.data.mips[streamingLevel]);
+		}
+	}
+	return bytes;
+}
+
+TextureStreamer::StreamedTexture* TextureStreamer::FindReleaseCandidate(float maxPriority)
+{
+	// the level being streamed sits on top of the resident ones, that texture keeps them
+	StreamedTexture* candidate = nullptr;
+	for (StreamedTexture& streamed : textures)
+	{
+		if (streamed.residentLevel < streamed.tailLevel && streamed.texture != streamingTexture &&
+			GetPriority(streamed) < maxPriority && (!candidate || GetPriority(streamed) < GetPriority(*candidate)))
+		{
+			candidate = &streamed;
+		}
+	}
+	return candidate;
+}
+
+void TextureStreamer::ReleaseTopLevel(StreamedTexture& streamed)
+{
+	const uint32_t level = streamed.residentLevel;
+	streamed.residentLevel++;
+	glBindTexture(GL_TEXTURE_2D, streamed.texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(streamed.residentLevel));
+	FreeStreamedLevel(level);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	releasedLevels++;
+}
+
+void TextureStreamer::CancelStreaming()
+{
+	glBindTexture(GL_TEXTURE_2D, streamingTexture);
+	FreeStreamedLevel(streamingLevel);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	streamingTexture = 0;
+	decompressedLevel.clear();
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "TextureContainer.h"
+
+// Levels a streamed texture is built from. The streamer keeps owner alive, so the levels it released can come back.
+struct StreamedTextureData
+{
+	uint32_t format = TEXTURE_FORMAT_COUNT;	// TextureContainerFormat
+	std::vector<TextureMip> mips;	// level 0 first, down to the smallest one
+	std::shared_ptr<const void> owner;	// memory behind the mips (the container mapping, the decoded image, ...)
+};
+
+struct TextureStreamingStatistics
+{
+	size_t textureCount = 0;
+	// allocated levels, the one being streamed included
+	size_t residentBytes = 0;
+	size_t budgetBytes = 0;
+	size_t streamedLevels = 0;
+	size_t releasedLevels = 0;
+};
+
+// Progressive texture residency. A texture becomes usable as soon as its mip tail (the levels of at most tailSize texels)
+// is uploaded, the levels above are streamed by Update one at a time, the most magnified texture first.
+// GL_TEXTURE_BASE_LEVEL keeps the sampling on the complete levels meanwhile.
+// When the resident levels exceed the budget the top levels of the least needed textures are released.
+// Every method must be called from the GL thread.
+class TextureStreamer
+{
+public:
+	explicit TextureStreamer(size_t budgetBytes, uint32_t tailSize = 64);
+
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// Creates a texture from data with its mip tail uploaded, then replaces texture with it (the previous one is deleted).
+	// The GL texture belongs to the caller, the streamer only changes its levels.
+	void Add(const StreamedTextureData& data, unsigned int& texture);
+	// Stops streaming texture, it keeps its current levels
+	void Remove(unsigned int texture);
+
+	// texture is drawn over screenSize pixels this frame (the largest request wins), finer levels aren't needed.
+	// Textures nobody requested in a frame are the first ones to lose their levels.
+	void RequestScreenSize(unsigned int texture, float screenSize);
+
+	// Releases levels over the budget, then uploads up to uploadBytes of the most needed missing level.
+	// Clears the requests of the frame.
+	void Update(size_t uploadBytes);
+
+	TextureStreamingStatistics GetStatistics() const;
+
+	// Diameter in pixels of the bounding sphere (in model space) on a viewport viewportHeight pixels high, fovY in radians
+	static float ComputeScreenSize(const glm::vec3& boundsCenter, float boundsRadius, const glm::mat4& model,
+		const glm::vec3& cameraPosition, float fovY, float viewportHeight);
+
+private:
+	struct StreamedTexture
+	{
+		unsigned int texture = 0;
+		StreamedTextureData data;
+		// first level of the mip tail
+		uint32_t tailLevel = 0;
+		// finest complete level, GL_TEXTURE_BASE_LEVEL
+		uint32_t residentLevel = 0;
+		// finest level the requests of the frame need
+		uint32_t wantedLevel = 0;
+		float screenSize = 0.0f;
+		// block compressed data the driver can't sample
+		bool isDecompressing = false;
+	};
+
+	StreamedTexture* Find(unsigned int texture);
+	// screen pixels per texel of the finest resident level, the higher the more its next level is needed
+	float GetPriority(const StreamedTexture& streamed) const;
+	size_t GetResidentBytes() const;
+	// Least needed texture with a level above its tail to release, among those less needed than maxPriority
+	StreamedTexture* FindReleaseCandidate(float maxPriority);
+	void ReleaseTopLevel(StreamedTexture& streamed);
+	void CancelStreaming();
+
+	std::vector<StreamedTexture> textures;
+	size_t budgetBytes;
+	uint32_t tailSize;
+
+	// level being uploaded, 0 when none
+	unsigned int streamingTexture = 0;
+	uint32_t streamingLevel = 0;
+	uint32_t streamedRows = 0;
+	std::vector<unsigned char> decompressedLevel;
+
+	size_t streamedLevels = 0;
+	size_t releasedLevels = 0;
+};
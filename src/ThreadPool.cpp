@@ -0,0 +1,119 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	if (threadCount == 0)
+	{
+		const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	workers.reserve(threadCount);
+	for (unsigned int n = 0; n < threadCount; ++n)
+	{
+		workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(jobsMutex);
+		isStopping = true;
+	}
+	jobsCondition.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::Submit(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(jobsMutex);
+		jobs.push_back(std::move(job));
+	}
+	jobsCondition.notify_one();
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& job)
+{
+	if (count == 0)
+	{
+		return;
+	}
+	if (count == 1)
+	{
+		job(0);
+		return;
+	}
+
+	// Shared between the caller and the helpers. Helpers may start after everything is done,
+	// so the state outlives this call and they must not touch 'job' unless they claimed an item.
+	struct ParallelForState
+	{
+		std::atomic<size_t> nextItem{ 0 };
+		std::atomic<size_t> pendingItems{ 0 };
+		std::mutex doneMutex;
+		std::condition_variable doneCondition;
+	};
+	std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>();
+	state->pendingItems = count;
+
+	auto consumeItems = [state, count](const std::function<void(size_t)>& itemJob)
+	{
+		for (size_t item = state->nextItem++; item < count; item = state->nextItem++)
+		{
+			itemJob(item);
+			if (--state->pendingItems == 0)
+			{
+				std::lock_guard<std::mutex> lock(state->doneMutex);
+				state->doneCondition.notify_all();
+			}
+		}
+	};
+
+	const std::function<void(size_t)>* jobPointer = &job;
+	const size_t helperCount = std::min<size_t>(workers.size(), count - 1);
+	for (size_t n = 0; n < helperCount; ++n)
+	{
+		// the job reference is only dereferenced while items are still pending, i.e. while the caller is waiting
+		Submit([consumeItems, jobPointer]() { consumeItems(*jobPointer); });
+	}
+
+	consumeItems(job);
+
+	std::unique_lock<std::mutex> lock(state->doneMutex);
+	state->doneCondition.wait(lock, [&state]() { return state->pendingItems == 0; });
+}
+
+ThreadPool& ThreadPool::GetShared()
+{
+	static ThreadPool sharedPool;
+	return sharedPool;
+}
+
+void ThreadPool::WorkerLoop()
+{
+	for (;;)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(jobsMutex);
+			jobsCondition.wait(lock, [this]() { return isStopping || !jobs.empty(); });
+			if (isStopping && jobs.empty())
+			{
+				return;
+			}
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		job();
+	}
+}
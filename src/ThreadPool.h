@@ -0,0 +1,41 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads consuming a FIFO job queue.
+class ThreadPool
+{
+public:
+	// 0 threads means one per hardware thread (minus the calling one)
+	explicit ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Queues a job, it runs on whatever worker picks it first
+	void Submit(std::function<void()> job);
+
+	// Runs job(n) for every n in [0, count) on the workers and on the calling thread, returns once all of them finished.
+	// Safe to call from inside a job: the caller keeps consuming items itself instead of blocking on the queue.
+	void ParallelFor(size_t count, const std::function<void(size_t)>& job);
+
+	unsigned int GetThreadCount() const { return static_cast<unsigned int>(workers.size()); }
+
+	// Pool shared by the loaders, created on first use
+	static ThreadPool& GetShared();
+
+private:
+	void WorkerLoop();
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	std::mutex jobsMutex;
+	std::condition_variable jobsCondition;
+	bool isStopping = false;
+};
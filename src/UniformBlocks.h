@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// Binding points of the uniform blocks of res/shaders/uniform_blocks.glsl
+enum UniformBlockBinding : uint32_t
+{
+	UNIFORM_BLOCK_FRAME = 0,
+	UNIFORM_BLOCK_OBJECT,
+};
+
+// FrameBlock, std140: every vec3 starts on 16 bytes
+struct FrameUniforms
+{
+	glm::mat4 view = glm::mat4(1.0f);
+	glm::mat4 projection = glm::mat4(1.0f);
+	glm::mat4 viewProjection = glm::mat4(1.0f);
+	glm::vec3 cameraWorldPosition = glm::vec3(0.0f);
+	float padding0 = 0.0f;
+	glm::vec3 lightWorldPosition = glm::vec3(0.0f);
+	float padding1 = 0.0f;
+	glm::vec3 lightColor = glm::vec3(0.0f);
+	float padding2 = 0.0f;
+};
+static_assert(sizeof(FrameUniforms) == 240, "FrameUniforms must match the std140 layout of FrameBlock");
+
+// ObjectBlock, std140: the Material struct starts on 16 bytes and is padded to 16
+struct ObjectUniforms
+{
+	glm::mat4 transform = glm::mat4(1.0f);
+	glm::vec3 baseColor = glm::vec3(1.0f);
+	float padding0 = 0.0f;
+	int32_t occlusionChannel = -1;
+	int32_t roughnessChannel = -1;
+	int32_t displacementChannel = -1;
+	int32_t padding1 = 0;
+};
+static_assert(sizeof(ObjectUniforms) == 96, "ObjectUniforms must match the std140 layout of ObjectBlock");
@@ -0,0 +1,136 @@
+#include "UniformBufferRing.h"
+
+#include <cstring>
+#include <iostream>
+
+#include <glad/glad.h>
+
+// Longest wait on a fence before checking it again, in nanoseconds
+const GLuint64 UNIFORM_BUFFER_WAIT_NANOSECONDS = 1000000;
+
+UniformBufferRing::UniformBufferRing(size_t frameCapacity)
+{
+	GLint offsetAlignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+	if (offsetAlignment > 0)
+	{
+		alignment = static_cast<size_t>(offsetAlignment);
+	}
+	this->frameCapacity = (frameCapacity + alignment - 1) / alignment * alignment;
+	const GLsizeiptr capacity = static_cast<GLsizeiptr>(this->frameCapacity * UNIFORM_BUFFER_FRAME_COUNT);
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	if (glBufferStorage != nullptr)
+	{
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_UNIFORM_BUFFER, capacity, nullptr, flags);
+		mapping = static_cast<unsigned char*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, capacity, flags));
+		if (mapping == nullptr)
+		{
+			// the storage is immutable, a new buffer is needed for glBufferData
+			std::cout << "ERROR::UNIFORM_BUFFER_RING::MAP_FAILED" << std::endl;
+			glDeleteBuffers(1, &buffer);
+			glGenBuffers(1, &buffer);
+			glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+		}
+	}
+	else
+	{
+		std::cout << "UNIFORM_BUFFER_RING::NO_BUFFER_STORAGE, uniform blocks are written with glBufferSubData" << std::endl;
+	}
+	if (mapping == nullptr)
+	{
+		glBufferData(GL_UNIFORM_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+UniformBufferRing::~UniformBufferRing()
+{
+	for (void* fence : fences)
+	{
+		if (fence != nullptr)
+		{
+			glDeleteSync(static_cast<GLsync>(fence));
+		}
+	}
+	// deleting the buffer unmaps it
+	glDeleteBuffers(1, &buffer);
+}
+
+void UniformBufferRing::BeginFrame()
+{
+	frame = (frame + 1) % UNIFORM_BUFFER_FRAME_COUNT;
+	head = 0;
+
+	GLsync fence = static_cast<GLsync>(fences[frame]);
+	if (fence == nullptr)
+	{
+		return;
+	}
+	// the frame written UNIFORM_BUFFER_FRAME_COUNT frames ago, usually done already
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+	{
+		waitCount++;
+		GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		do
+		{
+			result = glClientWaitSync(fence, flags, UNIFORM_BUFFER_WAIT_NANOSECONDS);
+			flags = 0;
+		} while (result == GL_TIMEOUT_EXPIRED);
+	}
+	glDeleteSync(fence);
+	fences[frame] = nullptr;
+}
+
+bool UniformBufferRing::Write(const void* data, size_t size, UniformBufferRegion& region)
+{
+	if (size == 0 || head + size > frameCapacity)
+	{
+		fullCount++;
+		return false;
+	}
+
+	region.offset = frame * frameCapacity + head;
+	region.size = size;
+	head = (head + size + alignment - 1) / alignment * alignment;
+	writtenBytes += size;
+
+	if (mapping != nullptr)
+	{
+		std::memcpy(mapping + region.offset, data, size);
+	}
+	else
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, static_cast<GLintptr>(region.offset), static_cast<GLsizeiptr>(size), data);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+	return true;
+}
+
+void UniformBufferRing::Bind(uint32_t bindingPoint, const UniformBufferRegion& region) const
+{
+	glBindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, buffer, static_cast<GLintptr>(region.offset), static_cast<GLsizeiptr>(region.size));
+}
+
+void UniformBufferRing::EndFrame()
+{
+	if (fences[frame] != nullptr)
+	{
+		glDeleteSync(static_cast<GLsync>(fences[frame]));
+	}
+	fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+UniformBufferRingStatistics UniformBufferRing::GetStatistics() const
+{
+	UniformBufferRingStatistics statistics;
+	statistics.frameCapacity = frameCapacity;
+	statistics.writtenBytes = writtenBytes;
+	statistics.waitCount = waitCount;
+	statistics.fullCount = fullCount;
+	return statistics;
+}
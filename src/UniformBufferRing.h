@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Frames a UniformBufferRing holds, the CPU writes one while the GPU may read the others
+const uint32_t UNIFORM_BUFFER_FRAME_COUNT = 3;
+
+// Bytes of a UniformBufferRing holding one uniform block
+struct UniformBufferRegion
+{
+	size_t offset = 0;
+	size_t size = 0;
+};
+
+struct UniformBufferRingStatistics
+{
+	// of each frame
+	size_t frameCapacity = 0;
+	size_t writtenBytes = 0;
+	// frames that waited for the GPU to be done with their part of the buffer
+	size_t waitCount = 0;
+	// writes dropped because the frame was full
+	size_t fullCount = 0;
+};
+
+// GL_UNIFORM_BUFFER the uniform blocks of a frame are written to, bound by range for each draw (glBindBufferRange).
+// The buffer is split in UNIFORM_BUFFER_FRAME_COUNT parts used in turn, one per frame, so the CPU writes a frame while the GPU
+// still reads the previous ones. A part is reused once the fence issued after its frame is signaled.
+// Persistently mapped with glBufferStorage (GL 4.4 or ARB_buffer_storage), otherwise IsPersistent is false and the writes
+// go through glBufferSubData. GL thread only.
+class UniformBufferRing
+{
+public:
+	// frameCapacity bytes for each frame
+	explicit UniformBufferRing(size_t frameCapacity);
+	~UniformBufferRing();
+
+	UniformBufferRing(const UniformBufferRing&) = delete;
+	UniformBufferRing& operator=(const UniformBufferRing&) = delete;
+
+	bool IsPersistent() const { return mapping != nullptr; }
+
+	// Once per frame before its first Write: moves to the next part of the buffer, waiting for the GPU to be done with it
+	void BeginFrame();
+	// Copies size bytes of data to the current frame, at an offset aligned for glBindBufferRange.
+	// False when the frame is full, the draw using the block must be skipped then.
+	bool Write(const void* data, size_t size, UniformBufferRegion& region);
+	// Binds region to the uniform block binding point
+	void Bind(uint32_t bindingPoint, const UniformBufferRegion& region) const;
+	// Once per frame after its last draw: fences the frame
+	void EndFrame();
+
+	UniformBufferRingStatistics GetStatistics() const;
+
+private:
+	unsigned int buffer = 0;
+	unsigned char* mapping = nullptr;
+	// frameCapacity rounded up to the offset alignment
+	size_t frameCapacity;
+	size_t alignment = 256;
+
+	uint32_t frame = 0;
+	// next free byte of the current frame, from its start
+	size_t head = 0;
+	// GLsync of the last use of each part, nullptr once signaled
+	void* fences[UNIFORM_BUFFER_FRAME_COUNT] = {};
+
+	size_t writtenBytes = 0;
+	size_t waitCount = 0;
+	size_t fullCount = 0;
+};
@@ -0,0 +1,186 @@
+#include "VertexPacking.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <glm/gtc/packing.hpp>
+
+glm::vec3 ReadVertexVec3(const unsigned char* vertex, int32_t offset)
+{
+	glm::vec3 value;
+	memcpy(&value, vertex + offset, sizeof(glm::vec3));
+	return value;
+}
+
+glm::vec2 ReadVertexVec2(const unsigned char* vertex, int32_t offset)
+{
+	glm::vec2 value;
+	memcpy(&value, vertex + offset, sizeof(glm::vec2));
+	return value;
+}
+
+glm::vec3 SafeNormalize(const glm::vec3& direction, const glm::vec3& fallback)
+{
+	const float length = glm::length(direction);
+	return length > 0.0f ? direction / length : fallback;
+}
+
+float SnormToFloat(int16_t value)
+{
+	return std::max(float(value) / 32767.0f, -1.0f);
+}
+
+int16_t FloatToSnorm(float value)
+{
+	return static_cast<int16_t>(std::lround(glm::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+float AngleBetween(const glm::vec3& a, const glm::vec3& b)
+{
+	return glm::degrees(std::acos(glm::clamp(glm::dot(a, b), -1.0f, 1.0f)));
+}
+
+glm::vec2 VertexPacking::OctahedralEncode(const glm::vec3& direction)
+{
+	const glm::vec3 n = direction / (std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z));
+	if (n.z >= 0.0f)
+	{
+		return glm::vec2(n.x, n.y);
+	}
+	// fold the lower hemisphere over the diagonals
+	return glm::vec2(
+		(1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+		(1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+}
+
+glm::vec3 VertexPacking::OctahedralDecode(const glm::vec2& encoded)
+{
+	// must match OctahedralDecode in shader.vs
+	glm::vec3 n(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+	const float t = std::max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return glm::normalize(n);
+}
+
+// Quantizes the direction, trying the 4 snorm16 neighbours of the exact encoding and keeping the one that decodes closest
+void PackDirection(const glm::vec3& direction, int16_t packed[2])
+{
+	const glm::vec2 encoded = VertexPacking::OctahedralEncode(direction);
+	const float baseX = std::floor(glm::clamp(encoded.x, -1.0f, 1.0f) * 32767.0f);
+	const float baseY = std::floor(glm::clamp(encoded.y, -1.0f, 1.0f) * 32767.0f);
+
+	float bestDot = -2.0f;
+	for (int dy = 0; dy < 2; ++dy)
+	{
+		for (int dx = 0; dx < 2; ++dx)
+		{
+			const int16_t x = static_cast<int16_t>(glm::clamp(baseX + dx, -32767.0f, 32767.0f));
+			const int16_t y = static_cast<int16_t>(glm::clamp(baseY + dy, -32767.0f, 32767.0f));
+			const float candidateDot = glm::dot(direction, VertexPacking::OctahedralDecode(glm::vec2(SnormToFloat(x), SnormToFloat(y))));
+			if (candidateDot > bestDot)
+			{
+				bestDot = candidateDot;
+				packed[0] = x;
+				packed[1] = y;
+			}
+		}
+	}
+}
+
+PackedVertexBounds VertexPacking::PackVertices(const unsigned char* vertexData, const VertexLayout& layout, size_t vertexCount, std::vector<PackedVertexData>& packedVertices)
+{
+	PackedVertexBounds bounds;
+	packedVertices.resize(vertexCount);
+	if (vertexCount == 0)
+	{
+		return bounds;
+	}
+
+	// mesh AABB
+	glm::vec3 boundsMin = ReadVertexVec3(vertexData, layout.positionOffset);
+	glm::vec3 boundsMax = boundsMin;
+	for (size_t n = 1; n < vertexCount; ++n)
+	{
+		const glm::vec3 position = ReadVertexVec3(vertexData + n * layout.stride, layout.positionOffset);
+		boundsMin = glm::min(boundsMin, position);
+		boundsMax = glm::max(boundsMax, position);
+	}
+	bounds.boundsMin = boundsMin;
+	bounds.boundsExtent = boundsMax - boundsMin;
+
+	// flat axes quantize to 0
+	const glm::vec3 inverseExtent(
+		bounds.boundsExtent.x > 0.0f ? 1.0f / bounds.boundsExtent.x : 0.0f,
+		bounds.boundsExtent.y > 0.0f ? 1.0f / bounds.boundsExtent.y : 0.0f,
+		bounds.boundsExtent.z > 0.0f ? 1.0f / bounds.boundsExtent.z : 0.0f);
+
+	for (size_t n = 0; n < vertexCount; ++n)
+	{
+		const unsigned char* vertex = vertexData + n * layout.stride;
+		PackedVertexData& packed = packedVertices[n];
+
+		const glm::vec3 position = (ReadVertexVec3(vertex, layout.positionOffset) - bounds.boundsMin) * inverseExtent;
+		packed.position[0] = static_cast<uint16_t>(std::lround(glm::clamp(position.x, 0.0f, 1.0f) * 65535.0f));
+		packed.position[1] = static_cast<uint16_t>(std::lround(glm::clamp(position.y, 0.0f, 1.0f) * 65535.0f));
+		packed.position[2] = static_cast<uint16_t>(std::lround(glm::clamp(position.z, 0.0f, 1.0f) * 65535.0f));
+
+		const glm::vec2 uv = ReadVertexVec2(vertex, layout.uvOffset);
+		packed.uv[0] = glm::packHalf1x16(uv.x);
+		packed.uv[1] = glm::packHalf1x16(uv.y);
+
+		const glm::vec3 normal = SafeNormalize(ReadVertexVec3(vertex, layout.normalOffset), glm::vec3(0.0f, 0.0f, 1.0f));
+		const glm::vec3 tangent = SafeNormalize(ReadVertexVec3(vertex, layout.tangentOffset), glm::vec3(1.0f, 0.0f, 0.0f));
+		const glm::vec3 bitangent = ReadVertexVec3(vertex, layout.bitangentOffset);
+		PackDirection(normal, packed.normal);
+		PackDirection(tangent, packed.tangent);
+
+		// handedness of the tangent frame
+		packed.position[3] = glm::dot(glm::cross(normal, tangent), bitangent) >= 0.0f ? 65535 : 0;
+	}
+
+	return bounds;
+}
+
+VertexPackingError VertexPacking::MeasureError(const unsigned char* vertexData, const VertexLayout& layout, const std::vector<PackedVertexData>& packedVertices, const PackedVertexBounds& bounds)
+{
+	VertexPackingError error;
+	if (packedVertices.empty())
+	{
+		return error;
+	}
+
+	double positionErrorSum = 0.0;
+	double normalErrorSum = 0.0;
+	for (size_t n = 0; n < packedVertices.size(); ++n)
+	{
+		const unsigned char* vertex = vertexData + n * layout.stride;
+		const PackedVertexData& packed = packedVertices[n];
+
+		const glm::vec3 position = bounds.boundsMin + glm::vec3(packed.position[0], packed.position[1], packed.position[2]) / 65535.0f * bounds.boundsExtent;
+		const float positionError = glm::length(position - ReadVertexVec3(vertex, layout.positionOffset));
+		error.maxPositionError = std::max(error.maxPositionError, positionError);
+		positionErrorSum += positionError;
+
+		const glm::vec2 uv(glm::unpackHalf1x16(packed.uv[0]), glm::unpackHalf1x16(packed.uv[1]));
+		const glm::vec2 uvDelta = glm::abs(uv - ReadVertexVec2(vertex, layout.uvOffset));
+		error.maxUVError = std::max(error.maxUVError, std::max(uvDelta.x, uvDelta.y));
+
+		const glm::vec3 normal = OctahedralDecode(glm::vec2(SnormToFloat(packed.normal[0]), SnormToFloat(packed.normal[1])));
+		const glm::vec3 tangent = OctahedralDecode(glm::vec2(SnormToFloat(packed.tangent[0]), SnormToFloat(packed.tangent[1])));
+		const glm::vec3 bitangent = glm::cross(normal, tangent) * (packed.position[3] != 0 ? 1.0f : -1.0f);
+
+		const float normalError = AngleBetween(normal, SafeNormalize(ReadVertexVec3(vertex, layout.normalOffset), normal));
+		error.maxNormalError = std::max(error.maxNormalError, normalError);
+		normalErrorSum += normalError;
+
+		error.maxTangentError = std::max(error.maxTangentError, AngleBetween(tangent, SafeNormalize(ReadVertexVec3(vertex, layout.tangentOffset), tangent)));
+		// also accounts for the source bitangent not being exactly orthogonal to the normal and tangent
+		error.maxBitangentError = std::max(error.maxBitangentError, AngleBetween(SafeNormalize(bitangent, bitangent), SafeNormalize(ReadVertexVec3(vertex, layout.bitangentOffset), bitangent)));
+	}
+
+	error.averagePositionError = static_cast<float>(positionErrorSum / packedVertices.size());
+	error.averageNormalError = static_cast<float>(normalErrorSum / packedVertices.size());
+	return error;
+}
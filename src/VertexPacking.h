@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "AssimpHelper.h"
+
+// Compact vertex, 20 bytes instead of the 68 bytes of the float layout.
+// The bitangent is rebuilt in the vertex shader as cross(normal, tangent) * sign.
+struct PackedVertexData
+{
+	uint16_t position[4];	// xyz: unorm16 inside the mesh bounds, w: bitangent sign (0 = -1, 65535 = +1)
+	uint16_t uv[2];			// half floats
+	int16_t normal[2];		// octahedral, snorm16
+	int16_t tangent[2];		// octahedral, snorm16
+};
+
+// Dequantization of the packed positions: position = boundsMin + packed.xyz * boundsExtent
+struct PackedVertexBounds
+{
+	glm::vec3 boundsMin = glm::vec3(0.0f);
+	glm::vec3 boundsExtent = glm::vec3(0.0f);
+};
+
+// Precision lost by the packing, measured against the float vertices
+struct VertexPackingError
+{
+	float maxPositionError = 0.0f;		// world units
+	float averagePositionError = 0.0f;
+	float maxUVError = 0.0f;
+	float maxNormalError = 0.0f;		// degrees
+	float averageNormalError = 0.0f;
+	float maxTangentError = 0.0f;
+	float maxBitangentError = 0.0f;
+};
+
+class VertexPacking
+{
+public:
+	// Packs float vertices described by layout (position, uv, normal, tangent and bitangent must be present)
+	static PackedVertexBounds PackVertices(const unsigned char* vertexData, const VertexLayout& layout, size_t vertexCount, std::vector<PackedVertexData>& packedVertices);
+
+	// Decodes the packed vertices the same way shader.vs does and compares them with the originals
+	static VertexPackingError MeasureError(const unsigned char* vertexData, const VertexLayout& layout, const std::vector<PackedVertexData>& packedVertices, const PackedVertexBounds& bounds);
+
+	static glm::vec2 OctahedralEncode(const glm::vec3& direction);
+	static glm::vec3 OctahedralDecode(const glm::vec2& encoded);
+};
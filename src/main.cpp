@@ -4,27 +4,53 @@
 #include <iostream> // cout
 
 #include <vector>
+#include <cstddef> // offsetof
+#include <algorithm>
+#include <memory>
 
-// read shader file
 #include <string>
-#include <fstream>
-#include <sstream>
-#include <iostream>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "AssetLoader.h"
 #include "AssimpHelper.h"
+#include "FileWatcher.h"
+#include "PixelUploadRing.h"
+#include "ShaderProgramCache.h"
+#include "ShaderVariantCache.h"
+#include "TextureArrayBuilder.h"
+#include "TextureLoader.h"
+#include "TextureRegistry.h"
+#include "UniformBlocks.h"
+#include "UniformBufferRing.h"
+#include "VertexPacking.h"
 #include "camera.h"
 
-// http://stackoverflow.com/questions/24088002/stb-image-h-in-visual-studio-unresolved-external-symbol
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb/stb_image.h>
-
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
+// asset uploads: GL thread time spent on them per frame, and size of one buffer or texture slice
+const double UPLOAD_BUDGET_SECONDS = 0.002;
+const size_t UPLOAD_SLICE_BYTES = 1 << 20;
+
+// streamed textures: GPU memory their levels may take, released from the least needed textures beyond it
+const size_t TEXTURE_MEMORY_BUDGET_BYTES = 64 << 20;
+
+// texture uploads: pixel buffer the slices are copied to, a few frames worth of them
+const size_t UPLOAD_RING_BYTES = 8 * UPLOAD_SLICE_BYTES;
+
+// shared textures: memory the unused ones may keep cached, the least recently used are deleted beyond it
+const size_t TEXTURE_REGISTRY_BUDGET_BYTES = 32 << 20;
+
+// material arrays: size of their layers (the 1K texture sets) and number of materials they hold
+const uint32_t MATERIAL_ARRAY_LAYER_SIZE = 1024;
+const uint32_t MATERIAL_ARRAY_LAYERS = 5;
+
+// uniform blocks written each frame: the frame block and one object block per draw, 256 bytes apart on most drivers
+const size_t UNIFORM_RING_FRAME_BYTES = 256 << 10;
+
 glm::mat4 model;
 glm::mat4 projection;
 
@@ -43,181 +69,34 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
 
-///////////////////// STBI HELPERS FUNCTIONS //////////////////////////////////////////////////////////////////////////////
-unsigned char* LoadImage(
-	const char* absoluteFilePath,
-	int& x,
-	int& y,
-	int& channels_in_file,
-	const unsigned int& desired_channels,
-	const bool& flip_vertically)
-{
-	// Basic usage (see HDR discussion below for HDR usage):
-	//    int x,y,n;
-	//    unsigned char *data = stbi_load(filename, &x, &y, &n, 0);
-	//    // ... process data if not NULL ...
-	//    // ... x = width, y = height, n = # 8-bit components per pixel ...
-	//    // ... replace '0' with '1'..'4' to force that many components per pixel
-	//    // ... but 'n' will always be the number that it would have been if you said 0
-	//    stbi_image_free(data)
-
-	stbi_set_flip_vertically_on_load(flip_vertically);
-
-	int _x = 0;
-	int _y = 0;
-	int _channels_in_file = 0;
-
-	unsigned char* buffer = stbi_load(absoluteFilePath, &_x, &_y, &_channels_in_file, desired_channels);
-	if (buffer == nullptr)
-	{
-		std::cout << "failed to load texture: " << absoluteFilePath << std::endl;
-		return nullptr;
-	}
-
-	x = _x;
-	y = _y;
-	channels_in_file = _channels_in_file;
-
-	return buffer;
-}
-
-void FreeImage(unsigned char* pixelsData)
-{
-	stbi_image_free(pixelsData);
-}
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-///////////////////// GENERAL GL SHADERS HELPERS FUNCTIONS //////////////////////////////////////////////////////////////////////////////
-const std::string ReadShader(const char* shaderPath)
-{
-	// 1. retrieve the vertex/fragment source code from filePath
-	std::string shaderString;
-	std::ifstream shaderFile;
-
-	// ensure ifstream objects can throw exceptions:
-	shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	try
-	{
-		// open files
-		shaderFile.open(shaderPath);
-		std::stringstream shaderStream;
-		// read file's buffer contents into streams
-		shaderStream << shaderFile.rdbuf();
-		// close file handlers
-		shaderFile.close();
-		// convert stream into string
-		shaderString = shaderStream.str();
-	}
-	catch (std::ifstream::failure e)
-	{
-		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-	}
-
-	return shaderString;
-}
-
-int CreateCompileAndLinkShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource)
-{
-	// https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glCreateShader.xhtml
-	int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-	glCompileShader(vertexShader);
-	// check for shader compile errors
-	int success;
-	char infoLog[512];
-	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-	if (!success)
-	{
-		glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-		return -1;
-	}
-
-	// fragment shader
-	int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-	glCompileShader(fragmentShader);
-	// check for shader compile errors
-	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-	if (!success)
-	{
-		glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-		return -1;
-	}
-
-	// link shaders
-	int shaderProgram = glCreateProgram();
-	glAttachShader(shaderProgram, vertexShader);
-	glAttachShader(shaderProgram, fragmentShader);
-	glLinkProgram(shaderProgram);
-	// check for linking errors
-	glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-	if (!success)
-	{
-		glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-		return -1;
-	}
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
-
-	return shaderProgram;
-}
-///////////////////// GENERAL GL TEXTURE HELPERS FUNCTIONS //////////////////////////////////////////////////////////////////////////////
-void CreateGLTexture(unsigned int& texture)
+///////////////////// GENERAL GL BUFFERS HELPERS FUNCTIONS //////////////////////////////////////////////////////////////////////////////
+// Allocates the storage of buffer, its content is written by CreateBufferUploadStep
+void AllocateGLBuffer(unsigned int buffer, size_t size)
 {
-	glGenTextures(1, &texture);
-	glBindTexture(GL_TEXTURE_2D, texture); // all upcoming GL_TEXTURE_2D operations now have effect on this texture object
-	{
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	// set texture wrapping to GL_REPEAT (default wrapping method)
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	}
-	glBindTexture(GL_TEXTURE_2D, 0);
+	// GL_COPY_WRITE_BUFFER doesn't touch the element array binding of the bound VAO
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
 }
 
-/// <summary>
-/// 
-/// </summary>
-/// <param name="texture"> The texture </param>
-/// <param name="width"> Specifies the width of the texture image. All implementations support texture images that are at least 1024 texels wide. </param>
-/// <param name="height"> Specifies the height of the texture image, or the number of layers in a texture array, in the case of the GL_TEXTURE_1D_ARRAY and GL_PROXY_TEXTURE_1D_ARRAY targets. All implementations support 2D texture images that are at least 1024 texels high, and texture arrays that are at least 256 layers deep. </param>
-/// <param name="internalformat"> Specifies the number of color components in the texture. Must be one of base internal formats given in Table 1, one of the sized internal formats given in Table 2, or one of the compressed internal formats given in Table 3, below. </param>
-/// <param name="format"> Specifies the format of the pixel data. The following symbolic values are accepted: GL_RED, GL_RG, GL_RGB, GL_BGR, GL_RGBA, GL_BGRA, GL_RED_INTEGER, GL_RG_INTEGER, GL_RGB_INTEGER, GL_BGR_INTEGER, GL_RGBA_INTEGER, GL_BGRA_INTEGER, GL_STENCIL_INDEX, GL_DEPTH_COMPONENT, GL_DEPTH_STENCIL. </param>
-/// <param name="type"> Specifies the data type of the pixel data. The following symbolic values are accepted: GL_UNSIGNED_BYTE, GL_BYTE, GL_UNSIGNED_SHORT, GL_SHORT, GL_UNSIGNED_INT, GL_INT, GL_HALF_FLOAT, GL_FLOAT, GL_UNSIGNED_BYTE_3_3_2, GL_UNSIGNED_BYTE_2_3_3_REV, GL_UNSIGNED_SHORT_5_6_5, GL_UNSIGNED_SHORT_5_6_5_REV, GL_UNSIGNED_SHORT_4_4_4_4, GL_UNSIGNED_SHORT_4_4_4_4_REV, GL_UNSIGNED_SHORT_5_5_5_1, GL_UNSIGNED_SHORT_1_5_5_5_REV, GL_UNSIGNED_INT_8_8_8_8, GL_UNSIGNED_INT_8_8_8_8_REV, GL_UNSIGNED_INT_10_10_10_2, and GL_UNSIGNED_INT_2_10_10_10_REV. </param>
-/// <param name="pixelsData"></param>
-/// <returns></returns>
-void SetImageToGLTexture(
-	unsigned int texture,
-	const int width,
-	const int height,
-	GLint internalformat,
-	GLenum format,
-	GLenum type,
-	const void* pixelsData,
-	const bool generateMipMaps = false)
+// Upload step writing size bytes of data at offset in buffer, UPLOAD_SLICE_BYTES per call so a large mesh spreads over several frames.
+// data must stay alive until the step is done.
+AssetLoader::UploadStep CreateBufferUploadStep(unsigned int buffer, size_t offset, const void* data, size_t size)
 {
-	// https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glTexImage2D.xhtml
-	if (pixelsData == nullptr)
-	{
-		return;
-	}
-
-	glBindTexture(GL_TEXTURE_2D, texture); // all upcoming GL_TEXTURE_2D operations now have effect on this texture object
+	size_t uploadedSize = 0;
+	return [=]() mutable
 	{
-		glTexImage2D(GL_TEXTURE_2D, 0, internalformat, width, height, 0, format, type, pixelsData);
-		if (generateMipMaps)
+		const size_t sliceSize = std::min(size - uploadedSize, UPLOAD_SLICE_BYTES);
+		if (sliceSize > 0)
 		{
-			glGenerateMipmap(GL_TEXTURE_2D);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+			glBufferSubData(GL_COPY_WRITE_BUFFER, offset + uploadedSize, sliceSize, static_cast<const unsigned char*>(data) + uploadedSize);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			uploadedSize += sliceSize;
 		}
-	}
-	glBindTexture(GL_TEXTURE_2D, 0);
+		return uploadedSize == size;
+	};
 }
-
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 int main()
@@ -258,6 +137,9 @@ int main()
 
 	glEnable(GL_DEPTH_TEST);
 
+	// stb_image rows are tightly packed
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
 	struct VertexData
 	{
 		glm::vec3 position;
@@ -268,44 +150,89 @@ int main()
 		glm::vec3 bitangent;
 	};
 
-	std::vector<glm::vec3> positions;
-	std::vector<glm::vec2> uvs;
-	std::vector<glm::vec3> normals;
-	std::vector<glm::vec3> tangents;
-	std::vector<glm::vec3> bitangents;
-	std::vector<unsigned int> indices;
-	
+	// Describe VertexData so the importer writes straight into it
+	VertexLayout vertexLayout;
+	vertexLayout.stride = sizeof(VertexData);
+	vertexLayout.positionOffset = offsetof(VertexData, position);
+	vertexLayout.colorOffset = offsetof(VertexData, color);
+	vertexLayout.uvOffset = offsetof(VertexData, uv);
+	vertexLayout.normalOffset = offsetof(VertexData, normal);
+	vertexLayout.tangentOffset = offsetof(VertexData, tangent);
+	vertexLayout.bitangentOffset = offsetof(VertexData, bitangent);
+
 	//const std::string modelPath = "../res/models/Monkey.fbx";
 	//const std::string modelPath = "../res/models/ShaderBall.fbx";
 	const std::string modelPath = "../res/models/Plane.fbx";
 
-	if (!AssimpHelper::ImportMesh(modelPath, positions, uvs, normals, indices, tangents, bitangents))
-	{
-		// LOG ERROR!
-	}
+	// Scene import: keep the node hierarchy, transforms and materials of the file and draw every submesh on its own.
+	// Meshlet culling and levels of detail only apply to the single mesh import.
+	const bool useSceneImport = false;
+
+	// Meshlet culling: draw only the clusters inside the frustum and not facing away from the camera
+	const bool useMeshletCulling = false;
+
+	// Levels of detail: draw a simplified index range when the camera is far enough for the difference to stay under a pixel
+	const bool useLods = false;
+
+	// Packed vertices (PackedVertexData): 20 bytes per vertex instead of 68, decoded in shader.vs
+	const bool usePackedVertices = false;
 
-	std::vector<VertexData> vertices = std::vector<VertexData>(positions.size());
-	for (size_t n = 0; n < positions.size(); ++n)
+	// Texture streaming: the material textures start from their 64x64 mip tail, the finer levels come in as the camera gets closer
+	const bool useTextureStreaming = true;
+
+	// Upload ring: texture slices are copied to a persistently mapped pixel buffer, the driver reads them from there asynchronously
+	const bool useUploadRing = true;
+
+	// Material array: the texture sets are packed in texture arrays, one layer each. The mesh is drawn once per loaded set, side by side,
+	// in one instanced draw picking its layer per instance, without texture rebinds. With the scene import each draw picks the layer
+	// of its material instead. The arrays are not streamed.
+	const bool useMaterialArray = false;
+	const bool useMaterialInstances = useMaterialArray && !useSceneImport;
+
+	// Import report: stage timings and sizes are printed once the mesh is uploaded, this also writes them as JSON next to the model
+	const bool writeImportReport = false;
+
+	// Program binary cache: the linked shader program is stored on disk, the next launches load it instead of compiling the sources
+	const bool useProgramBinaryCache = true;
+
+	// Shader hot reload: saving a file of res/shaders rebuilds the program in the background, the last good one draws meanwhile
+	const bool useShaderHotReload = true;
+
+	// Specular highlights, the variant without them skips the Blinn term
+	const bool useSpecular = true;
+
+	// Everything the mesh import produces. Filled on a worker, the render loop only reads it once its upload set isReady.
+	struct MeshAsset
 	{
-		vertices[n].position = positions[n];
-		vertices[n].uv = uvs[n];
-		vertices[n].color = glm::vec3();
-		vertices[n].normal = normals[n];
-		vertices[n].tangent = tangents[n];
-		vertices[n].bitangent = bitangents[n];
-	}
+		std::vector<unsigned char> vertices;
+		std::vector<unsigned int> indices;
+		MeshImportReport importReport;
+		SceneData scene;
+		MeshletData meshletData;
+		MeshLodChain lodChain;
+		std::vector<PackedVertexData> packedVertices;
+		PackedVertexBounds packedVertexBounds;
+		VertexPackingError packingError;
+		// bounding sphere of the vertices, in model units
+		glm::vec3 boundsCenter = glm::vec3(0.0f);
+		float boundsRadius = 0.0f;
+		bool isReady = false;
+	};
+	MeshAsset mesh;
 
 	unsigned int IBO;
-	{ // Create IBO (INDEX BUFFER OBJECT)
+	{ // Create IBO (INDEX BUFFER OBJECT), its storage is allocated by the mesh upload
 		glGenBuffers(1, &IBO);
+	}
 
-		// Bind IBO
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
-		{
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices[0]) * indices.size(), indices.data(), GL_STATIC_DRAW);
-		}
-		// Unbind IBO
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	// Index buffer rewritten every frame with the indices of the visible meshlets, allocated once the mesh is loaded for
+	// all of its indices
+	unsigned int culledIBO = 0;
+	size_t culledIBOSize = 0;
+	std::vector<unsigned int> culledIndices;
+	if (useMeshletCulling)
+	{
+		glGenBuffers(1, &culledIBO);
 	}
 
 	// Step 2: Creates a VBO (Vertex buffer object)
@@ -313,15 +240,15 @@ int main()
 	glGenBuffers(1, &VBO);
 
 	// Step 3: Store the geometry data into the buffer data
-	// a: Bind the VBO
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	// Done by the mesh upload once the import finished (see CreateBufferUploadStep)
+
+	// Offset and layer of every material array instance, rewritten when a layer is loaded
+	unsigned int instanceVBO = 0;
+	std::vector<glm::vec4> materialInstances;
+	if (useMaterialInstances)
 	{
-		// b: Store geometry data into the buffer data using "glBufferData"
-		// https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glBufferData.xhtml
-		//glBufferData(GL_ARRAY_BUFFER, sizeof(vertexData[0]) * vertexData.size(), &vertexData[0], GL_STATIC_DRAW);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices[0]) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+		glGenBuffers(1, &instanceVBO);
 	}
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
 	// Step 4: Creates a VAO (Vertex array object):
 	unsigned int VAO;
@@ -336,127 +263,282 @@ int main()
 		// https://stackoverflow.com/questions/3665671/is-vertexattribpointer-needed-after-each-bindbuffer
 		glBindBuffer(GL_ARRAY_BUFFER, VBO);
 		{
-			// https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glVertexAttribPointer.xhtml
-			// position attribute
-			GLsizei bytesPerVertex = sizeof(VertexData);
-
-			void* offset = (void*)0;
-			glEnableVertexAttribArray(0);
-			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, bytesPerVertex, offset);
-
-			// color attribute
-			offset = (void*)(3 * sizeof(float));
-			glEnableVertexAttribArray(1);
-			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, bytesPerVertex, offset);
-
-			// uvs attribute
-			offset = (void*)(6 * sizeof(float));
-			glEnableVertexAttribArray(2);
-			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, bytesPerVertex, offset);
-
-			// normal attribute
-			offset = (void*)(8 * sizeof(float));
-			glEnableVertexAttribArray(3);
-			glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, bytesPerVertex, offset);
-
-			// tangent attribute
-			offset = (void*)(11 * sizeof(float));
-			glEnableVertexAttribArray(4);
-			glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, bytesPerVertex, offset);
-
-			// bitangent attribute
-			offset = (void*)(14 * sizeof(float));
-			glEnableVertexAttribArray(5);
-			glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, bytesPerVertex, offset);
+			if (usePackedVertices)
+			{
+				// https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glVertexAttribPointer.xhtml
+				GLsizei bytesPerVertex = sizeof(PackedVertexData);
+
+				// position attribute (normalized to [0, 1] inside the mesh bounds, w = bitangent sign)
+				glEnableVertexAttribArray(0);
+				glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, bytesPerVertex, (void*)offsetof(PackedVertexData, position));
+
+				// uvs attribute (half floats)
+				glEnableVertexAttribArray(2);
+				glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, bytesPerVertex, (void*)offsetof(PackedVertexData, uv));
+
+				// normal attribute (octahedral, normalized to [-1, 1])
+				glEnableVertexAttribArray(3);
+				glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, bytesPerVertex, (void*)offsetof(PackedVertexData, normal));
+
+				// tangent attribute (octahedral, normalized to [-1, 1])
+				glEnableVertexAttribArray(4);
+				glVertexAttribPointer(4, 2, GL_SHORT, GL_TRUE, bytesPerVertex, (void*)offsetof(PackedVertexData, tangent));
+			}
+			else
+			{
+				// https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glVertexAttribPointer.xhtml
+				// position attribute
+				GLsizei bytesPerVertex = sizeof(VertexData);
+
+				void* offset = (void*)0;
+				glEnableVertexAttribArray(0);
+				glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, bytesPerVertex, offset);
+
+				// color attribute
+				offset = (void*)(3 * sizeof(float));
+				glEnableVertexAttribArray(1);
+				glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, bytesPerVertex, offset);
+
+				// uvs attribute
+				offset = (void*)(6 * sizeof(float));
+				glEnableVertexAttribArray(2);
+				glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, bytesPerVertex, offset);
+
+				// normal attribute
+				offset = (void*)(8 * sizeof(float));
+				glEnableVertexAttribArray(3);
+				glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, bytesPerVertex, offset);
+
+				// tangent attribute
+				offset = (void*)(11 * sizeof(float));
+				glEnableVertexAttribArray(4);
+				glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, bytesPerVertex, offset);
+
+				// bitangent attribute
+				offset = (void*)(14 * sizeof(float));
+				glEnableVertexAttribArray(5);
+				glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, bytesPerVertex, offset);
+			}
+		}
+
+		// instance attribute (offset, material array layer), advances once per instance
+		if (useMaterialInstances)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+			glEnableVertexAttribArray(6);
+			glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0);
+			glVertexAttribDivisor(6, 1);
 		}
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 	glBindVertexArray(0);
 
-	int shaderProgram = -1;
+	// Program binaries, kept for the reloads
+	std::unique_ptr<ShaderProgramCache> programCache;
+	if (useProgramBinaryCache)
+	{
+		programCache = std::make_unique<ShaderProgramCache>("../res/shaders/cache");
+	}
+
+	// Step 0 Read, build and compile the Vertex & Fragment shaders program, destroyed before the context.
+	// One variant per combination of features, compiled in the background the first time it is drawn.
+	std::unique_ptr<ShaderVariantCache> shaderVariants = std::make_unique<ShaderVariantCache>("../res/shaders/shader.vs",
+		"../res/shaders/shader.fs", programCache.get());
+	// features of the variant in use, the normal map one waits for a normal map (the placeholder is flat)
+	uint32_t drawnFeatures = (useSpecular ? SHADER_FEATURE_SPECULAR : SHADER_FEATURE_NONE) |
+		(usePackedVertices ? SHADER_FEATURE_PACKED_VERTEX : SHADER_FEATURE_NONE) |
+		(useMaterialArray ? SHADER_FEATURE_MATERIAL_ARRAY | SHADER_FEATURE_NORMAL_MAP : SHADER_FEATURE_NONE);
 	{ // Create shader
-		{
-			// Step 0 Read, build and compile the Vertex & Fragment shaders program
-			const std::string vertexShaderSource = ReadShader("../res/shaders/shader.vs");
-			const std::string fragmentShaderSource = ReadShader("../res/shaders/shader.fs");
-			shaderProgram = CreateCompileAndLinkShaderProgram(vertexShaderSource.c_str(), fragmentShaderSource.c_str());
+		const double shaderStart = glfwGetTime();
+		shaderVariants->GetProgram(drawnFeatures, true);
+		std::cout << "Shader program ready after " << (glfwGetTime() - shaderStart) * 1000.0 << " ms"
+			<< (programCache && programCache->GetStatistics().hitCount > 0 ? " (cached binary)" : "") << std::endl;
+	}
 
-			// Link samplers?
-			{
-				glUseProgram(shaderProgram);
-				{
-					int albedoSamplerUniformLocation = glGetUniformLocation(shaderProgram, "albedoMap");
-					if (albedoSamplerUniformLocation != -1)
-					{
-						glUniform1i(albedoSamplerUniformLocation, 0);
-					}
+	std::unique_ptr<FileWatcher> shaderWatcher;
+	if (useShaderHotReload)
+	{
+		shaderWatcher = std::make_unique<FileWatcher>("../res/shaders");
+	}
 
-					int normalSamplerUniformLocation = glGetUniformLocation(shaderProgram, "normalMap");
-					if (normalSamplerUniformLocation != -1)
-					{
-						glUniform1i(normalSamplerUniformLocation, 1);
-					}
-				}
-				glUseProgram(0);
-			}
-		}
+	// Program drawn with and its uniforms, both replaced whenever a reload or another variant does
+	int shaderProgram = shaderVariants->GetProgram(drawnFeatures);
+	ShaderUniformTable* shaderUniforms = shaderVariants->GetUniforms(drawnFeatures);
+
+	// Channels of the packed texture of the material
+	MaterialDescriptor materialDescriptor;
+
+	// Declared before the loader, whose workers stage the decoded pixels in it
+	std::unique_ptr<PixelUploadRing> uploadRing;
+	if (useUploadRing)
+	{
+		uploadRing = std::make_unique<PixelUploadRing>(UPLOAD_RING_BYTES);
 	}
 
-	int transformUniformLocation = glGetUniformLocation(shaderProgram, "transform");
-	int projectionUniformLocation = glGetUniformLocation(shaderProgram, "projection");
-	int viewUniformLocation = glGetUniformLocation(shaderProgram, "view");
+	// Declared before the loader, whose pending uploads add textures to it
+	TextureStreamer textureStreamer(TEXTURE_MEMORY_BUDGET_BYTES);
 
-	int lightPositionUniformLocation = glGetUniformLocation(shaderProgram, "lightWorldPosition");
-	int lightColorUniformLocation = glGetUniformLocation(shaderProgram, "lightColor");
+	// Asset loading: import and decode on the workers while the loop below keeps presenting
+	AssetLoader assetLoader;
+	bool areAssetsLoaded = false;
 
-	int baseColorUniformLocation = glGetUniformLocation(shaderProgram, "baseColor");
+	// Shared textures, declared after the loader that uploads them and destroyed before the context
+	TextureStreamer* materialStreamer = useTextureStreaming ? &textureStreamer : nullptr;
+	std::unique_ptr<TextureRegistry> textureRegistry = std::make_unique<TextureRegistry>(assetLoader, TEXTURE_REGISTRY_BUDGET_BYTES,
+		UPLOAD_SLICE_BYTES, uploadRing.get(), materialStreamer);
 
-	int cameraPositionUniformLocation = glGetUniformLocation(shaderProgram, "cameraWorldPosition");
+	// Textures of the material, no texture until uploaded
+	TextureHandle materialTextures[MATERIAL_BINDING_COUNT];
 
-	unsigned int texture = 0;
+	// Placeholders (small, loaded right away) drawn until the material textures are uploaded, every material shares them
+	// the packed texture has no placeholder, materialDescriptor keeps the shader away from it until it is loaded
+	TextureHandle materialPlaceholders[MATERIAL_BINDING_COUNT];
+	materialPlaceholders[MATERIAL_BINDING_ALBEDO] = textureRegistry->AcquireImmediate("../res/textures/placeHolder.jpg", 3, MIP_GENERATION_SRGB);
+	materialPlaceholders[MATERIAL_BINDING_NORMAL] = textureRegistry->AcquireImmediate("../res/textures/default_normal.jpg", 3, MIP_GENERATION_NORMAL_MAP);
+
+	// Material array, a layer per texture set (the 2K one uses its 1K mip). Declared after the loader that uploads them
+	// and destroyed before the context. Every channel of its packed layers is filled, one descriptor fits them all.
+	std::unique_ptr<TextureArrayBuilder> materialArray;
+	// layer of every material of the scene, by scene material index
+	std::vector<float> sceneMaterialLayers;
+	if (useMaterialArray)
 	{
-		// Create and load texture:
-
-		CreateGLTexture(texture);
-
-		// Load the pixels data
-		int w;
-		int h;
-		int channelsCount;
-		const char* texturePath = "../res/textures/Tiles093_1K-PNG/Tiles093_1K_Color.png";
-		//const char* texturePath = "../res/textures/Ground035_1K-PNG/Ground035_1K_Color.png";
-		//const char* texturePath = "../res/textures/Gravel020_4K-PNG/Gravel020_4K_Color.png";
-		
-		unsigned char* pixelsData = LoadImage(texturePath, w, h, channelsCount, 3, false);
-		if (pixelsData != nullptr)
-		{
-			SetImageToGLTexture(texture, w, h, GL_RGB, GL_RGB, GL_UNSIGNED_BYTE, pixelsData);
-		}
-		FreeImage(pixelsData);
+		materialArray = std::make_unique<TextureArrayBuilder>(assetLoader, MATERIAL_ARRAY_LAYER_SIZE, MATERIAL_ARRAY_LAYER_SIZE,
+			MATERIAL_ARRAY_LAYERS, UPLOAD_SLICE_BYTES, uploadRing.get());
+		materialArray->AddMaterial("../res/textures/Tiles093_1K-PNG/Tiles093_1K");
+		materialArray->AddMaterial("../res/textures/Wood018_1K-PNG/Wood018_1K");
+		materialArray->AddMaterial("../res/textures/Bricks051_1K-PNG/Bricks051_1K");
+		materialArray->AddMaterial("../res/textures/Ground035_1K-PNG/Ground035_1K");
+		materialArray->AddMaterial("../res/textures/Gravel020_2K-PNG/Gravel020_2K");
+		materialDescriptor = TextureArrayBuilder::GetDescriptor();
 	}
 
-	unsigned int normalSampler = 0;
+	assetLoader.Load([&]() -> AssetLoader::UploadStep
 	{
-		// Create and load texture:
-
-		CreateGLTexture(normalSampler);
+		const uint32_t importFlags = MESH_IMPORT_OPTIMIZE |
+			(useMeshletCulling ? MESH_IMPORT_MESHLETS : MESH_IMPORT_NONE) |
+			(useLods ? MESH_IMPORT_LODS : MESH_IMPORT_NONE);
+		const bool isImported = useSceneImport ?
+			AssimpHelper::ImportScene(modelPath, vertexLayout, mesh.scene, mesh.vertices, mesh.indices, importFlags, &mesh.importReport) :
+			AssimpHelper::ImportMesh(modelPath, vertexLayout, mesh.vertices, mesh.indices, importFlags, &mesh.importReport, &mesh.meshletData, &mesh.lodChain);
+		if (!isImported)
+		{
+			// LOG ERROR!
+			return nullptr;
+		}
 
-		// Load the pixels data
-		int w;
-		int h;
-		int channelsCount;
-		const char* texturePath = "../res/textures/Tiles093_1K-PNG/Tiles093_1K_Normal.png";
-		//const char* texturePath = "../res/textures/Ground035_1K-PNG/Ground035_1K_Normal.png";
-		//const char* texturePath = "../res/textures/Gravel020_4K-PNG/Gravel020_4K_Normal.png";
+		// the texture streaming sizes the material on screen from the mesh bounds
+		const size_t vertexCount = mesh.vertices.size() / sizeof(VertexData);
+		const VertexData* vertexData = reinterpret_cast<const VertexData*>(mesh.vertices.data());
+		if (vertexCount > 0)
+		{
+			glm::vec3 boundsMin = vertexData[0].position;
+			glm::vec3 boundsMax = vertexData[0].position;
+			for (size_t v = 1; v < vertexCount; ++v)
+			{
+				boundsMin = glm::min(boundsMin, vertexData[v].position);
+				boundsMax = glm::max(boundsMax, vertexData[v].position);
+			}
+			mesh.boundsCenter = (boundsMin + boundsMax) * 0.5f;
+			for (size_t v = 0; v < vertexCount; ++v)
+			{
+				mesh.boundsRadius = std::max(mesh.boundsRadius, glm::length(vertexData[v].position - mesh.boundsCenter));
+			}
+		}
 
-		unsigned char* pixelsData = LoadImage(texturePath, w, h, channelsCount, 3, false);
-		if (pixelsData != nullptr)
+		if (usePackedVertices)
 		{
-			SetImageToGLTexture(normalSampler, w, h, GL_RGB, GL_RGB, GL_UNSIGNED_BYTE, pixelsData);
+			mesh.packedVertexBounds = VertexPacking::PackVertices(mesh.vertices.data(), vertexLayout, mesh.vertices.size() / sizeof(VertexData), mesh.packedVertices);
+			mesh.packingError = VertexPacking::MeasureError(mesh.vertices.data(), vertexLayout, mesh.packedVertices, mesh.packedVertexBounds);
+
+			// the float vertices are not needed anymore
+			std::vector<unsigned char>().swap(mesh.vertices);
 		}
-		FreeImage(pixelsData);
-	}
 
+		const void* vertexBufferData = usePackedVertices ? static_cast<const void*>(mesh.packedVertices.data()) : mesh.vertices.data();
+		const size_t vertexBufferSize = usePackedVertices ? sizeof(PackedVertexData) * mesh.packedVertices.size() : mesh.vertices.size();
+		const size_t indexBufferSize = sizeof(unsigned int) * mesh.indices.size();
+		const size_t lodIndexBufferSize = sizeof(unsigned int) * mesh.lodChain.indices.size();
+
+		const AssetLoader::UploadStep uploadBuffers = AssetLoader::Sequence({
+			[=]()
+			{
+				AllocateGLBuffer(VBO, vertexBufferSize);
+				// the levels of detail follow the full resolution indices (see MeshLodChain)
+				AllocateGLBuffer(IBO, indexBufferSize + lodIndexBufferSize);
+				return true;
+			},
+			CreateBufferUploadStep(VBO, 0, vertexBufferData, vertexBufferSize),
+			CreateBufferUploadStep(IBO, 0, mesh.indices.data(), indexBufferSize),
+			CreateBufferUploadStep(IBO, indexBufferSize, mesh.lodChain.indices.data(), lodIndexBufferSize),
+		});
+
+		return [&, uploadBuffers]()
+		{
+			const double uploadStart = glfwGetTime();
+			const bool isUploaded = uploadBuffers();
+			mesh.importReport.uploadTime += (glfwGetTime() - uploadStart) * 1000.0;
+			if (!isUploaded)
+			{
+				return false;
+			}
+
+			mesh.importReport.Print(std::cout);
+			if (writeImportReport)
+			{
+				mesh.importReport.WriteJson(modelPath + ".import.json");
+			}
+
+			if (useSceneImport)
+			{
+				std::cout << "Scene: " << mesh.scene.GetNodeCount() << " nodes, " << mesh.scene.GetSubmeshCount() << " submeshes, "
+					<< mesh.scene.GetDrawCount() << " draws, " << mesh.scene.GetMaterialCount() << " materials" << std::endl;
+
+				// the materials whose textures are not in the array use its first layer
+				for (size_t material = 0; material < mesh.scene.GetMaterialCount() && materialArray; ++material)
+				{
+					int layer = materialArray->FindMaterial(mesh.scene.materialAlbedoTextures[material]);
+					layer = layer >= 0 ? layer : materialArray->FindMaterial(mesh.scene.materialNormalTextures[material]);
+					sceneMaterialLayers.push_back(static_cast<float>(std::max(layer, 0)));
+				}
+			}
+
+			for (size_t level = 0; level < mesh.lodChain.levels.size(); ++level)
+			{
+				std::cout << "LOD " << level << ": " << mesh.lodChain.levels[level].indexCount / 3 << " triangles, error " << mesh.lodChain.levels[level].error << std::endl;
+			}
+
+			if (usePackedVertices)
+			{
+				const VertexPackingError& packingError = mesh.packingError;
+				std::cout << "Vertex packing: " << sizeof(VertexData) << " -> " << sizeof(PackedVertexData) << " bytes per vertex"
+					<< ", position error max " << packingError.maxPositionError << " avg " << packingError.averagePositionError
+					<< ", uv error max " << packingError.maxUVError
+					<< ", normal error max " << packingError.maxNormalError << " deg avg " << packingError.averageNormalError << " deg"
+					<< ", tangent error max " << packingError.maxTangentError << " deg"
+					<< ", bitangent error max " << packingError.maxBitangentError << " deg" << std::endl;
+			}
+
+			if (culledIBO != 0)
+			{
+				culledIndices.reserve(mesh.indices.size());
+				culledIBOSize = sizeof(unsigned int) * mesh.indices.size();
+				glBindBuffer(GL_COPY_WRITE_BUFFER, culledIBO);
+				glBufferData(GL_COPY_WRITE_BUFFER, culledIBOSize, nullptr, GL_STREAM_DRAW);
+				glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			}
+			mesh.isReady = true;
+			return true;
+		};
+	});
+
+	// every map of the set is decoded concurrently, the maps missing from the set keep their placeholder
+	if (!useMaterialArray)
+	{
+		textureRegistry->AcquireMaterial("../res/textures/Tiles093_1K-PNG/Tiles093_1K", materialTextures, materialDescriptor);
+		//textureRegistry->AcquireMaterial("../res/textures/Ground035_1K-PNG/Ground035_1K", materialTextures, materialDescriptor);
+		//textureRegistry->AcquireMaterial("../res/textures/Gravel020_4K-PNG/Gravel020_4K", materialTextures, materialDescriptor);
+	}
 
 	// Lighting
 	glm::vec3 lightPosition = glm::vec3(-4.0f, 2.0f, 4.0f);
@@ -465,6 +547,28 @@ int main()
 	// Material
 	glm::vec3 baseColor = glm::vec3(1.0f, 1.0f, 1.0f);
 
+	// Uniform blocks of every draw, written once per frame whatever the program, destroyed before the context
+	std::unique_ptr<UniformBufferRing> uniformRing = std::make_unique<UniformBufferRing>(UNIFORM_RING_FRAME_BYTES);
+
+	// Writes the object block of the next draw and binds it, false when the frame is full (the draw is skipped then)
+	auto bindObjectUniforms = [&](const glm::mat4& transform, const glm::vec3& color) -> bool
+	{
+		ObjectUniforms objectUniforms;
+		objectUniforms.transform = transform;
+		objectUniforms.baseColor = color;
+		objectUniforms.occlusionChannel = materialDescriptor.occlusionChannel;
+		objectUniforms.roughnessChannel = materialDescriptor.roughnessChannel;
+		objectUniforms.displacementChannel = materialDescriptor.displacementChannel;
+
+		UniformBufferRegion objectRegion;
+		if (!uniformRing->Write(&objectUniforms, sizeof(objectUniforms), objectRegion))
+		{
+			return false;
+		}
+		uniformRing->Bind(UNIFORM_BLOCK_OBJECT, objectRegion);
+		return true;
+	};
+
 	// Loop
 	while (!glfwWindowShouldClose(window))
 	{
@@ -480,6 +584,48 @@ int main()
 			processInput(window);
 		}
 
+		// Shader hot reload and variants
+		{
+			if (shaderWatcher)
+			{
+				for (const std::string& path : shaderWatcher->Poll())
+				{
+					shaderVariants->OnFileChanged(path);
+				}
+			}
+			shaderVariants->Update();
+
+			uint32_t features = drawnFeatures & ~SHADER_FEATURE_NORMAL_MAP;
+			if (useMaterialArray || materialTextures[MATERIAL_BINDING_NORMAL].GetTexture() != 0)
+			{
+				features |= SHADER_FEATURE_NORMAL_MAP;
+			}
+			// the previous variant draws until the new one is compiled
+			if (shaderVariants->GetProgram(features) != -1)
+			{
+				drawnFeatures = features;
+			}
+			shaderProgram = shaderVariants->GetProgram(drawnFeatures);
+			shaderUniforms = shaderVariants->GetUniforms(drawnFeatures);
+		}
+
+		// Asset uploads, the placeholders are drawn until they are done
+		{
+			assetLoader.ProcessUploads(UPLOAD_BUDGET_SECONDS);
+			if (!areAssetsLoaded && assetLoader.GetPendingCount() == 0)
+			{
+				areAssetsLoaded = true;
+				std::cout << "Assets loaded after " << glfwGetTime() << " s" << std::endl;
+
+				if (materialArray)
+				{
+					const TextureArrayStatistics statistics = materialArray->GetStatistics();
+					std::cout << "Material array: " << statistics.loadedLayerCount << "/" << statistics.maxLayers << " layers, "
+						<< (statistics.gpuBytes >> 20) << " MB, " << statistics.defaultedMapCount << " maps replaced by their default" << std::endl;
+				}
+			}
+		}
+
 		// Update
 		{
 			// Update the projection matrix each frame based on the camera zoom
@@ -500,6 +646,83 @@ int main()
 
 		const glm::mat4 view = camera.GetViewMatrix();
 
+		// Texture streaming: the material covers at most the mesh on screen
+		{
+			if (mesh.isReady)
+			{
+				const float screenSize = TextureStreamer::ComputeScreenSize(mesh.boundsCenter, mesh.boundsRadius, model, cameraPosition,
+					glm::radians(camera.Zoom), (float)SCR_HEIGHT);
+				for (uint32_t binding = 0; binding < MATERIAL_BINDING_COUNT; ++binding)
+				{
+					textureStreamer.RequestScreenSize(materialTextures[binding].GetTexture(), screenSize);
+				}
+			}
+			textureStreamer.Update(UPLOAD_SLICE_BYTES);
+		}
+
+		// Material array instances: a copy of the mesh per loaded layer, side by side along x
+		if (useMaterialInstances && mesh.isReady)
+		{
+			std::vector<int> loadedLayers;
+			for (uint32_t layer = 0; layer < materialArray->GetLayerCount(); ++layer)
+			{
+				if (materialArray->IsLayerLoaded(static_cast<int>(layer)))
+				{
+					loadedLayers.push_back(static_cast<int>(layer));
+				}
+			}
+
+			// layers are never unloaded, a new count means a new layer
+			if (loadedLayers.size() != materialInstances.size())
+			{
+				const float spacing = mesh.boundsRadius * 2.5f;
+				materialInstances.clear();
+				for (size_t n = 0; n < loadedLayers.size(); ++n)
+				{
+					const float x = (static_cast<float>(n) - static_cast<float>(loadedLayers.size() - 1) * 0.5f) * spacing;
+					materialInstances.push_back(glm::vec4(x, 0.0f, 0.0f, static_cast<float>(loadedLayers[n])));
+				}
+				glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+				glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec4) * materialInstances.size(), materialInstances.data(), GL_STATIC_DRAW);
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+			}
+		}
+
+		// fences the slices uploaded this frame, the room of those the GPU has read is reused
+		if (uploadRing)
+		{
+			uploadRing->Update();
+		}
+
+		// the shared textures no handle uses are evicted over the budget
+		textureRegistry->Update();
+
+		// Level of detail
+		size_t lod = 0;
+		size_t firstIndexToDraw = 0;
+		size_t indicesToDraw = mesh.isReady ? mesh.indices.size() : 0;
+		if (useLods && mesh.isReady && !mesh.lodChain.levels.empty())
+		{
+			lod = MeshSimplifier::SelectLod(mesh.lodChain, model, cameraPosition, glm::radians(camera.Zoom), (float)SCR_HEIGHT);
+			firstIndexToDraw = mesh.lodChain.levels[lod].indexOffset;
+			indicesToDraw = mesh.lodChain.levels[lod].indexCount;
+		}
+
+		// Meshlet culling (the meshlets only cover the full resolution mesh)
+		const bool drawCulledMeshlets = useMeshletCulling && !useSceneImport && mesh.isReady && lod == 0;
+		if (drawCulledMeshlets)
+		{
+			MeshletBuilder::CullMeshlets(mesh.meshletData, model, view, projection, cameraPosition, culledIndices);
+			indicesToDraw = culledIndices.size();
+
+			// orphan the previous frame storage instead of waiting for the GPU to be done with it, at the same size so that
+			// the driver can recycle it. GL_COPY_WRITE_BUFFER doesn't touch the element array binding of the bound VAO.
+			glBindBuffer(GL_COPY_WRITE_BUFFER, culledIBO);
+			glBufferData(GL_COPY_WRITE_BUFFER, culledIBOSize, nullptr, GL_STREAM_DRAW);
+			glBufferSubData(GL_COPY_WRITE_BUFFER, 0, sizeof(unsigned int) * culledIndices.size(), culledIndices.data());
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		}
+
 		// Render Pass
 		{
 			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -509,36 +732,112 @@ int main()
 			glBindVertexArray(VAO);
 			{
 				glBindBuffer(GL_ARRAY_BUFFER, VBO);
-				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, drawCulledMeshlets ? culledIBO : IBO);
 				{
-					glUseProgram(shaderProgram);
+					// Frame uniform block, shared by the programs and draws of the frame. Nothing is drawn without it.
+					uniformRing->BeginFrame();
+					bool isFrameBound = false;
 					{
-						// Update shader uniforms
+						FrameUniforms frameUniforms;
+						frameUniforms.view = view;
+						frameUniforms.projection = projection;
+						frameUniforms.viewProjection = projection * view;
+						frameUniforms.cameraWorldPosition = cameraPosition;
+
+						// Ligthing
+						frameUniforms.lightWorldPosition = lightPosition;
+						frameUniforms.lightColor = lightColor;
+
+						UniformBufferRegion frameRegion;
+						if (uniformRing->Write(&frameUniforms, sizeof(frameUniforms), frameRegion))
 						{
-							glUniformMatrix4fv(transformUniformLocation, 1, GL_FALSE, &model[0][0]);
-							glUniformMatrix4fv(projectionUniformLocation, 1, GL_FALSE, &projection[0][0]);
-							glUniformMatrix4fv(viewUniformLocation, 1, GL_FALSE, &view[0][0]);
-
-							glUniform3f(baseColorUniformLocation, baseColor.x, baseColor.y, baseColor.z);
-
-							glUniform3f(cameraPositionUniformLocation, cameraPosition.x, cameraPosition.y, cameraPosition.z);
-
-							// Ligthing
-							glUniform3f(lightPositionUniformLocation, lightPosition.x, lightPosition.y, lightPosition.z);
-							glUniform3f(lightColorUniformLocation, lightColor.x, lightColor.y, lightColor.z);
+							uniformRing->Bind(UNIFORM_BLOCK_FRAME, frameRegion);
+							isFrameBound = true;
 						}
+					}
 
-						{ // Bind the textures
-							glActiveTexture(GL_TEXTURE0);
-							glBindTexture(GL_TEXTURE_2D, texture);
+					glUseProgram(shaderProgram);
+					{
+						// Update shader uniforms, only those whose value changed since the last draw with the program are uploaded
+						if (shaderUniforms)
+						{
+							// Link samplers
+							shaderUniforms->SetInt("albedoMap", MATERIAL_BINDING_ALBEDO);
+							shaderUniforms->SetInt("normalMap", MATERIAL_BINDING_NORMAL);
+							shaderUniforms->SetInt("packedMap", MATERIAL_BINDING_PACKED);
+
+							// Link uniform blocks
+							shaderUniforms->SetBlockBinding("FrameBlock", UNIFORM_BLOCK_FRAME);
+							shaderUniforms->SetBlockBinding("ObjectBlock", UNIFORM_BLOCK_OBJECT);
+
+							// dequantization of the packed positions, constant for the mesh
+							if (usePackedVertices && mesh.isReady)
+							{
+								shaderUniforms->SetVec3("positionBoundsMin", mesh.packedVertexBounds.boundsMin);
+								shaderUniforms->SetVec3("positionBoundsExtent", mesh.packedVertexBounds.boundsExtent);
+							}
+						}
 
-							glActiveTexture(GL_TEXTURE0 + 1);
-							glBindTexture(GL_TEXTURE_2D, normalSampler);
+						{ // Bind the textures, the placeholders until the material ones are uploaded
+							if (materialArray)
+							{
+								// every material is a layer of these
+								materialArray->Bind();
+							}
+							else
+							{
+								for (uint32_t binding = 0; binding < MATERIAL_BINDING_COUNT; ++binding)
+								{
+									glActiveTexture(GL_TEXTURE0 + binding);
+									const unsigned int materialTexture = materialTextures[binding].GetTexture();
+									glBindTexture(GL_TEXTURE_2D, materialTexture != 0 ?
+										materialTexture : materialPlaceholders[binding].GetTexture());
+								}
+							}
 						}
 					}
 
 					// Draw call
-					glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, nullptr);
+					if (isFrameBound)
+					{
+						if (useSceneImport && mesh.isReady)
+						{
+							// one draw per submesh referenced by a node, placed by the node world transform under the user transform
+							const SceneData& scene = mesh.scene;
+							for (size_t draw = 0; draw < scene.GetDrawCount(); ++draw)
+							{
+								const uint32_t submesh = scene.drawSubmeshes[draw];
+								const glm::mat4 transform = model * scene.nodeWorldTransforms[scene.drawNodes[draw]];
+								const glm::vec3 materialColor = baseColor * scene.materialBaseColors[scene.submeshMaterials[submesh]];
+								if (!bindObjectUniforms(transform, materialColor))
+								{
+									continue;
+								}
+								if (materialArray)
+								{
+									// the instance attribute is disabled, its current value is the layer of the whole draw
+									glVertexAttrib4f(6, 0.0f, 0.0f, 0.0f, sceneMaterialLayers[scene.submeshMaterials[submesh]]);
+								}
+								glDrawElements(GL_TRIANGLES, scene.submeshIndexCount[submesh], GL_UNSIGNED_INT, (void*)(sizeof(unsigned int) * scene.submeshFirstIndex[submesh]));
+							}
+						}
+						else if (useMaterialInstances)
+						{
+							// every loaded material in one draw
+							if (bindObjectUniforms(model, baseColor))
+							{
+								glDrawElementsInstanced(GL_TRIANGLES, indicesToDraw, GL_UNSIGNED_INT, (void*)(sizeof(unsigned int) * firstIndexToDraw),
+									static_cast<GLsizei>(materialInstances.size()));
+							}
+						}
+						else if (bindObjectUniforms(model, baseColor))
+						{
+							glDrawElements(GL_TRIANGLES, indicesToDraw, GL_UNSIGNED_INT, (void*)(sizeof(unsigned int) * firstIndexToDraw));
+						}
+					}
+
+					// the GPU reads the blocks of the frame until this fence
+					uniformRing->EndFrame();
 				}
 				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 				glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -561,10 +860,37 @@ int main()
 		glDeleteBuffers(1, &VBO);
 	}
 
+	{ // Destroy the IBOs
+		glDeleteBuffers(1, &IBO);
+		glDeleteBuffers(1, &culledIBO);
+		glDeleteBuffers(1, &instanceVBO);
+	}
+
 	{
-		// Destroy the Textures
-		glDeleteTextures(1, &texture);
-		glDeleteTextures(1, &normalSampler);
+		// Destroy the Textures, the handles go before their registry
+		for (uint32_t binding = 0; binding < MATERIAL_BINDING_COUNT; ++binding)
+		{
+			materialTextures[binding].Reset();
+			materialPlaceholders[binding].Reset();
+		}
+		textureRegistry.reset();
+		materialArray.reset();
+	}
+
+	{ // Destroy the shader program
+		const ShaderVariantCacheStatistics statistics = shaderVariants->GetStatistics();
+		std::cout << "Shader variants: " << statistics.readyCount << "/" << statistics.variantCount << " built, uniform uploads "
+			<< statistics.uniformUploadCount << ", " << statistics.uniformSkippedCount << " skipped as unchanged" << std::endl;
+		shaderVariants.reset();
+	}
+
+	{ // Destroy the uniform ring, its buffer needs the context
+		uniformRing.reset();
+	}
+
+	{ // Destroy the upload ring after the uploads still staged in it, its buffer needs the context
+		assetLoader.Cancel();
+		uploadRing.reset();
 	}
 
 	glfwTerminate();
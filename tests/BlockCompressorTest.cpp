@@ -0,0 +1,83 @@
+// Compresses synthetic images to BC1, BC4 and BC5 and decompresses them back: flat blocks must come back exactly,
+// gradients within a PSNR floor, and the partial blocks of sizes that aren't a multiple of 4 must keep the image size.
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "../src/BlockCompressor.h"
+#include "TestCheck.h"
+
+// Lowest PSNR in dB accepted for the smooth gradient, a few dB under what the encoder reaches on it
+const double BC1_GRADIENT_MIN_PSNR = 35.0;
+const double BC4_GRADIENT_MIN_PSNR = 48.0;
+
+// width x height texels of channels bytes, channel c of texel (x, y) from value(x, y, c)
+template <typename Value>
+std::vector<unsigned char> MakeImage(uint32_t width, uint32_t height, uint32_t channels, Value value)
+{
+	std::vector<unsigned char> pixels(size_t(width) * height * channels);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			for (uint32_t c = 0; c < channels; ++c)
+			{
+				pixels[(size_t(y) * width + x) * channels + c] = static_cast<unsigned char>(value(x, y, c));
+			}
+		}
+	}
+	return pixels;
+}
+
+// PSNR of image after a round trip through format, over the channels the format keeps
+double GetRoundTripPsnr(uint32_t format, const std::vector<unsigned char>& image, uint32_t width, uint32_t height, uint32_t channels)
+{
+	const std::vector<unsigned char> blocks = BlockCompressor::Compress(format, image.data(), width, height, channels);
+	CHECK(blocks.size() == TextureContainer::GetImageSize(format, width, height));
+
+	const std::vector<unsigned char> decoded = BlockCompressor::Decompress(format, blocks.data(), width, height);
+	const uint32_t formatChannels = TextureContainer::GetFormatChannels(format);
+	CHECK(decoded.size() == size_t(width) * height * formatChannels);
+	if (decoded.size() != size_t(width) * height * formatChannels)
+	{
+		return 0.0;
+	}
+	return BlockCompressor::ComputePsnr(image.data(), channels, decoded.data(), formatChannels, size_t(width) * height, formatChannels);
+}
+
+int main()
+{
+	// flat colors exactly representable by the endpoints: 5:6:5 for BC1, any byte for BC4 and BC5
+	const std::vector<unsigned char> flatColor = MakeImage(8, 8, 3, [](uint32_t, uint32_t, uint32_t c) { return c == 1 ? 0 : 255; });
+	CHECK(std::isinf(GetRoundTripPsnr(TEXTURE_FORMAT_BC1, flatColor, 8, 8, 3)));
+	const std::vector<unsigned char> flatValues = MakeImage(8, 8, 2, [](uint32_t, uint32_t, uint32_t c) { return c == 0 ? 77 : 200; });
+	CHECK(std::isinf(GetRoundTripPsnr(TEXTURE_FORMAT_BC4, flatValues, 8, 8, 2)));
+	CHECK(std::isinf(GetRoundTripPsnr(TEXTURE_FORMAT_BC5, flatValues, 8, 8, 2)));
+
+	// two values per block are the endpoints themselves, BC4 keeps them exactly
+	const std::vector<unsigned char> checker = MakeImage(16, 16, 1, [](uint32_t x, uint32_t y, uint32_t) { return (x + y) % 2 ? 10 : 240; });
+	CHECK(std::isinf(GetRoundTripPsnr(TEXTURE_FORMAT_BC4, checker, 16, 16, 1)));
+
+	// smooth gradients, a channel each way
+	const std::vector<unsigned char> gradient = MakeImage(64, 64, 3, [](uint32_t x, uint32_t y, uint32_t c)
+	{
+		return c == 0 ? x * 4 : c == 1 ? y * 4 : (x + y) * 2;
+	});
+	CHECK(GetRoundTripPsnr(TEXTURE_FORMAT_BC1, gradient, 64, 64, 3) > BC1_GRADIENT_MIN_PSNR);
+	CHECK(GetRoundTripPsnr(TEXTURE_FORMAT_BC4, gradient, 64, 64, 3) > BC4_GRADIENT_MIN_PSNR);
+	CHECK(GetRoundTripPsnr(TEXTURE_FORMAT_BC5, gradient, 64, 64, 3) > BC4_GRADIENT_MIN_PSNR);
+
+	// partial blocks: the last row and column are repeated, the texels inside the image stay exact
+	const std::vector<unsigned char> partial = MakeImage(5, 3, 1, [](uint32_t x, uint32_t, uint32_t) { return x < 4 ? 30 : 220; });
+	CHECK(std::isinf(GetRoundTripPsnr(TEXTURE_FORMAT_BC4, partial, 5, 3, 1)));
+	CHECK(std::isinf(GetRoundTripPsnr(TEXTURE_FORMAT_BC4, MakeImage(1, 1, 1, [](uint32_t, uint32_t, uint32_t) { return 99; }), 1, 1, 1)));
+
+	// BC5 channels are independent, one flat channel stays flat next to a noisy one
+	const std::vector<unsigned char> mixed = MakeImage(8, 8, 2, [](uint32_t x, uint32_t y, uint32_t c) { return c == 0 ? 128 : (x * 37 + y * 91) % 256; });
+	const std::vector<unsigned char> mixedBlocks = BlockCompressor::Compress(TEXTURE_FORMAT_BC5, mixed.data(), 8, 8, 2);
+	const std::vector<unsigned char> mixedDecoded = BlockCompressor::Decompress(TEXTURE_FORMAT_BC5, mixedBlocks.data(), 8, 8);
+	CHECK(std::isinf(BlockCompressor::ComputePsnr(mixed.data(), 2, mixedDecoded.data(), 2, 64, 1)));
+
+	return GetTestFailureCount();
+}
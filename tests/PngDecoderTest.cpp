@@ -0,0 +1,104 @@
+// Encodes synthetic images with stb_image_write (every row filter type shows up) and checks that PngDecoder gives the same
+// pixels as stbi_load_from_memory for every channel count and with the vertical flip, and that it refuses truncated files.
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb/stb_image_write.h>
+
+#include "../src/PngDecoder.h"
+#include "TestCheck.h"
+
+void AppendPngBytes(void* context, void* data, int size)
+{
+	std::vector<unsigned char>* file = static_cast<std::vector<unsigned char>*>(context);
+	file->insert(file->end(), static_cast<unsigned char*>(data), static_cast<unsigned char*>(data) + size);
+}
+
+// PNG file of a width x height image with channels channels: gradients, flat areas and noise so that the rows pick
+// different filters
+std::vector<unsigned char> EncodePng(int width, int height, int channels)
+{
+	std::vector<unsigned char> pixels(size_t(width) * height * channels);
+	uint32_t noise = 12345;
+	for (int y = 0; y < height; ++y)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			for (int c = 0; c < channels; ++c)
+			{
+				noise = noise * 1664525u + 1013904223u;
+				const int value = y % 3 == 0 ? x * 3 + c * 40 : y % 3 == 1 ? 200 - c * 30 : static_cast<int>(noise >> 24);
+				pixels[(size_t(y) * width + x) * channels + c] = static_cast<unsigned char>(value);
+			}
+		}
+	}
+
+	std::vector<unsigned char> file;
+	stbi_write_png_to_func(AppendPngBytes, &file, width, height, channels, pixels.data(), width * channels);
+	return file;
+}
+
+// PngDecoder and stb_image agree on file for desiredChannels 0 to 4, with and without the flip
+bool IsMatchingStb(const std::vector<unsigned char>& file)
+{
+	bool isMatching = true;
+	for (int desiredChannels = 0; desiredChannels <= 4; ++desiredChannels)
+	{
+		for (int flip = 0; flip < 2; ++flip)
+		{
+			stbi_set_flip_vertically_on_load(flip);
+			int width;
+			int height;
+			int channelsInFile;
+			unsigned char* reference = stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &width, &height,
+				&channelsInFile, desiredChannels);
+			stbi_set_flip_vertically_on_load(0);
+
+			PngImage image;
+			const bool isDecoded = PngDecoder::Decode(file.data(), file.size(), desiredChannels, flip != 0, image);
+			const int channels = desiredChannels != 0 ? desiredChannels : channelsInFile;
+			isMatching = isMatching && reference && isDecoded && image.width == width && image.height == height &&
+				image.channels == channels && image.channelsInFile == channelsInFile &&
+				std::memcmp(reference, image.pixels.get(), size_t(width) * height * channels) == 0;
+			stbi_image_free(reference);
+		}
+	}
+	return isMatching;
+}
+
+int main()
+{
+	const int sizes[][2] = { { 1, 1 }, { 7, 5 }, { 64, 33 }, { 300, 2 } };
+	for (const int* size : sizes)
+	{
+		for (int channels = 1; channels <= 4; ++channels)
+		{
+			const std::vector<unsigned char> file = EncodePng(size[0], size[1], channels);
+			CHECK(IsMatchingStb(file));
+
+			// cut in the image data, and before the end of the header
+			PngImage image;
+			CHECK(!PngDecoder::Decode(file.data(), file.size() / 2, 0, false, image));
+			CHECK(!PngDecoder::Decode(file.data(), 20, 0, false, image));
+		}
+	}
+
+	// not a PNG at all
+	const unsigned char garbage[64] = { 0x89, 'P', 'N', 'G' };
+	PngImage image;
+	CHECK(!PngDecoder::Decode(garbage, sizeof(garbage), 0, false, image));
+
+	// zlib streams that don't inflate to the expected size
+	const unsigned char storedBlock[] = { 0x78, 0x01, 0x01, 0x03, 0x00, 0xFC, 0xFF, 'a', 'b', 'c', 0x02, 0x4D, 0x01, 0x27 };
+	unsigned char output[4] = {};
+	CHECK(PngDecoder::Inflate(storedBlock, sizeof(storedBlock), output, 3) && std::memcmp(output, "abc", 3) == 0);
+	CHECK(!PngDecoder::Inflate(storedBlock, sizeof(storedBlock), output, 4));
+	CHECK(!PngDecoder::Inflate(storedBlock, sizeof(storedBlock) - 6, output, 3));
+
+	return GetTestFailureCount();
+}
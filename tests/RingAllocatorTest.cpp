@@ -0,0 +1,163 @@
+// Reserves blocks of a RingAllocator over plain memory the way PixelUploadRing does: a worker copies into the blocks while
+// the main thread, standing in for the GL thread, submits, fences and releases them a few fences late. Every block must
+// keep its bytes until its release, and a full ring must refuse a reservation rather than wait.
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../src/RingAllocator.h"
+#include "TestCheck.h"
+
+const size_t RING_CAPACITY = 4096;
+const size_t RING_ALIGNMENT = 16;
+const uint32_t STAGED_BLOCK_COUNT = 2000;
+// fences the GPU is behind the GL thread
+const uint64_t FENCE_LAG = 2;
+
+struct StagedBlock
+{
+	size_t offset = 0;
+	size_t size = 0;
+	uint32_t seed = 0;
+	uint64_t fence = 0;
+};
+
+unsigned char GetPatternByte(uint32_t seed, size_t index)
+{
+	return static_cast<unsigned char>((seed * 131 + index * 7) % 251);
+}
+
+bool HasPattern(const std::vector<unsigned char>& memory, const StagedBlock& block)
+{
+	for (size_t i = 0; i < block.size; ++i)
+	{
+		if (memory[block.offset + i] != GetPatternByte(block.seed, i))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void TestFullRing()
+{
+	RingAllocator ring(256, RING_ALIGNMENT);
+	size_t first = 0;
+	size_t second = 0;
+	size_t offset = 0;
+	CHECK(ring.Reserve(100, first));
+	CHECK(ring.Reserve(100, second));
+	CHECK(first == 0 && second == 112);
+	CHECK(!ring.Reserve(100, offset));
+	CHECK(!ring.Reserve(300, offset));
+	CHECK(ring.GetStatistics().fullCount == 1);
+
+	// the second block is done first, the first one still holds it up
+	ring.Submit(second);
+	CHECK(ring.Fence(1));
+	ring.Release(1);
+	CHECK(ring.GetStatistics().usedBytes == 224);
+	CHECK(!ring.Fence(2));
+
+	ring.Submit(first);
+	CHECK(ring.Fence(2));
+	ring.Release(1);
+	CHECK(ring.GetStatistics().usedBytes == 224);
+	ring.Release(2);
+	CHECK(ring.GetStatistics().usedBytes == 0);
+	CHECK(ring.Reserve(200, offset) && offset == 0);
+}
+
+void TestWorkerStaging()
+{
+	RingAllocator ring(RING_CAPACITY, RING_ALIGNMENT);
+	std::vector<unsigned char> memory(RING_CAPACITY);
+
+	std::mutex mutex;
+	std::deque<StagedBlock> staged;
+	bool isWorkerDone = false;
+	size_t refusedCount = 0;
+
+	std::thread worker([&]()
+	{
+		for (uint32_t seed = 0; seed < STAGED_BLOCK_COUNT; ++seed)
+		{
+			StagedBlock block;
+			block.size = 1 + (seed * 97) % 700;
+			block.seed = seed;
+			while (!ring.Reserve(block.size, block.offset))
+			{
+				// PixelUploadRing falls back to client memory here, the test waits to exercise the reuse of the blocks
+				refusedCount++;
+				std::this_thread::yield();
+			}
+			for (size_t i = 0; i < block.size; ++i)
+			{
+				memory[block.offset + i] = GetPatternByte(seed, i);
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+			staged.push_back(block);
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		isWorkerDone = true;
+	});
+
+	std::deque<StagedBlock> inFlight;
+	uint64_t nextFence = 1;
+	uint32_t receivedCount = 0;
+	bool isStagingDone = false;
+	while (!isStagingDone)
+	{
+		std::deque<StagedBlock> received;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			received.swap(staged);
+			isStagingDone = isWorkerDone && received.empty();
+		}
+
+		// the upload reads the block, then the block goes to the GPU
+		for (StagedBlock& block : received)
+		{
+			CHECK(HasPattern(memory, block));
+			ring.Submit(block.offset);
+			block.fence = nextFence;
+			inFlight.push_back(block);
+			receivedCount++;
+		}
+
+		// end of the frame, a fence per frame signaled FENCE_LAG frames later: the blocks the GPU is done with must not
+		// have been reused by the worker
+		ring.Fence(nextFence);
+		uint64_t signaledFence = nextFence > FENCE_LAG ? nextFence - FENCE_LAG : 0;
+		if (isStagingDone)
+		{
+			signaledFence = nextFence;
+		}
+		nextFence++;
+		while (!inFlight.empty() && inFlight.front().fence <= signaledFence)
+		{
+			CHECK(HasPattern(memory, inFlight.front()));
+			inFlight.pop_front();
+		}
+		ring.Release(signaledFence);
+		std::this_thread::yield();
+	}
+	worker.join();
+
+	CHECK(receivedCount == STAGED_BLOCK_COUNT);
+	CHECK(inFlight.empty());
+	const RingAllocatorStatistics statistics = ring.GetStatistics();
+	CHECK(statistics.usedBytes == 0);
+	CHECK(statistics.fullCount == refusedCount);
+}
+
+int main()
+{
+	TestFullRing();
+	TestWorkerStaging();
+	return GetTestFailureCount();
+}
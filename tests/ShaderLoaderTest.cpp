@@ -0,0 +1,67 @@
+// Writes a few shader files to a temporary directory and checks the source PreprocessShader builds from them: defines after
+// #version, includes expanded once each, and #line directives giving back the line and file of every source line.
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../src/ShaderLoader.h"
+#include "TestCheck.h"
+
+void WriteShader(const std::filesystem::path& path, const std::string& source)
+{
+	std::filesystem::create_directories(path.parent_path());
+	std::ofstream file(path, std::ios::trunc);
+	file << source;
+}
+
+int main()
+{
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "ShaderLoaderTest";
+	std::filesystem::remove_all(directory);
+
+	const std::string mainPath = (directory / "main.frag").generic_string();
+	const std::string commonPath = (directory / "common.glsl").generic_string();
+	const std::string lightingPath = (directory / "sub" / "lighting.glsl").generic_string();
+	WriteShader(mainPath, "#version 330 core\n#include \"common.glsl\"\n  #include \"sub/lighting.glsl\"\nvoid main() {}\n");
+	WriteShader(commonPath, "float shared;\n");
+	// includes common.glsl again through another path, it is already there
+	WriteShader(lightingPath, "#include \"../common.glsl\"\nfloat light;\n");
+
+	std::vector<std::string> files;
+	const std::string source = ShaderLoader::PreprocessShader(mainPath, { "USE_NORMAL_MAP", "LIGHT_COUNT 2" }, &files);
+	CHECK(source ==
+		"#version 330 core\n"
+		"#define USE_NORMAL_MAP\n"
+		"#define LIGHT_COUNT 2\n"
+		"#line 2 0\n"
+		"#line 1 1\n"
+		"float shared;\n"
+		"#line 3 0\n"
+		"#line 1 2\n"
+		"#line 2 2\n"
+		"float light;\n"
+		"#line 4 0\n"
+		"void main() {}\n");
+	CHECK(files == std::vector<std::string>({ mainPath, commonPath, lightingPath }));
+
+	// without #version the defines come first, and no #line is needed for the root file
+	const std::string noVersionPath = (directory / "noversion.glsl").generic_string();
+	WriteShader(noVersionPath, "float a;\n");
+	CHECK(ShaderLoader::PreprocessShader(noVersionPath, { "A" }) == "#define A\nfloat a;\n");
+
+	// include cycles stop at the files already read
+	const std::string cyclePath = (directory / "cycle.glsl").generic_string();
+	WriteShader(cyclePath, "#include \"cycle.glsl\"\nfloat b;\n");
+	CHECK(ShaderLoader::PreprocessShader(cyclePath, {}) == "#line 2 0\nfloat b;\n");
+
+	// a missing include fails the whole shader, files still lists what was read
+	const std::string brokenPath = (directory / "broken.frag").generic_string();
+	WriteShader(brokenPath, "#version 330 core\n#include \"missing.glsl\"\n");
+	CHECK(ShaderLoader::PreprocessShader(brokenPath, {}, &files).empty());
+	CHECK(!files.empty() && files[0] == brokenPath);
+
+	std::filesystem::remove_all(directory);
+	return GetTestFailureCount();
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <iostream>
+
+// Failed checks of the test executable, its exit code
+inline int& GetTestFailureCount()
+{
+	static int failureCount = 0;
+	return failureCount;
+}
+
+// Prints the failed condition with its line and keeps going, so one run reports every failure
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			std::cout << "FAILED " << __FILE__ << ":" << __LINE__ << " " #condition << std::endl; \
+			GetTestFailureCount()++; \
+		} \
+	} while (false)
@@ -0,0 +1,116 @@
+// Writes a small container, then checks that Open rejects truncated and corrupted copies of it instead of reading past the file.
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "../src/TextureContainer.h"
+#include "TestCheck.h"
+
+// Byte offsets in the file, see TextureContainerFileHeader and TextureContainerFileMip
+const size_t HEADER_MAGIC_OFFSET = 0;
+const size_t HEADER_VERSION_OFFSET = 4;
+const size_t HEADER_FORMAT_OFFSET = 8;
+const size_t HEADER_MIP_COUNT_OFFSET = 24;
+const size_t HEADER_SIZE = 32;
+const size_t MIP_ENTRY_SIZE = 24;
+const size_t MIP_OFFSET_OFFSET = 0;
+const size_t MIP_SIZE_OFFSET = 8;
+const size_t MIP_WIDTH_OFFSET = 16;
+
+std::vector<unsigned char> ReadFile(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	return std::vector<unsigned char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void WriteFile(const std::string& path, const std::vector<unsigned char>& data)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+}
+
+template <typename T>
+std::vector<unsigned char> Patch(std::vector<unsigned char> data, size_t offset, T value)
+{
+	std::memcpy(data.data() + offset, &value, sizeof(value));
+	return data;
+}
+
+// Whether a container holding data opens
+bool IsOpening(const std::string& path, const std::vector<unsigned char>& data)
+{
+	WriteFile(path, data);
+	TextureContainer container;
+	return container.Open(path);
+}
+
+int main()
+{
+	const std::string path = (std::filesystem::temp_directory_path() / "TextureContainerTest.swtex").string();
+
+	// 8x8 RGBA8 with its 4x4, 2x2 and 1x1 mips
+	std::vector<std::vector<unsigned char>> pixels;
+	std::vector<TextureMip> mips;
+	for (uint32_t size = 8; size > 0; size /= 2)
+	{
+		pixels.emplace_back(TextureContainer::GetImageSize(TEXTURE_FORMAT_RGBA8, size, size), static_cast<unsigned char>(size));
+		TextureMip mip;
+		mip.width = size;
+		mip.height = size;
+		mip.data = pixels.back().data();
+		mip.size = pixels.back().size();
+		mips.push_back(mip);
+	}
+	CHECK(TextureContainer::Write(path, TEXTURE_FORMAT_RGBA8, TEXTURE_CONTAINER_SRGB, mips));
+
+	{
+		TextureContainer container;
+		CHECK(container.Open(path));
+		CHECK(container.GetFormat() == TEXTURE_FORMAT_RGBA8);
+		CHECK(container.GetFlags() == TEXTURE_CONTAINER_SRGB);
+		CHECK(container.GetMipCount() == mips.size());
+		for (uint32_t level = 0; level < container.GetMipCount(); ++level)
+		{
+			const TextureMip mip = container.GetMip(level);
+			CHECK(mip.width == mips[level].width && mip.size == mips[level].size);
+			CHECK(std::memcmp(mip.data, mips[level].data, mip.size) == 0);
+		}
+		CHECK(container.GetMip(container.GetMipCount()).data == nullptr);
+	}
+
+	// a mip of the wrong size for its dimensions is refused by the writer too
+	std::vector<TextureMip> wrongMips = mips;
+	wrongMips[1].size--;
+	CHECK(!TextureContainer::Write(path + ".wrong", TEXTURE_FORMAT_RGBA8, TEXTURE_CONTAINER_NONE, wrongMips));
+
+	const std::vector<unsigned char> file = ReadFile(path);
+	CHECK(file.size() > HEADER_SIZE + MIP_ENTRY_SIZE * mips.size());
+	CHECK(IsOpening(path, file));
+
+	// truncated: empty, inside the header, inside the mip table, inside the last mip
+	CHECK(!IsOpening(path, {}));
+	CHECK(!IsOpening(path, std::vector<unsigned char>(file.begin(), file.begin() + HEADER_SIZE - 1)));
+	CHECK(!IsOpening(path, std::vector<unsigned char>(file.begin(), file.begin() + HEADER_SIZE + MIP_ENTRY_SIZE)));
+	CHECK(!IsOpening(path, std::vector<unsigned char>(file.begin(), file.end() - 1)));
+
+	// corrupt header fields
+	CHECK(!IsOpening(path, Patch<uint32_t>(file, HEADER_MAGIC_OFFSET, 0)));
+	CHECK(!IsOpening(path, Patch<uint32_t>(file, HEADER_VERSION_OFFSET, 0)));
+	CHECK(!IsOpening(path, Patch<uint32_t>(file, HEADER_FORMAT_OFFSET, TEXTURE_FORMAT_COUNT)));
+	CHECK(!IsOpening(path, Patch<uint32_t>(file, HEADER_MIP_COUNT_OFFSET, 0)));
+	CHECK(!IsOpening(path, Patch<uint32_t>(file, HEADER_MIP_COUNT_OFFSET, 0xFFFFFFFF)));
+
+	// corrupt mip table: outside of the file, overflowing offset + size, size not matching the dimensions
+	const size_t lastMip = HEADER_SIZE + MIP_ENTRY_SIZE * (mips.size() - 1);
+	CHECK(!IsOpening(path, Patch<uint64_t>(file, lastMip + MIP_OFFSET_OFFSET, file.size() + 1)));
+	CHECK(!IsOpening(path, Patch<uint64_t>(file, lastMip + MIP_SIZE_OFFSET, UINT64_MAX)));
+	CHECK(!IsOpening(path, Patch<uint32_t>(file, HEADER_SIZE + MIP_WIDTH_OFFSET, 16)));
+
+	std::filesystem::remove(path);
+	return GetTestFailureCount();
+}
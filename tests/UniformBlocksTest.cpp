@@ -0,0 +1,160 @@
+// Lays out the blocks of res/shaders/uniform_blocks.glsl with the std140 rules and checks every member against the offset
+// of the same member in UniformBlocks.h, so that a member added on one side only fails here instead of on the GPU.
+// Usage: UniformBlocksTest <path of uniform_blocks.glsl>
+
+#include <cstddef>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/UniformBlocks.h"
+#include "TestCheck.h"
+
+struct Std140Member
+{
+	std::string name;
+	size_t offset = 0;
+};
+
+struct Std140Type
+{
+	size_t alignment = 0;
+	size_t size = 0;
+	// flattened members of a struct: "member", "member.field" for the members that are structs
+	std::vector<Std140Member> members;
+};
+
+size_t AlignStd140(size_t offset, size_t alignment)
+{
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+// Structs and blocks of source by name, the basic types the shaders use are predefined
+std::map<std::string, Std140Type> ParseStd140Types(const std::string& source)
+{
+	std::map<std::string, Std140Type> types;
+	types["int"] = { 4, 4, {} };
+	types["float"] = { 4, 4, {} };
+	types["vec3"] = { 16, 12, {} };
+	types["vec4"] = { 16, 16, {} };
+	types["mat4"] = { 16, 64, {} };
+
+	std::istringstream lines(source);
+	std::string line;
+	std::string name;
+	Std140Type type;
+	bool isInside = false;
+	while (std::getline(lines, line))
+	{
+		if (line.compare(0, 2, "//") == 0)
+		{
+			continue;
+		}
+
+		std::istringstream words(line);
+		std::vector<std::string> tokens;
+		for (std::string word; words >> word;)
+		{
+			tokens.push_back(word);
+		}
+
+		if (!isInside && tokens.size() >= 2 && (tokens[0] == "struct" || tokens[tokens.size() - 2] == "uniform"))
+		{
+			name = tokens.back();
+		}
+		else if (!tokens.empty() && tokens[0] == "{")
+		{
+			isInside = true;
+			type = Std140Type();
+			type.alignment = 16;
+		}
+		else if (!tokens.empty() && tokens[0].compare(0, 1, "}") == 0)
+		{
+			// structs and blocks are rounded up to a vec4
+			type.size = AlignStd140(type.size, type.alignment);
+			types[name] = type;
+			isInside = false;
+		}
+		else if (isInside && tokens.size() == 2 && types.count(tokens[0]))
+		{
+			const Std140Type& memberType = types[tokens[0]];
+			const std::string memberName = tokens[1].substr(0, tokens[1].find(';'));
+			const size_t offset = AlignStd140(type.size, memberType.alignment);
+			if (memberType.members.empty())
+			{
+				type.members.push_back({ memberName, offset });
+			}
+			for (const Std140Member& field : memberType.members)
+			{
+				type.members.push_back({ memberName + "." + field.name, offset + field.offset });
+			}
+			type.size = offset + memberType.size;
+		}
+	}
+	return types;
+}
+
+// block has exactly the members of expected, at the same offsets, and the size of the C++ struct
+void CheckBlock(const std::map<std::string, Std140Type>& types, const std::string& block, const std::vector<Std140Member>& expected,
+	size_t size)
+{
+	const auto found = types.find(block);
+	CHECK(found != types.end());
+	if (found == types.end())
+	{
+		return;
+	}
+
+	const std::vector<Std140Member>& members = found->second.members;
+	CHECK(found->second.size == size);
+	CHECK(members.size() == expected.size());
+	for (size_t n = 0; n < members.size() && n < expected.size(); ++n)
+	{
+		if (members[n].name != expected[n].name || members[n].offset != expected[n].offset)
+		{
+			std::cout << block << "." << members[n].name << " at " << members[n].offset << ", expected " << expected[n].name << " at "
+				<< expected[n].offset << std::endl;
+			GetTestFailureCount()++;
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: UniformBlocksTest <path of uniform_blocks.glsl>" << std::endl;
+		return 1;
+	}
+
+	std::ifstream file(argv[1]);
+	if (!file)
+	{
+		std::cout << "ERROR::UNIFORM_BLOCKS_TEST::CAN_NOT_READ " << argv[1] << std::endl;
+		return 1;
+	}
+	std::stringstream source;
+	source << file.rdbuf();
+	const std::map<std::string, Std140Type> types = ParseStd140Types(source.str());
+
+	CheckBlock(types, "FrameBlock", {
+		{ "view", offsetof(FrameUniforms, view) },
+		{ "projection", offsetof(FrameUniforms, projection) },
+		{ "viewProjection", offsetof(FrameUniforms, viewProjection) },
+		{ "cameraWorldPosition", offsetof(FrameUniforms, cameraWorldPosition) },
+		{ "lightWorldPosition", offsetof(FrameUniforms, lightWorldPosition) },
+		{ "lightColor", offsetof(FrameUniforms, lightColor) },
+	}, sizeof(FrameUniforms));
+
+	CheckBlock(types, "ObjectBlock", {
+		{ "transform", offsetof(ObjectUniforms, transform) },
+		{ "baseColor", offsetof(ObjectUniforms, baseColor) },
+		{ "material.occlusionChannel", offsetof(ObjectUniforms, occlusionChannel) },
+		{ "material.roughnessChannel", offsetof(ObjectUniforms, roughnessChannel) },
+		{ "material.displacementChannel", offsetof(ObjectUniforms, displacementChannel) },
+	}, sizeof(ObjectUniforms));
+
+	return GetTestFailureCount();
+}
@@ -0,0 +1,158 @@
+// Decodes every png under a directory with stbi_load_from_memory and with PngDecoder, and prints the time each takes.
+// Usage: PngDecodeBenchmark [--iterations N] [directory]	(directory defaults to ../res/textures, 5 iterations)
+// The files are read once up front, only the decoding is timed (best of the iterations). The outputs are compared
+// for every channel count; files PngDecoder leaves to stb_image are reported as such.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include "../src/PngDecoder.h"
+
+struct BenchmarkFile
+{
+	std::string path;
+	std::vector<unsigned char> data;
+};
+
+// Best time in seconds of iterations calls of decode
+template <typename Decode>
+double TimeDecode(size_t iterations, Decode decode)
+{
+	double best = 0.0;
+	for (size_t n = 0; n < iterations; ++n)
+	{
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		decode();
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		best = n == 0 ? seconds : std::min(best, seconds);
+	}
+	return best;
+}
+
+// Both decoders give the same pixels for desiredChannels 0 to 4, and with the vertical flip
+bool IsMatchingStb(const BenchmarkFile& file)
+{
+	for (int desiredChannels = 0; desiredChannels <= 4; ++desiredChannels)
+	{
+		for (int flip = 0; flip < 2; ++flip)
+		{
+			stbi_set_flip_vertically_on_load(flip);
+			int width;
+			int height;
+			int channelsInFile;
+			unsigned char* reference = stbi_load_from_memory(file.data.data(), static_cast<int>(file.data.size()), &width, &height,
+				&channelsInFile, desiredChannels);
+			stbi_set_flip_vertically_on_load(0);
+
+			PngImage image;
+			const bool isDecoded = PngDecoder::Decode(file.data.data(), file.data.size(), desiredChannels, flip != 0, image);
+			const int channels = desiredChannels != 0 ? desiredChannels : channelsInFile;
+			const bool isMatching = reference && isDecoded && image.width == width && image.height == height &&
+				image.channels == channels && image.channelsInFile == channelsInFile &&
+				std::equal(reference, reference + size_t(width) * height * channels, image.pixels.get());
+			stbi_image_free(reference);
+			if (!isMatching)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	std::string directory = "../res/textures";
+	size_t iterations = 5;
+	for (int n = 1; n < argc; ++n)
+	{
+		const std::string argument = argv[n];
+		if (argument == "--iterations" && n + 1 < argc)
+		{
+			iterations = std::max(std::stoul(argv[++n]), 1ul);
+		}
+		else
+		{
+			directory = argument;
+		}
+	}
+
+	std::vector<BenchmarkFile> files;
+	std::error_code error;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(directory, error))
+	{
+		if (!entry.is_regular_file() || entry.path().extension() != ".png")
+		{
+			continue;
+		}
+
+		std::ifstream stream(entry.path(), std::ios::binary);
+		BenchmarkFile file;
+		file.path = entry.path().string();
+		file.data.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+		files.push_back(std::move(file));
+	}
+	std::sort(files.begin(), files.end(), [](const BenchmarkFile& a, const BenchmarkFile& b) { return a.path < b.path; });
+	if (files.empty())
+	{
+		std::cout << "no png under " << directory << std::endl;
+		return 1;
+	}
+
+	double stbTotal = 0.0;
+	double decoderTotal = 0.0;
+	bool isEveryFileMatching = true;
+	for (const BenchmarkFile& file : files)
+	{
+		PngImage image;
+		const bool isSupported = PngDecoder::Decode(file.data.data(), file.data.size(), 0, false, image);
+		const double stbSeconds = TimeDecode(iterations, [&file]()
+		{
+			int width;
+			int height;
+			int channels;
+			stbi_image_free(stbi_load_from_memory(file.data.data(), static_cast<int>(file.data.size()), &width, &height, &channels, 0));
+		});
+
+		char line[512];
+		if (!isSupported)
+		{
+			std::snprintf(line, sizeof(line), "%-60s stb %8.2f ms  (left to stb_image)", file.path.c_str(), stbSeconds * 1000.0);
+			std::cout << line << std::endl;
+			stbTotal += stbSeconds;
+			decoderTotal += stbSeconds;
+			continue;
+		}
+
+		const double decoderSeconds = TimeDecode(iterations, [&file]()
+		{
+			PngImage decoded;
+			PngDecoder::Decode(file.data.data(), file.data.size(), 0, false, decoded);
+		});
+		const bool isMatching = IsMatchingStb(file);
+		isEveryFileMatching = isEveryFileMatching && isMatching;
+		stbTotal += stbSeconds;
+		decoderTotal += decoderSeconds;
+
+		std::snprintf(line, sizeof(line), "%-60s %4dx%-4d %dch  stb %8.2f ms  PngDecoder %8.2f ms  x%.2f  %s", file.path.c_str(),
+			image.width, image.height, image.channelsInFile, stbSeconds * 1000.0, decoderSeconds * 1000.0, stbSeconds / decoderSeconds,
+			isMatching ? "identical" : "MISMATCH");
+		std::cout << line << std::endl;
+	}
+
+	char line[256];
+	std::snprintf(line, sizeof(line), "%zu files  stb %.2f ms  PngDecoder (with fallbacks) %.2f ms  x%.2f", files.size(),
+		stbTotal * 1000.0, decoderTotal * 1000.0, stbTotal / decoderTotal);
+	std::cout << line << std::endl;
+	return isEveryFileMatching ? 0 : 1;
+}
@@ -0,0 +1,311 @@
+// Converts every png under a directory into a .swtex texture container next to it, with the full mip chain.
+// Usage: TextureCooker [--force] [--uncompressed] [directory]	(directory defaults to ../res/textures)
+// Valid containers newer than their png are skipped unless --force is given.
+// The ambient occlusion, roughness and displacement maps of a material set are packed into one <set>_Packed.swtex.
+// Material textures are block compressed: BC1 for the color, BC5 for the normals and BC4 for the single maps.
+// The packed maps stay RGB8, BC1 shares its endpoints across the three unrelated channels and blurs them all.
+// The PSNR of the full resolution level and the encoder throughput are printed for every compressed texture.
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../src/BlockCompressor.h"
+#include "../src/MipGenerator.h"
+#include "../src/TextureContainer.h"
+#include "../src/TextureLoader.h"
+#include "../src/ThreadPool.h"
+
+struct CookedTextureStatistics
+{
+	uint32_t format = TEXTURE_FORMAT_COUNT;
+	size_t containerSize = 0;
+	// size of the same mip chain uncompressed
+	size_t rawSize = 0;
+	size_t texelCount = 0;
+	double compressionSeconds = 0.0;
+	double psnr = 0.0;
+};
+
+// One container to cook, from a single png or from the packed maps of a material set
+struct CookJob
+{
+	std::string containerPath;
+	std::vector<std::string> sourcePaths;
+	// set path (without the map suffix) when the job packs maps
+	std::string packedSetPath;
+};
+
+const char* const COOKED_FORMAT_NAMES[TEXTURE_FORMAT_COUNT] = { "R8", "RG8", "RGB8", "RGBA8", "BC1", "BC4", "BC5" };
+
+// Format, flags and mip filtering of the container cooked from the single png sourcePath
+void GetCookedFormat(const std::string& sourcePath, bool isCompressing, uint32_t& format, uint32_t& flags, MipGenerationMode& mipMode)
+{
+	format = TEXTURE_FORMAT_RGBA8;
+	flags = TEXTURE_CONTAINER_NONE;
+	mipMode = MIP_GENERATION_LINEAR;
+
+	MaterialTextureSlot slot;
+	if (!TextureLoader::GetMaterialTextureSlot(sourcePath, slot))
+	{
+		return;
+	}
+
+	mipMode = TextureLoader::GetMaterialTextureMipMode(slot);
+	format = TextureLoader::GetMaterialTextureChannels(slot) == 3 ? TEXTURE_FORMAT_RGB8 : TEXTURE_FORMAT_R8;
+	if (isCompressing)
+	{
+		format = TEXTURE_FORMAT_BC4;
+	}
+	if (slot == MATERIAL_TEXTURE_ALBEDO)
+	{
+		flags |= TEXTURE_CONTAINER_SRGB;
+		format = isCompressing ? TEXTURE_FORMAT_BC1 : format;
+	}
+	else if (slot == MATERIAL_TEXTURE_NORMAL)
+	{
+		// the shader rebuilds z from x and y, so the normals only need two channels
+		flags |= TEXTURE_CONTAINER_NORMAL_MAP;
+		format = isCompressing ? TEXTURE_FORMAT_BC5 : TEXTURE_FORMAT_RG8;
+	}
+}
+
+// Copy of pixels keeping the first outputChannels channels of every texel
+std::vector<unsigned char> KeepFirstChannels(const unsigned char* pixels, size_t texelCount, uint32_t channels, uint32_t outputChannels)
+{
+	std::vector<unsigned char> output(texelCount * outputChannels);
+	for (size_t n = 0; n < texelCount; ++n)
+	{
+		for (uint32_t c = 0; c < outputChannels; ++c)
+		{
+			output[n * outputChannels + c] = pixels[n * channels + c];
+		}
+	}
+	return output;
+}
+
+// Builds the mips of image, converts every level to format and writes the container
+bool WriteCookedTexture(const DecodedImage& image, uint32_t format, uint32_t flags, MipGenerationMode mipMode,
+	const std::string& containerPath, CookedTextureStatistics& statistics)
+{
+	const bool isCompressed = TextureContainer::IsCompressedFormat(format);
+	const uint32_t channels = static_cast<uint32_t>(image.channels);
+	const uint32_t formatChannels = TextureContainer::GetFormatChannels(format);
+	const uint32_t width = static_cast<uint32_t>(image.width);
+	const uint32_t height = static_cast<uint32_t>(image.height);
+	const std::vector<MipLevel> levels = MipGenerator::GenerateMipChain(image.pixels.get(), width, height, channels, mipMode);
+
+	std::vector<TextureMip> mips(levels.size() + 1);
+	mips[0].width = width;
+	mips[0].height = height;
+	mips[0].data = image.pixels.get();
+	for (size_t n = 0; n < levels.size(); ++n)
+	{
+		mips[n + 1].width = levels[n].width;
+		mips[n + 1].height = levels[n].height;
+		mips[n + 1].data = levels[n].pixels.data();
+	}
+
+	statistics = CookedTextureStatistics();
+	statistics.format = format;
+	std::vector<std::vector<unsigned char>> convertedMips(mips.size());
+	const auto compressionStart = std::chrono::steady_clock::now();
+	for (size_t n = 0; n < mips.size(); ++n)
+	{
+		const size_t texelCount = size_t(mips[n].width) * mips[n].height;
+		statistics.rawSize += texelCount * formatChannels;
+		statistics.texelCount += texelCount;
+		if (isCompressed)
+		{
+			convertedMips[n] = BlockCompressor::Compress(format, static_cast<const unsigned char*>(mips[n].data), mips[n].width, mips[n].height, channels);
+			mips[n].data = convertedMips[n].data();
+		}
+		else if (formatChannels < channels)
+		{
+			convertedMips[n] = KeepFirstChannels(static_cast<const unsigned char*>(mips[n].data), texelCount, channels, formatChannels);
+			mips[n].data = convertedMips[n].data();
+		}
+		mips[n].size = TextureContainer::GetImageSize(format, mips[n].width, mips[n].height);
+	}
+	statistics.compressionSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - compressionStart).count();
+
+	if (isCompressed)
+	{
+		const std::vector<unsigned char> decompressed = BlockCompressor::Decompress(format, convertedMips[0].data(), width, height);
+		statistics.psnr = BlockCompressor::ComputePsnr(image.pixels.get(), channels, decompressed.data(), formatChannels,
+			size_t(width) * height, formatChannels);
+	}
+
+	if (!TextureContainer::Write(containerPath, format, flags, mips))
+	{
+		return false;
+	}
+
+	statistics.containerSize = static_cast<size_t>(std::filesystem::file_size(containerPath));
+	return true;
+}
+
+bool CookTexture(const CookJob& job, bool isCompressing, CookedTextureStatistics& statistics)
+{
+	if (job.packedSetPath.empty())
+	{
+		uint32_t format;
+		uint32_t flags;
+		MipGenerationMode mipMode;
+		GetCookedFormat(job.sourcePaths[0], isCompressing, format, flags, mipMode);
+		// the normal maps are decoded with all 3 channels so that the mips can be renormalized
+		const uint32_t channels = (flags & TEXTURE_CONTAINER_NORMAL_MAP) ? 3 : TextureContainer::GetFormatChannels(format);
+
+		const DecodedImage image = TextureLoader::DecodeImage(job.sourcePaths[0], static_cast<int>(channels));
+		return image.pixels && WriteCookedTexture(image, format, flags, mipMode, job.containerPath, statistics);
+	}
+
+	// maps missing from the set are left out of the packed texture and its descriptor
+	std::vector<DecodedImage> maps(MATERIAL_TEXTURE_SLOT_COUNT);
+	for (uint32_t slot = 0; slot < MATERIAL_TEXTURE_SLOT_COUNT; ++slot)
+	{
+		const std::string path = TextureLoader::GetMaterialTexturePath(job.packedSetPath, static_cast<MaterialTextureSlot>(slot));
+		if (TextureLoader::GetPackedChannel(static_cast<MaterialTextureSlot>(slot)) >= 0 && std::filesystem::exists(path))
+		{
+			maps[slot] = TextureLoader::DecodeImage(path, 1);
+		}
+	}
+
+	MaterialDescriptor descriptor;
+	const DecodedImage packed = TextureLoader::PackMaterialMaps(maps.data(), descriptor);
+	return packed.pixels && WriteCookedTexture(packed, TEXTURE_FORMAT_RGB8, TextureLoader::GetPackedContainerFlags(descriptor), MIP_GENERATION_LINEAR,
+		job.containerPath, statistics);
+}
+
+int main(int argc, char** argv)
+{
+	bool isForced = false;
+	bool isCompressing = true;
+	std::string directory = "../res/textures";
+	for (int n = 1; n < argc; ++n)
+	{
+		const std::string argument = argv[n];
+		if (argument == "--force")
+		{
+			isForced = true;
+		}
+		else if (argument == "--uncompressed")
+		{
+			isCompressing = false;
+		}
+		else
+		{
+			directory = argument;
+		}
+	}
+
+	// one job per png, except for the packed maps which get one job per material set
+	std::error_code error;
+	std::vector<CookJob> jobs;
+	std::map<std::string, size_t> packedJobs;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(directory, error))
+	{
+		if (!entry.is_regular_file() || entry.path().extension() != ".png")
+		{
+			continue;
+		}
+
+		const std::string sourcePath = entry.path().string();
+		MaterialTextureSlot slot;
+		if (!TextureLoader::GetMaterialTextureSlot(sourcePath, slot) || TextureLoader::GetPackedChannel(slot) < 0)
+		{
+			CookJob job;
+			job.containerPath = TextureContainer::GetContainerPath(sourcePath);
+			job.sourcePaths.push_back(sourcePath);
+			jobs.push_back(job);
+			continue;
+		}
+
+		const std::string suffix = TextureLoader::GetMaterialTexturePath("", slot);
+		const std::string setPath = sourcePath.substr(0, sourcePath.size() - suffix.size());
+		auto packedJob = packedJobs.find(setPath);
+		if (packedJob == packedJobs.end())
+		{
+			CookJob job;
+			job.containerPath = TextureLoader::GetPackedContainerPath(setPath);
+			job.packedSetPath = setPath;
+			packedJob = packedJobs.emplace(setPath, jobs.size()).first;
+			jobs.push_back(job);
+		}
+		jobs[packedJob->second].sourcePaths.push_back(sourcePath);
+	}
+	if (error)
+	{
+		std::cout << "ERROR::TEXTURE_COOKER::CAN_NOT_READ_DIRECTORY " << directory << " (" << error.message() << ")" << std::endl;
+		return 1;
+	}
+
+	const auto startTime = std::chrono::steady_clock::now();
+	std::mutex outputMutex;
+	std::atomic<size_t> cookedCount(0);
+	std::atomic<size_t> skippedCount(0);
+	std::atomic<size_t> failedCount(0);
+	size_t totalRawSize = 0;
+	size_t totalContainerSize = 0;
+	size_t totalCompressedTexels = 0;
+	double totalCompressionSeconds = 0.0;
+	ThreadPool::GetShared().ParallelFor(jobs.size(), [&](size_t n)
+	{
+		const CookJob& job = jobs[n];
+		bool isUpToDate = !isForced;
+		for (const std::string& sourcePath : job.sourcePaths)
+		{
+			isUpToDate = isUpToDate && TextureContainer::IsUpToDate(sourcePath, job.containerPath);
+		}
+		TextureContainer existing;
+		if (isUpToDate && existing.Open(job.containerPath))
+		{
+			skippedCount++;
+			return;
+		}
+
+		CookedTextureStatistics statistics;
+		const bool isCooked = CookTexture(job, isCompressing, statistics);
+		std::lock_guard<std::mutex> lock(outputMutex);
+		if (isCooked)
+		{
+			cookedCount++;
+			totalRawSize += statistics.rawSize;
+			totalContainerSize += statistics.containerSize;
+			std::cout << "cooked " << job.containerPath << " (" << COOKED_FORMAT_NAMES[statistics.format] << ", "
+				<< statistics.containerSize / 1024 << " KiB";
+			if (TextureContainer::IsCompressedFormat(statistics.format))
+			{
+				totalCompressedTexels += statistics.texelCount;
+				totalCompressionSeconds += statistics.compressionSeconds;
+				std::cout << ", PSNR " << statistics.psnr << " dB, "
+					<< statistics.texelCount / 1000000.0 / statistics.compressionSeconds << " MTexel/s";
+			}
+			std::cout << ")" << std::endl;
+		}
+		else
+		{
+			failedCount++;
+			std::cout << "ERROR::TEXTURE_COOKER::COOK_FAILED " << job.containerPath << std::endl;
+		}
+	});
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	std::cout << cookedCount << " cooked, " << skippedCount << " up to date, " << failedCount << " failed in " << seconds << " s" << std::endl;
+	if (totalContainerSize > 0)
+	{
+		std::cout << "cooked size " << totalContainerSize / 1024 << " KiB for " << totalRawSize / 1024 << " KiB uncompressed ("
+			<< double(totalRawSize) / double(totalContainerSize) << "x)" << std::endl;
+	}
+	if (totalCompressedTexels > 0)
+	{
+		// summed per texture, the textures themselves compress concurrently
+		std::cout << "block compression " << totalCompressedTexels / 1000000.0 / totalCompressionSeconds << " MTexel/s per texture" << std::endl;
+	}
+	return failedCount == 0 ? 0 : 1;
+}